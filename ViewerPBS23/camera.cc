@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace data_visualization {
 
@@ -132,15 +133,27 @@ void Camera::Rotate(double modifier) {
   rotation_y_ += AngleIncrement * modifier;
 }
 
-void Camera::UpdateModel(Eigen::Vector3f min, Eigen::Vector3f max) {
-  Eigen::Vector3d center = (min + max).cast<double>() / 2.0;
+void Camera::UpdateModel(const Eigen::Vector3f &center, float radius) {
   centering_x_ = -center[0];
   centering_y_ = -center[1];
   centering_z_ = -center[2];
 
-  float longest_edge =
-      std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
-  scaling_ = 1.0 / static_cast<double>(longest_edge);
+  // A single point or an empty model is left unscaled.
+  scaling_ = radius > 0.0f ? 1.0 / (2.0 * static_cast<double>(radius)) : 1.0;
+}
+
+double Camera::ProjectedRadius() const {
+  // The modeling transform maps the bounding sphere to the sphere of diameter
+  // 1 around the origin, which the rotations of the view leave in place.
+  const double kRadius = 0.5;
+  const double kDistance =
+      std::sqrt(pan_x_ * pan_x_ + pan_y_ * pan_y_ + distance_ * distance_);
+  if (kDistance <= kRadius) return std::numeric_limits<double>::infinity();
+
+  const double kFocal = static_cast<double>(viewport_height_) / 2.0 /
+                        std::tan(field_of_view_ * M_PI / 360.0);
+  return kFocal * kRadius /
+         std::sqrt(kDistance * kDistance - kRadius * kRadius);
 }
 
 void Camera::SetRotationX(double y) {
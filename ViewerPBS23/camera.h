@@ -228,12 +228,20 @@ class Camera {
 
   /**
    * @brief UpdateModel Updates the intrinsic parameters to compute a modeling
-   * transform that centers the bounding box of the model and makes its longest
-   * edge unit length.
-   * @param min Minimum point of the model bounding box.
-   * @param max Maximum point of the model bounding box.
+   * transform that centers the bounding sphere of the model and makes its
+   * diameter unit length, so the model fits the same way from any rotation.
+   * @param center Center of the model bounding sphere.
+   * @param radius Radius of the model bounding sphere.
    */
-  void UpdateModel(Eigen::Vector3f min, Eigen::Vector3f max);
+  void UpdateModel(const Eigen::Vector3f &center, float radius);
+
+  /**
+   * @brief ProjectedRadius Radius in pixels of the bounding sphere of the last
+   * "updated" model as the current view and projection show it.
+   * @return The radius on the viewport, infinite while the camera is inside
+   * the sphere.
+   */
+  double ProjectedRadius() const;
 
   /**
    * @brief SetRotationX If rotating is active, rotates the camera around the X
@@ -0,0 +1,654 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <gltf_format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include "./float_parser.h"
+
+namespace data_representation {
+
+namespace {
+
+const uint32_t kGlbMagic = 0x46546C67;      // "glTF"
+const uint32_t kGlbVersion = 2;
+const uint32_t kJsonChunk = 0x4E4F534A;     // "JSON"
+const uint32_t kBinaryChunk = 0x004E4942;   // "BIN\0"
+
+// Component types, with the values of the GL enums.
+const int kByte = 5120;
+const int kUnsignedByte = 5121;
+const int kShort = 5122;
+const int kUnsignedShort = 5123;
+const int kUnsignedInt = 5125;
+const int kFloat = 5126;
+
+const int kTriangles = 4;
+
+// Deepest JSON nesting accepted, so malformed files cannot exhaust the stack.
+const int kMaxJsonDepth = 64;
+
+uint32_t LoadUInt32(const char *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+// Index stored at p with an unsigned component type.
+uint32_t LoadIndex(const char *p, int component_type) {
+  if (component_type == kUnsignedByte) return static_cast<uint8_t>(*p);
+  if (component_type == kUnsignedShort) {
+    uint16_t value;
+    memcpy(&value, p, 2);
+    return value;
+  }
+  return LoadUInt32(p);
+}
+
+size_t ComponentSize(int component_type) {
+  switch (component_type) {
+    case kByte:
+    case kUnsignedByte: return 1;
+    case kShort:
+    case kUnsignedShort: return 2;
+    case kUnsignedInt:
+    case kFloat: return 4;
+    default: return 0;
+  }
+}
+
+size_t ComponentCount(const std::string &type) {
+  if (type == "SCALAR") return 1;
+  if (type == "VEC2") return 2;
+  if (type == "VEC3") return 3;
+  if (type == "VEC4") return 4;
+  return 0;
+}
+
+// Component i of element p, converted to float.
+float LoadComponent(const char *p, int component_type, bool normalized,
+                    size_t i) {
+  switch (component_type) {
+    case kFloat: {
+      float value;
+      memcpy(&value, p + i * 4, 4);
+      return value;
+    }
+    case kByte: {
+      const int8_t kValue = static_cast<int8_t>(p[i]);
+      return normalized ? std::max(kValue / 127.0f, -1.0f) : kValue;
+    }
+    case kUnsignedByte: {
+      const uint8_t kValue = static_cast<uint8_t>(p[i]);
+      return normalized ? kValue / 255.0f : kValue;
+    }
+    case kShort: {
+      int16_t value;
+      memcpy(&value, p + i * 2, 2);
+      return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    case kUnsignedShort: {
+      uint16_t value;
+      memcpy(&value, p + i * 2, 2);
+      return normalized ? value / 65535.0f : value;
+    }
+    case kUnsignedInt: {
+      return static_cast<float>(LoadUInt32(p + i * 4));
+    }
+    default: return 0.0f;
+  }
+}
+
+/**
+ * A parsed JSON value. Only the parts of the DOM glTF needs are exposed.
+ */
+struct JsonValue {
+  enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  JsonValue() : type(kNull), number(0) {}
+
+  // Member key of an object, nullptr if it is missing or this is no object.
+  const JsonValue *Get(const char *key) const {
+    if (type != kObject) return nullptr;
+    for (const auto &member : members)
+      if (member.first == key) return &member.second;
+    return nullptr;
+  }
+
+  // Item i of an array, nullptr if it is out of range or this is no array.
+  const JsonValue *At(int i) const {
+    if (type != kArray || i < 0 || static_cast<size_t>(i) >= items.size())
+      return nullptr;
+    return &items[i];
+  }
+
+  double Number(const char *key, double fallback) const {
+    const JsonValue *value = Get(key);
+    return value != nullptr && value->type == kNumber ? value->number
+                                                      : fallback;
+  }
+
+  // A non-negative integer member, such as an index, -1 if it is missing.
+  int Index(const char *key) const {
+    const double kValue = Number(key, -1);
+    return kValue >= 0 && kValue < 2147483647.0 ? static_cast<int>(kValue)
+                                                 : -1;
+  }
+
+  // A non-negative integer member, such as a byte offset or a count, 0 if it
+  // is missing. Returns false if it is not an integer that fits in a size_t.
+  bool Size(const char *key, size_t *size) const {
+    const double kValue = Number(key, 0);
+    if (!std::isfinite(kValue) || kValue < 0 || std::floor(kValue) != kValue ||
+        kValue >= static_cast<double>(std::numeric_limits<size_t>::max()))
+      return false;
+    *size = static_cast<size_t>(kValue);
+    return true;
+  }
+
+  std::string String(const char *key) const {
+    const JsonValue *value = Get(key);
+    return value != nullptr && value->type == kString ? value->string : "";
+  }
+
+  Type type;
+  double number;
+  std::string string;
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+class JsonParser {
+ public:
+  JsonParser(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+  bool Parse(JsonValue *value) {
+    if (!ParseValue(value, 0)) return false;
+    SkipSpace();
+    // The JSON chunk is padded with spaces, which SkipSpace consumed.
+    return p_ == end_ || *p_ == '\0';
+  }
+
+ private:
+  void SkipSpace() {
+    while (p_ < end_ &&
+           (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+      ++p_;
+  }
+
+  bool Consume(const char *literal) {
+    const size_t kLength = strlen(literal);
+    if (static_cast<size_t>(end_ - p_) < kLength ||
+        memcmp(p_, literal, kLength) != 0)
+      return false;
+    p_ += kLength;
+    return true;
+  }
+
+  static void AppendUtf8(uint32_t code, std::string *out) {
+    if (code < 0x80) {
+      out->push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  bool ParseHex4(uint32_t *code) {
+    if (end_ - p_ < 4) return false;
+    *code = 0;
+    for (int i = 0; i < 4; ++i, ++p_) {
+      const char kDigit = *p_;
+      *code <<= 4;
+      if (kDigit >= '0' && kDigit <= '9') *code |= kDigit - '0';
+      else if (kDigit >= 'a' && kDigit <= 'f') *code |= kDigit - 'a' + 10;
+      else if (kDigit >= 'A' && kDigit <= 'F') *code |= kDigit - 'A' + 10;
+      else return false;
+    }
+    return true;
+  }
+
+  bool ParseString(std::string *out) {
+    if (p_ >= end_ || *p_ != '"') return false;
+    ++p_;
+    out->clear();
+    while (p_ < end_ && *p_ != '"') {
+      if (*p_ != '\\') {
+        out->push_back(*p_++);
+        continue;
+      }
+      if (++p_ >= end_) return false;
+      const char kEscape = *p_++;
+      switch (kEscape) {
+        case '"': case '\\': case '/': out->push_back(kEscape); break;
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+          uint32_t code;
+          if (!ParseHex4(&code)) return false;
+          if (code >= 0xD800 && code < 0xDC00) {
+            uint32_t low;
+            if (!Consume("\\u") || !ParseHex4(&low) || low < 0xDC00 ||
+                low >= 0xE000)
+              return false;
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          AppendUtf8(code, out);
+          break;
+        }
+        default: return false;
+      }
+    }
+    if (p_ >= end_) return false;
+    ++p_;
+    return true;
+  }
+
+  bool ParseNumber(double *number) {
+    // strtod needs a terminated string and the chunk is not terminated. JSON
+    // numbers always use '.', so they are parsed in the "C" locale.
+    char token[64];
+    size_t length = 0;
+    while (p_ + length < end_ && length + 1 < sizeof(token) &&
+           strchr("+-0123456789.eE", p_[length]) != nullptr) {
+      token[length] = p_[length];
+      ++length;
+    }
+    token[length] = '\0';
+    char *token_end;
+    *number = ParseDouble(token, &token_end);
+    if (length == 0 || token_end != token + length) return false;
+    p_ += length;
+    return true;
+  }
+
+  bool ParseValue(JsonValue *value, int depth) {
+    if (depth > kMaxJsonDepth) return false;
+    SkipSpace();
+    if (p_ >= end_) return false;
+
+    switch (*p_) {
+      case '{': {
+        ++p_;
+        value->type = JsonValue::kObject;
+        SkipSpace();
+        if (p_ < end_ && *p_ == '}') {
+          ++p_;
+          return true;
+        }
+        while (true) {
+          SkipSpace();
+          std::pair<std::string, JsonValue> member;
+          if (!ParseString(&member.first)) return false;
+          SkipSpace();
+          if (!Consume(":") || !ParseValue(&member.second, depth + 1))
+            return false;
+          value->members.push_back(std::move(member));
+          SkipSpace();
+          if (Consume("}")) return true;
+          if (!Consume(",")) return false;
+        }
+      }
+      case '[': {
+        ++p_;
+        value->type = JsonValue::kArray;
+        SkipSpace();
+        if (p_ < end_ && *p_ == ']') {
+          ++p_;
+          return true;
+        }
+        while (true) {
+          value->items.emplace_back();
+          if (!ParseValue(&value->items.back(), depth + 1)) return false;
+          SkipSpace();
+          if (Consume("]")) return true;
+          if (!Consume(",")) return false;
+        }
+      }
+      case '"':
+        value->type = JsonValue::kString;
+        return ParseString(&value->string);
+      case 't':
+        value->type = JsonValue::kBool;
+        value->number = 1;
+        return Consume("true");
+      case 'f':
+        value->type = JsonValue::kBool;
+        return Consume("false");
+      case 'n':
+        return Consume("null");
+      default:
+        value->type = JsonValue::kNumber;
+        return ParseNumber(&value->number);
+    }
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+// Resolves accessor index of the document to a view of the binary chunk.
+// Attributes without an accessor are left with a null data pointer.
+bool ResolveAccessor(const JsonValue &document, int index, const char *binary,
+                     size_t binary_size, size_t components,
+                     GltfAccessor *accessor) {
+  if (index < 0) return true;
+
+  const JsonValue *kAccessors = document.Get("accessors");
+  const JsonValue *kJson = kAccessors ? kAccessors->At(index) : nullptr;
+  if (kJson == nullptr) return false;
+  if (kJson->Get("sparse") != nullptr) {
+    std::cerr << "Sparse glTF accessors are not supported." << std::endl;
+    return false;
+  }
+
+  const JsonValue *kViews = document.Get("bufferViews");
+  const JsonValue *kView =
+      kViews ? kViews->At(kJson->Index("bufferView")) : nullptr;
+  if (kView == nullptr || kView->Index("buffer") != 0 || binary == nullptr) {
+    std::cerr << "Only glTF accessors into the GLB binary chunk are supported."
+              << std::endl;
+    return false;
+  }
+
+  size_t view_offset = 0, view_length = 0, offset = 0;
+  if (!kJson->Size("count", &accessor->count) ||
+      !kView->Size("byteOffset", &view_offset) ||
+      !kView->Size("byteLength", &view_length) ||
+      !kJson->Size("byteOffset", &offset) ||
+      !kView->Size("byteStride", &accessor->stride)) {
+    std::cerr << "Malformed glTF accessor sizes." << std::endl;
+    return false;
+  }
+  accessor->components = ComponentCount(kJson->String("type"));
+  accessor->component_type = kJson->Index("componentType");
+  const JsonValue *kNormalized = kJson->Get("normalized");
+  accessor->normalized = kNormalized != nullptr && kNormalized->number != 0;
+  const size_t kComponentSize = ComponentSize(accessor->component_type);
+  if (accessor->components == 0 || kComponentSize == 0 ||
+      (components != 0 && accessor->components != components))
+    return false;
+
+  const size_t kElementSize = accessor->components * kComponentSize;
+  if (accessor->stride == 0) accessor->stride = kElementSize;
+
+  // Every element has to lie inside the view, and the view inside the chunk.
+  if (view_offset > binary_size || view_length > binary_size - view_offset ||
+      accessor->stride < kElementSize)
+    return false;
+  if (accessor->count > 0) {
+    if (offset > view_length || kElementSize > view_length - offset ||
+        accessor->count - 1 >
+            (view_length - offset - kElementSize) / accessor->stride)
+      return false;
+  }
+
+  accessor->data = binary + view_offset + offset;
+  return true;
+}
+
+// Resolves texture index of the document to the image it samples.
+GltfImage ResolveTexture(const JsonValue &document, const JsonValue *info,
+                         const std::string &directory, const char *binary,
+                         size_t binary_size) {
+  GltfImage image;
+  if (info == nullptr) return image;
+
+  const JsonValue *kTextures = document.Get("textures");
+  const JsonValue *kTexture =
+      kTextures ? kTextures->At(info->Index("index")) : nullptr;
+  const JsonValue *kImages = document.Get("images");
+  const JsonValue *kImage =
+      kTexture && kImages ? kImages->At(kTexture->Index("source")) : nullptr;
+  if (kImage == nullptr) return image;
+
+  const std::string kUri = kImage->String("uri");
+  if (!kUri.empty()) {
+    if (kUri.compare(0, 5, "data:") == 0)
+      std::cerr << "Embedded data URIs are not supported." << std::endl;
+    else
+      image.path = directory + kUri;
+    return image;
+  }
+
+  const JsonValue *kViews = document.Get("bufferViews");
+  const JsonValue *kView =
+      kViews ? kViews->At(kImage->Index("bufferView")) : nullptr;
+  if (kView == nullptr || binary == nullptr) return image;
+  size_t offset = 0, length = 0;
+  if (!kView->Size("byteOffset", &offset) ||
+      !kView->Size("byteLength", &length)) {
+    std::cerr << "Malformed glTF image sizes." << std::endl;
+    return image;
+  }
+  if (offset > binary_size || length > binary_size - offset) return image;
+  image.data = binary + offset;
+  image.size = length;
+  return image;
+}
+
+}  // namespace
+
+GltfAccessor::GltfAccessor()
+    : data(nullptr),
+      count(0),
+      components(0),
+      component_type(0),
+      normalized(false),
+      stride(0) {}
+
+bool GltfAccessor::IsPacked() const {
+  return data != nullptr &&
+         (component_type == kFloat || component_type == kUnsignedInt) &&
+         stride == components * 4;
+}
+
+void GltfAccessor::DecodeFloats(float *out) const {
+  if (component_type == kFloat && stride == components * 4) {
+    memcpy(out, data, count * stride);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const char *kElement = data + i * stride;
+    for (size_t j = 0; j < components; ++j)
+      *out++ = LoadComponent(kElement, component_type, normalized, j);
+  }
+}
+
+void GltfAccessor::DecodeIndices(int base, int *out) const {
+  for (size_t i = 0; i < count; ++i)
+    out[i] = base + static_cast<int>(LoadIndex(data + i * stride,
+                                               component_type));
+}
+
+GltfMaterial::GltfMaterial() : metallic(1), roughness(1) {
+  for (int i = 0; i < 4; ++i) base_color[i] = 1;
+}
+
+bool GlbFile::Open(const std::string &filename) {
+  primitives_.clear();
+  materials_.clear();
+  if (!file_.Open(filename)) return false;
+
+  const char *kData = file_.data();
+  const size_t kSize = file_.size();
+  if (kSize < 20 || LoadUInt32(kData) != kGlbMagic ||
+      LoadUInt32(kData + 4) != kGlbVersion ||
+      LoadUInt32(kData + 8) > kSize) {
+    std::cerr << "Not a glTF 2.0 binary file." << std::endl;
+    return false;
+  }
+
+  // The JSON chunk comes first and the binary chunk, if any, right after.
+  const size_t kEnd = LoadUInt32(kData + 8);
+  const char *json = nullptr, *binary = nullptr;
+  size_t json_size = 0, binary_size = 0;
+  for (size_t offset = 12; offset + 8 <= kEnd;) {
+    const size_t kLength = LoadUInt32(kData + offset);
+    const uint32_t kType = LoadUInt32(kData + offset + 4);
+    if (kLength > kEnd - offset - 8) return false;
+    if (kType == kJsonChunk && json == nullptr) {
+      json = kData + offset + 8;
+      json_size = kLength;
+    } else if (kType == kBinaryChunk && binary == nullptr) {
+      binary = kData + offset + 8;
+      binary_size = kLength;
+    }
+    offset += 8 + kLength;
+  }
+
+  JsonValue document;
+  if (json == nullptr ||
+      !JsonParser(json, json + json_size).Parse(&document) ||
+      document.type != JsonValue::kObject) {
+    std::cerr << "The glTF JSON chunk is not valid." << std::endl;
+    return false;
+  }
+
+  const size_t kSlash = filename.find_last_of('/');
+  const std::string kDirectory =
+      kSlash == std::string::npos ? "" : filename.substr(0, kSlash + 1);
+
+  const JsonValue *kMaterials = document.Get("materials");
+  for (size_t m = 0; kMaterials && m < kMaterials->items.size(); ++m) {
+    GltfMaterial material;
+    const JsonValue *kPbr = kMaterials->items[m].Get("pbrMetallicRoughness");
+    if (kPbr != nullptr) {
+      const JsonValue *kFactor = kPbr->Get("baseColorFactor");
+      for (int i = 0; kFactor && i < 4 && kFactor->At(i); ++i)
+        material.base_color[i] = static_cast<float>(kFactor->At(i)->number);
+      material.metallic =
+          static_cast<float>(kPbr->Number("metallicFactor", 1));
+      material.roughness =
+          static_cast<float>(kPbr->Number("roughnessFactor", 1));
+      material.base_color_image =
+          ResolveTexture(document, kPbr->Get("baseColorTexture"), kDirectory,
+                         binary, binary_size);
+      material.metallic_roughness_image =
+          ResolveTexture(document, kPbr->Get("metallicRoughnessTexture"),
+                         kDirectory, binary, binary_size);
+    }
+    materials_.push_back(material);
+  }
+
+  const JsonValue *kMeshes = document.Get("meshes");
+  for (size_t m = 0; kMeshes && m < kMeshes->items.size(); ++m) {
+    const JsonValue *kPrimitives = kMeshes->items[m].Get("primitives");
+    for (size_t p = 0; kPrimitives && p < kPrimitives->items.size(); ++p) {
+      const JsonValue &json_primitive = kPrimitives->items[p];
+      if (json_primitive.Number("mode", kTriangles) != kTriangles) {
+        std::cerr << "Skipping a glTF primitive that is not made of triangles."
+                  << std::endl;
+        continue;
+      }
+
+      const JsonValue *kAttributes = json_primitive.Get("attributes");
+      if (kAttributes == nullptr) return false;
+
+      GltfPrimitive primitive;
+      primitive.material = json_primitive.Index("material");
+      if (!ResolveAccessor(document, kAttributes->Index("POSITION"), binary,
+                           binary_size, 3, &primitive.positions) ||
+          !ResolveAccessor(document, kAttributes->Index("NORMAL"), binary,
+                           binary_size, 3, &primitive.normals) ||
+          !ResolveAccessor(document, kAttributes->Index("TEXCOORD_0"), binary,
+                           binary_size, 2, &primitive.tex_coords) ||
+          !ResolveAccessor(document, json_primitive.Index("indices"), binary,
+                           binary_size, 1, &primitive.indices)) {
+        std::cerr << "The glTF accessors do not match the binary chunk."
+                  << std::endl;
+        return false;
+      }
+      if (primitive.positions.data == nullptr ||
+          primitive.positions.component_type != kFloat) {
+        std::cerr << "The glTF primitive has no float positions." << std::endl;
+        return false;
+      }
+
+      const size_t kVertices = primitive.positions.count;
+      if ((primitive.normals.data && primitive.normals.count != kVertices) ||
+          (primitive.tex_coords.data &&
+           primitive.tex_coords.count != kVertices) ||
+          (primitive.indices.data &&
+           (primitive.indices.component_type == kByte ||
+            primitive.indices.component_type == kShort ||
+            primitive.indices.component_type == kFloat)))
+        return false;
+
+      // Indices are checked here once, so the decoders can trust them.
+      const size_t kCorners = primitive.indices.data ? primitive.indices.count
+                                                     : kVertices;
+      if (kCorners % 3 != 0) return false;
+      const GltfAccessor &kIndices = primitive.indices;
+      for (size_t i = 0; kIndices.data && i < kIndices.count; ++i) {
+        const uint32_t kIndex =
+            LoadIndex(kIndices.data + i * kIndices.stride,
+                      kIndices.component_type);
+        if (kIndex >= kVertices || kIndex > 2147483647u) {
+          std::cerr << "The glTF indices reference missing vertices."
+                    << std::endl;
+          return false;
+        }
+      }
+
+      const JsonValue *kAccessors = document.Get("accessors");
+      const JsonValue *kPosition =
+          kAccessors->At(kAttributes->Index("POSITION"));
+      const JsonValue *kMin = kPosition->Get("min");
+      const JsonValue *kMax = kPosition->Get("max");
+      primitive.has_bounds = kMin && kMax && kMin->items.size() == 3 &&
+                             kMax->items.size() == 3;
+      for (int i = 0; primitive.has_bounds && i < 3; ++i) {
+        primitive.min[i] = static_cast<float>(kMin->items[i].number);
+        primitive.max[i] = static_cast<float>(kMax->items[i].number);
+      }
+
+      primitives_.push_back(primitive);
+    }
+  }
+
+  if (primitives_.empty()) {
+    std::cerr << "The glTF file has no triangle primitives." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+const GltfAccessor *GlbFile::ZeroCopy(GltfAttribute attribute) const {
+  if (primitives_.size() != 1) return nullptr;
+
+  const GltfPrimitive &kPrimitive = primitives_[0];
+  const GltfAccessor *accessor = nullptr;
+  switch (attribute) {
+    case GltfAttribute::kPosition: accessor = &kPrimitive.positions; break;
+    case GltfAttribute::kNormal: accessor = &kPrimitive.normals; break;
+    case GltfAttribute::kTexCoord: accessor = &kPrimitive.tex_coords; break;
+    case GltfAttribute::kIndex: accessor = &kPrimitive.indices; break;
+  }
+
+  const int kType =
+      attribute == GltfAttribute::kIndex ? kUnsignedInt : kFloat;
+  return accessor->IsPacked() && accessor->component_type == kType ? accessor
+                                                                     : nullptr;
+}
+
+}  // namespace data_representation
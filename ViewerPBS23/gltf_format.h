@@ -0,0 +1,162 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef GLTF_FORMAT_H_
+#define GLTF_FORMAT_H_
+
+#include <mapped_file.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief The GltfAccessor struct Typed view of the elements of a glTF
+ * accessor inside the binary chunk of a GLB file.
+ */
+struct GltfAccessor {
+  GltfAccessor();
+
+  /**
+   * @brief data First byte of the first element, nullptr if the primitive
+   * does not have the attribute.
+   */
+  const char *data;
+  size_t count;
+  size_t components;
+
+  /**
+   * @brief component_type The glTF component type, which uses the values of
+   * the GL enums (GL_FLOAT, GL_UNSIGNED_SHORT, ...).
+   */
+  int component_type;
+  bool normalized;
+
+  /**
+   * @brief stride Bytes between the beginning of consecutive elements.
+   */
+  size_t stride;
+
+  /**
+   * @brief IsPacked Whether the elements are contiguous 32 bit floats (or
+   * unsigned ints for indices), so the data is already laid out like the
+   * TriangleMesh arrays.
+   */
+  bool IsPacked() const;
+
+  /**
+   * @brief DecodeFloats Converts the elements to count * components floats,
+   * scaling normalized integers to [0, 1] or [-1, 1].
+   */
+  void DecodeFloats(float *out) const;
+
+  /**
+   * @brief DecodeIndices Converts the scalar unsigned elements to ints and
+   * adds base to them.
+   */
+  void DecodeIndices(int base, int *out) const;
+};
+
+/**
+ * @brief The GltfPrimitive struct The attributes of a triangle primitive.
+ */
+struct GltfPrimitive {
+  GltfAccessor positions;
+  GltfAccessor normals;
+  GltfAccessor tex_coords;
+
+  /**
+   * @brief indices Missing for non-indexed primitives, whose vertices are
+   * taken three by three.
+   */
+  GltfAccessor indices;
+  int material;
+
+  /**
+   * @brief has_bounds Whether the position accessor declares min and max.
+   */
+  bool has_bounds;
+  Eigen::Vector3f min;
+  Eigen::Vector3f max;
+};
+
+/**
+ * @brief The GltfImage struct An image, either embedded in the binary chunk
+ * or stored in a file next to the model.
+ */
+struct GltfImage {
+  GltfImage() : data(nullptr), size(0) {}
+
+  bool valid() const { return data != nullptr || !path.empty(); }
+
+  /**
+   * @brief data Encoded (PNG, JPEG) bytes of an embedded image.
+   */
+  const char *data;
+  size_t size;
+
+  /**
+   * @brief path Path of an external image, relative to the working
+   * directory.
+   */
+  std::string path;
+};
+
+/**
+ * @brief The GltfMaterial struct The metallic-roughness model of a glTF
+ * material. Roughness is stored in the green channel of the
+ * metallic_roughness image and metalness in the blue one.
+ */
+struct GltfMaterial {
+  GltfMaterial();
+
+  float base_color[4];
+  float metallic;
+  float roughness;
+  GltfImage base_color_image;
+  GltfImage metallic_roughness_image;
+};
+
+/**
+ * @brief The GltfAttribute enum The TriangleMesh arrays a primitive provides.
+ */
+enum class GltfAttribute { kPosition, kNormal, kTexCoord, kIndex };
+
+/**
+ * @brief The GlbFile class A memory mapped glTF 2.0 binary file. Open parses
+ * the JSON chunk and resolves the accessors of the triangle primitives of
+ * every mesh to pointers into the mapped binary chunk, which stay valid until
+ * the object is destroyed. Node transforms, sparse accessors and external
+ * buffers are not supported.
+ */
+class GlbFile {
+ public:
+  /**
+   * @brief Open Maps and parses the GLB file at the path filename.
+   * @return Whether it is a valid GLB file with at least one triangle
+   * primitive.
+   */
+  bool Open(const std::string &filename);
+
+  const std::vector<GltfPrimitive> &primitives() const { return primitives_; }
+  const std::vector<GltfMaterial> &materials() const { return materials_; }
+
+  /**
+   * @brief ZeroCopy The accessor of attribute when the file has a single
+   * primitive whose attribute is packed like the TriangleMesh arrays, so it
+   * can be handed to the GPU as it is; nullptr otherwise.
+   */
+  const GltfAccessor *ZeroCopy(GltfAttribute attribute) const;
+
+ private:
+  MappedFile file_;
+  std::vector<GltfPrimitive> primitives_;
+  std::vector<GltfMaterial> materials_;
+};
+
+}  // namespace data_representation
+
+#endif  // GLTF_FORMAT_H_
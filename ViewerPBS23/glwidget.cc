@@ -2,12 +2,29 @@
 
 #include <glwidget.h>
 
+#include <QFileInfo>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 
+#include "./gltf_format.h"
+#include "./mesh_cache.h"
+#include "./mesh_diff.h"
+#include "./mesh_generators.h"
 #include "./mesh_io.h"
+#include "./mesh_optimize.h"
+#include "./mesh_simplify.h"
 #include "./triangle_mesh.h"
 
 namespace {
@@ -62,9 +79,45 @@ const std::vector<std::vector<std::string>> kShaderFiles = {
                 {"../shaders/ibl-pbs.vert",                 "../shaders/ibl-pbs.frag"},
                 {"../shaders/sky.vert",                     "../shaders/sky.frag"}};//sky needs to be the last one
 
+// PLY files at least this large are streamed to the GPU instead of loaded.
+const qint64 kStreamingBytes = qint64(256) << 20;
+
+// Vertices or faces decoded and uploaded at a time while streaming.
+const size_t kStreamChunkRecords = size_t(1) << 20;
+
+// Uploads of a streamed model that may wait for the GL thread. The load
+// thread stops decoding beyond them.
+const size_t kMaxPendingChunks = 4;
+
+// Minimum time between repaints of a model that is still streaming.
+const int kRepaintMs = 100;
+
+// Time the watched model has to stay unchanged before it is reloaded.
+const int kReloadDelayMs = 300;
+
+// Points of a point cloud drawn while the camera moves. The points are
+// shuffled, so any prefix of them is a uniform subsample.
+const size_t kMovingPoints = size_t(1) << 21;
+
+// Pixels the error of a level of detail may span on the viewport for it to
+// be drawn. Below one pixel the switch between levels cannot be seen.
+const double kLodErrorPixels = 0.5;
+
+// Models with more faces than this get no levels of detail: simplifying them
+// takes far longer than loading them.
+const size_t kMaxLodFaces = size_t(1) << 19;
+
+// Splat diameter in point spacings, so neighbouring splats overlap.
+const float kSplatScale = 2.0f;
+
+// Largest splat diameter in pixels.
+const float kMaxSplatPixels = 32.0f;
+
 const int kVertexAttributeIdx = 0;
 const int kNormalAttributeIdx = 1;
 const int kTexCoordAttributeIdx = 2;
+const int kColorAttributeIdx = 3;
+const int kQualityAttributeIdx = 4;
 
 
 bool ReadFile(const std::string filename, std::string *shader_source) {
@@ -83,23 +136,67 @@ bool ReadFile(const std::string filename, std::string *shader_source) {
   return true;
 }
 
+void UploadImage(const QImage &image, GLuint cube_map_pos) {
+  glTexImage2D(cube_map_pos, 0, GL_RGBA, image.width(), image.height(), 0,
+               GL_BGRA, GL_UNSIGNED_BYTE, image.bits());
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
 bool LoadImage(const std::string &path, GLuint cube_map_pos) {
   QImage image;
   bool res = image.load(path.c_str());
   if (res) {    
     QImage gl_image = image.mirrored();
-    glTexImage2D(cube_map_pos, 0, GL_RGBA, image.width(), image.height(), 0,
-                 GL_BGRA, GL_UNSIGNED_BYTE, image.bits());
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    UploadImage(image, cube_map_pos);
   }
 
   return res;
 }
 
+// Uploads the image at path to a new 2D texture. Returns 0 if it cannot be
+// read.
+GLuint LoadTexture(const std::string &path) {
+  QImage image;
+  if (!image.load(path.c_str())) return 0;
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  UploadImage(image.convertToFormat(QImage::Format_ARGB32), GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+// Decodes a glTF image, embedded or external, as 32 bit ARGB.
+bool LoadGltfImage(const data_representation::GltfImage &source,
+                   QImage *image) {
+  const bool kLoaded =
+      source.data != nullptr
+          ? image->loadFromData(reinterpret_cast<const uchar *>(source.data),
+                                static_cast<int>(source.size))
+          : image->load(source.path.c_str());
+  if (kLoaded) *image = image->convertToFormat(QImage::Format_ARGB32);
+  return kLoaded;
+}
+
+// Grey image with the channel of image selected by shift (16 for red, 8 for
+// green, 0 for blue), since the material maps are sampled by their red one.
+QImage ExtractChannel(const QImage &image, int shift) {
+  QImage channel(image.width(), image.height(), QImage::Format_ARGB32);
+  for (int y = 0; y < image.height(); ++y) {
+    const QRgb *src = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+    QRgb *dst = reinterpret_cast<QRgb *>(channel.scanLine(y));
+    for (int x = 0; x < image.width(); ++x) {
+      const int kValue = (src[x] >> shift) & 0xFF;
+      dst[x] = qRgb(kValue, kValue, kValue);
+    }
+  }
+  return channel;
+}
+
 bool LoadCubeMap(const QString &dir) {
   std::string path = dir.toUtf8().constData();
   bool res =   LoadImage(path + "/right", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
@@ -137,6 +234,8 @@ bool LoadProgram(const std::string &vertex, const std::string &fragment,
     program->bindAttributeLocation("vertex", kVertexAttributeIdx);
     program->bindAttributeLocation("normal", kNormalAttributeIdx);
     program->bindAttributeLocation("texCoord", kTexCoordAttributeIdx);
+    program->bindAttributeLocation("color", kColorAttributeIdx);
+    program->bindAttributeLocation("quality", kQualityAttributeIdx);
     program->link();
   }
 
@@ -155,88 +254,803 @@ GLWidget::GLWidget(QWidget *parent)
       fresnel_(0.2, 0.2, 0.2),
       skyVisible_(true),
       metalness_(0),
-      roughness_(0){
+      roughness_(0),
+      VAO(0),
+      VBO_v(0),
+      VBO_n(0),
+      VBO_tc(0),
+      VBO_c(0),
+      VBO_q(0),
+      VBO_i(0),
+      index_count_(0),
+      vertex_count_(0),
+      moving_(false),
+      optimize_models_(true),
+      build_lods_(true),
+      level_of_detail_(0) {
   setFocusPolicy(Qt::StrongFocus);
+
+  reload_timer_.setSingleShot(true);
+  reload_timer_.setInterval(kReloadDelayMs);
+  connect(&reload_timer_, &QTimer::timeout, this, &GLWidget::ReloadModel);
+  connect(&model_watcher_, &QFileSystemWatcher::fileChanged, this,
+          &GLWidget::ModelFileChanged);
 }
 
+/**
+ * @brief The GLWidget::LoadJob struct State shared between a background load
+ * and the GUI thread.
+ */
+struct GLWidget::LoadJob {
+  LoadJob(const data_representation::LoadProgress::Callback &report,
+          const QString &file, bool is_reload)
+      : progress(report),
+        filename(file),
+        reload(is_reload),
+        loaded(false),
+        streamed(false) {}
+
+  data_representation::LoadProgress progress;
+  std::unique_ptr<data_representation::TriangleMesh> mesh;
+  data_representation::GlbFile glb;
+  QString filename;
+  bool reload;
+  bool loaded;
+
+  // Uploader of a model large enough to be streamed, and whether it was: if
+  // not, the model is read as a whole instead.
+  std::shared_ptr<StreamUploader> stream;
+  bool streamed;
+};
+
+/**
+ * @brief The GLWidget::StreamUploader class Receives the chunks produced by
+ * StreamFromPly and uploads them into a new set of mesh buffers. The current
+ * model stays on screen until the first faces arrive; the partially loaded
+ * model is drawn from then on, and the current one comes back if the load
+ * fails or is cancelled. A threaded uploader is fed on the load thread and
+ * posts every upload to the GL thread, with at most kMaxPendingChunks of them
+ * waiting; otherwise it uploads right away.
+ */
+class GLWidget::StreamUploader
+    : public data_representation::MeshStreamSink,
+      public std::enable_shared_from_this<GLWidget::StreamUploader> {
+ public:
+  StreamUploader(GLWidget *widget, bool threaded,
+                 data_representation::LoadProgress *progress)
+      : widget_(widget),
+        threaded_(threaded),
+        progress_(progress),
+        mesh_(nullptr),
+        vertices_(0),
+        pending_(0),
+        streamed_(),
+        replaced_(),
+        shown_(false),
+        finished_(false),
+        streamed_vertices_(0),
+        indices_(0),
+        center_(Eigen::Vector3f::Zero()),
+        radius_(0.0f),
+        old_index_count_(0),
+        old_vertex_count_(0) {}
+
+  // Called on the thread that feeds the uploader.
+  bool Stream(const std::string &filename,
+              data_representation::TriangleMesh *mesh) {
+    mesh_ = mesh;
+    return data_representation::StreamFromPly(filename, kStreamChunkRecords,
+                                              this, mesh, progress_);
+  }
+
+  bool Begin(size_t vertices, size_t faces, bool colors) override {
+    if (faces * 3 > size_t(std::numeric_limits<GLsizei>::max())) return false;
+    vertices_ = vertices;
+    Post([this, vertices, faces, colors]() {
+      CreateBuffers(vertices, faces, colors);
+    });
+    return true;
+  }
+
+  void AddVertices(size_t first, size_t count, const float *vertices,
+                   const float *normals, const float *tex_coords,
+                   const uint8_t *colors) override {
+    auto chunk = std::make_shared<data_representation::TriangleMesh>();
+    chunk->vertices_.assign(vertices, vertices + count * 3);
+    if (normals != nullptr)
+      chunk->normals_.assign(normals, normals + count * 3);
+    chunk->texCoords_.assign(tex_coords, tex_coords + count * 2);
+    if (colors != nullptr) chunk->colors_.assign(colors, colors + count * 4);
+    // The bounding box is final once the last vertex has been read.
+    const bool kLast = first + count == vertices_;
+    const Eigen::Vector3f kCenter = mesh_->center_;
+    const float kRadius = mesh_->radius_;
+
+    Post([this, first, count, chunk, kLast, kCenter, kRadius]() {
+      Upload(GL_ARRAY_BUFFER, streamed_.v, first * 3, chunk->vertices_);
+      Upload(GL_ARRAY_BUFFER, streamed_.n, first * 3, chunk->normals_);
+      Upload(GL_ARRAY_BUFFER, streamed_.tc, first * 2, chunk->texCoords_);
+      Upload(GL_ARRAY_BUFFER, streamed_.c, first * 4, chunk->colors_);
+      if (kLast) {
+        center_ = kCenter;
+        radius_ = kRadius;
+      }
+    });
+  }
+
+  void AddFaces(size_t first, size_t count, const int *faces) override {
+    auto chunk = std::make_shared<std::vector<int>>(faces, faces + count * 3);
+    Post([this, first, count, chunk]() {
+      Upload(GL_ELEMENT_ARRAY_BUFFER, streamed_.i, first * 3, *chunk);
+      indices_ = GLsizei((first + count) * 3);
+      if (!shown_) Show();
+      widget_->index_count_ = indices_;
+
+      // Show what has been loaded so far, but do not let repainting dominate.
+      const auto kNow = std::chrono::steady_clock::now();
+      if (kNow - last_repaint_ > std::chrono::milliseconds(kRepaintMs)) {
+        widget_->updateGL();
+        last_repaint_ = kNow;
+      }
+    });
+  }
+
+  void AddNormals(size_t first, size_t count, const float *normals) override {
+    auto chunk =
+        std::make_shared<std::vector<float>>(normals, normals + count * 3);
+    Post([this, first, chunk]() {
+      Upload(GL_ARRAY_BUFFER, streamed_.n, first * 3, *chunk);
+    });
+  }
+
+  /**
+   * @brief Finish Called on the GL thread once the stream is over and every
+   * upload posted by it has run. Keeps the streamed buffers, which the caller
+   * then hands to SetModel, or deletes them and restores the previous model.
+   */
+  void Finish(bool keep) {
+    finished_ = true;
+    widget_->makeCurrent();
+    if (keep) {
+      if (!shown_) Show();
+      widget_->DeleteMeshBuffers(replaced_);
+      return;
+    }
+    if (shown_) {
+      widget_->ExchangeMeshBuffers(&replaced_);
+      widget_->mesh_ = std::move(old_mesh_);
+      widget_->index_count_ = old_index_count_;
+      widget_->vertex_count_ = old_vertex_count_;
+      widget_->material_draws_.swap(old_material_draws_);
+      if (widget_->mesh_ != nullptr) {
+        widget_->camera_.UpdateModel(widget_->mesh_->center_,
+                                     widget_->mesh_->radius_);
+      }
+      widget_->ShowLevelOfDetail(widget_->SelectLevelOfDetail());
+    }
+    widget_->DeleteMeshBuffers(streamed_);
+  }
+
+ private:
+  // Runs upload on the GL thread: right away, or posted to it once fewer
+  // than kMaxPendingChunks uploads are waiting, so that a fast decoder does
+  // not queue the whole file. Uploads of a cancelled load are skipped.
+  void Post(const std::function<void()> &upload) {
+    if (!threaded_) {
+      widget_->makeCurrent();
+      upload();
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (pending_ >= kMaxPendingChunks && !progress_->cancelled())
+        drained_.wait_for(lock, std::chrono::milliseconds(kRepaintMs));
+      ++pending_;
+    }
+    std::shared_ptr<StreamUploader> self = shared_from_this();
+    QMetaObject::invokeMethod(
+        widget_,
+        [self, upload]() {
+          // The job, and its progress, may be gone once finished.
+          if (!self->finished_ && !self->progress_->cancelled()) {
+            self->widget_->makeCurrent();
+            upload();
+          }
+          std::lock_guard<std::mutex> lock(self->mutex_);
+          --self->pending_;
+          self->drained_.notify_one();
+        },
+        Qt::QueuedConnection);
+  }
+
+  // Creates streamed_ with room for the whole model, leaving the current
+  // buffers of the widget as they are.
+  void CreateBuffers(size_t vertices, size_t faces, bool colors) {
+    widget_->ExchangeMeshBuffers(&streamed_);
+    widget_->CreateMeshBuffers();
+    const MeshBuffers kBuffers = {widget_->VAO,    widget_->VBO_v,
+                                  widget_->VBO_n,  widget_->VBO_tc,
+                                  widget_->VBO_c,  widget_->VBO_q,
+                                  widget_->VBO_i};
+    widget_->SetVertexChannels(colors, false);
+    widget_->ExchangeMeshBuffers(&streamed_);
+
+    const auto kAllocate = [](GLenum target, GLuint buffer, size_t size) {
+      glBindBuffer(target, buffer);
+      glBufferData(target, size, nullptr, GL_STATIC_DRAW);
+    };
+    kAllocate(GL_ARRAY_BUFFER, kBuffers.v, sizeof(float) * vertices * 3);
+    kAllocate(GL_ARRAY_BUFFER, kBuffers.n, sizeof(float) * vertices * 3);
+    kAllocate(GL_ARRAY_BUFFER, kBuffers.tc, sizeof(float) * vertices * 2);
+    kAllocate(GL_ARRAY_BUFFER, kBuffers.c, colors ? vertices * 4 : 0);
+    kAllocate(GL_ELEMENT_ARRAY_BUFFER, kBuffers.i, sizeof(int) * faces * 3);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    streamed_vertices_ = vertices;
+  }
+
+  // Draws the streamed buffers instead of the current model, which is kept
+  // aside until Finish.
+  void Show() {
+    shown_ = true;
+    replaced_ = streamed_;
+    widget_->ExchangeMeshBuffers(&replaced_);
+    old_mesh_ = std::move(widget_->mesh_);
+    // A placeholder without levels of detail until SetModel.
+    widget_->mesh_ = std::make_unique<data_representation::TriangleMesh>();
+    widget_->mesh_->center_ = center_;
+    widget_->mesh_->radius_ = radius_;
+    widget_->camera_.UpdateModel(center_, radius_);
+
+    old_index_count_ = widget_->index_count_;
+    old_vertex_count_ = widget_->vertex_count_;
+    old_material_draws_.swap(widget_->material_draws_);
+    widget_->index_count_ = indices_;
+    widget_->vertex_count_ = streamed_vertices_;
+    widget_->ShowLevelOfDetail(0);
+  }
+
+  template <typename T>
+  void Upload(GLenum target, GLuint buffer, size_t first,
+              const std::vector<T> &data) {
+    if (data.empty()) return;
+    glBindBuffer(target, buffer);
+    glBufferSubData(target, sizeof(T) * first, sizeof(T) * data.size(),
+                    data.data());
+    glBindBuffer(target, 0);
+  }
+
+  GLWidget *widget_;
+  const bool threaded_;
+  data_representation::LoadProgress *progress_;
+
+  // Used on the thread that feeds the uploader.
+  data_representation::TriangleMesh *mesh_;
+  size_t vertices_;
+
+  // Uploads posted to the GL thread that have not run yet.
+  std::mutex mutex_;
+  std::condition_variable drained_;
+  size_t pending_;
+
+  // Used on the GL thread only.
+  MeshBuffers streamed_;
+  MeshBuffers replaced_;
+  bool shown_;
+  bool finished_;
+  size_t streamed_vertices_;
+  GLsizei indices_;
+  Eigen::Vector3f center_;
+  float radius_;
+  std::unique_ptr<data_representation::TriangleMesh> old_mesh_;
+  GLsizei old_index_count_;
+  size_t old_vertex_count_;
+  std::vector<MaterialDraw> old_material_draws_;
+  std::chrono::steady_clock::time_point last_repaint_;
+};
+
 GLWidget::~GLWidget() {
+  if (load_thread_.joinable()) {
+    load_job_->progress.Cancel();
+    load_thread_.join();
+    if (load_job_->stream != nullptr) {
+      makeCurrent();
+      load_job_->stream->Finish(false);
+    }
+  }
   if (initialized_) {
     glDeleteTextures(1, &specular_map_);
     glDeleteTextures(1, &diffuse_map_);
+    glDeleteTextures(GLsizei(material_textures_.size()),
+                     material_textures_.data());
   }
 }
 
-bool GLWidget::LoadModel(const QString &filename) {
-  std::string file = filename.toUtf8().constData();
+void GLWidget::ExchangeMeshBuffers(MeshBuffers *buffers) {
+  std::swap(VAO, buffers->vao);
+  std::swap(VBO_v, buffers->v);
+  std::swap(VBO_n, buffers->n);
+  std::swap(VBO_tc, buffers->tc);
+  std::swap(VBO_c, buffers->c);
+  std::swap(VBO_q, buffers->q);
+  std::swap(VBO_i, buffers->i);
+}
+
+void GLWidget::DeleteMeshBuffers(const MeshBuffers &buffers) {
+  if (buffers.vao == 0) return;
+  glDeleteVertexArrays(1, &buffers.vao);
+  const GLuint kBuffers[] = {buffers.v,  buffers.n, buffers.tc,
+                             buffers.c,  buffers.q, buffers.i};
+  glDeleteBuffers(6, kBuffers);
+}
+
+void GLWidget::CreateMeshBuffers() {
+  if (VAO != 0) return;
+
+  // Generate VAO and Buffers
+  glGenVertexArrays(1, &VAO);
+
+  glGenBuffers(1, &VBO_v);
+  glGenBuffers(1, &VBO_n);
+  glGenBuffers(1, &VBO_tc);
+  glGenBuffers(1, &VBO_c);
+  glGenBuffers(1, &VBO_q);
+  glGenBuffers(1, &VBO_i);
+
+  // Bind VAO
+  glBindVertexArray(VAO);
+
+  // Configure coordinate VBO -> attrib location 0
+  glBindBuffer(GL_ARRAY_BUFFER, VBO_v);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(0);
+
+  // Configure normal VBO -> attrib location 1
+  glBindBuffer(GL_ARRAY_BUFFER, VBO_n);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(1);
+
+  // Configure texCoords VBO -> attrib location 2
+  glBindBuffer(GL_ARRAY_BUFFER, VBO_tc);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+  glEnableVertexAttribArray(2);
+
+  // Configure color VBO -> attrib location 3, normalized RGBA bytes. It is
+  // only enabled for models with colors (see SetVertexChannels).
+  glBindBuffer(GL_ARRAY_BUFFER, VBO_c);
+  glVertexAttribPointer(kColorAttributeIdx, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0,
+                        0);
+
+  // Configure quality VBO -> attrib location 4, normalized bytes.
+  glBindBuffer(GL_ARRAY_BUFFER, VBO_q);
+  glVertexAttribPointer(kQualityAttributeIdx, 1, GL_UNSIGNED_BYTE, GL_TRUE, 0,
+                        0);
+
+  // Configure coordinate EBO -> elements
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO_i);
+
+  // Unbind VAO
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GLWidget::SetVertexChannels(bool colors, bool quality) {
+  glBindVertexArray(VAO);
+  if (colors)
+    glEnableVertexAttribArray(kColorAttributeIdx);
+  else
+    glDisableVertexAttribArray(kColorAttributeIdx);
+  if (quality)
+    glEnableVertexAttribArray(kQualityAttributeIdx);
+  else
+    glDisableVertexAttribArray(kQualityAttributeIdx);
+  glBindVertexArray(0);
+
+  // Disabled arrays read the current value of the attribute instead.
+  glVertexAttrib4f(kColorAttributeIdx, 1.0f, 1.0f, 1.0f, 1.0f);
+  glVertexAttrib1f(kQualityAttributeIdx, 0.0f);
+}
+
+namespace {
+
+// Uploads array to buffer, or the accessor of glb the loader left out of it.
+// Returns the number of items uploaded.
+template <typename T>
+size_t UploadArray(GLenum target, GLuint buffer, const std::vector<T> &array,
+                   const data_representation::GlbFile *glb,
+                   data_representation::GltfAttribute attribute) {
+  const data_representation::GltfAccessor *zero_copy =
+      glb != nullptr ? glb->ZeroCopy(attribute) : nullptr;
+  glBindBuffer(target, buffer);
+  if (array.empty() && zero_copy != nullptr) {
+    const size_t kItems = zero_copy->count * zero_copy->components;
+    glBufferData(target, sizeof(T) * kItems, zero_copy->data, GL_STATIC_DRAW);
+    return kItems;
+  }
+  glBufferData(target, sizeof(T) * array.size(), array.data(), GL_STATIC_DRAW);
+  return array.size();
+}
+
+// Uploads the faces of mesh, or the indices of glb the loader left out of
+// them, followed by the faces of its levels of detail. Returns the number of
+// indices of the model itself.
+size_t UploadIndices(GLuint buffer,
+                     const data_representation::TriangleMesh &mesh,
+                     const data_representation::GlbFile *glb) {
+  if (mesh.lodFaces_.empty()) {
+    return UploadArray(GL_ELEMENT_ARRAY_BUFFER, buffer, mesh.faces_, glb,
+                       data_representation::GltfAttribute::kIndex);
+  }
+  const size_t kFaces = sizeof(int) * mesh.faces_.size();
+  const size_t kLods = sizeof(int) * mesh.lodFaces_.size();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, kFaces + kLods, nullptr,
+               GL_STATIC_DRAW);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, kFaces, mesh.faces_.data());
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, kFaces, kLods,
+                  mesh.lodFaces_.data());
+  return mesh.faces_.size();
+}
+
+// Uploads the parts of updated that differ from old, which is what buffer
+// holds from offset bytes on and has the same size. Returns the number of
+// bytes uploaded.
+template <typename T>
+size_t UploadChanges(GLenum target, GLuint buffer, const std::vector<T> &old,
+                     const std::vector<T> &updated, size_t offset = 0) {
+  const std::vector<data_representation::ByteRange> kRanges =
+      data_representation::DiffBytes(old.data(), updated.data(),
+                                     sizeof(T) * updated.size());
+  const char *data = reinterpret_cast<const char *>(updated.data());
+  size_t bytes = 0;
+  glBindBuffer(target, buffer);
+  for (const data_representation::ByteRange &range : kRanges) {
+    glBufferSubData(target, offset + range.offset, range.size,
+                    data + range.offset);
+    bytes += range.size;
+  }
+  glBindBuffer(target, 0);
+  return bytes;
+}
+
+// Quality normalized over its range to bytes, so it can be uploaded in the
+// same compact format as the colors.
+std::vector<uint8_t> QualityBytes(const std::vector<float> &quality) {
+  std::vector<uint8_t> bytes(quality.size(), 0);
+  if (quality.empty()) return bytes;
+  const auto kRange = std::minmax_element(quality.begin(), quality.end());
+  const float kMin = *kRange.first;
+  const float kSpan = *kRange.second - kMin;
+  if (!(kSpan > 0.0f)) return bytes;
+  for (size_t i = 0; i < quality.size(); ++i)
+    bytes[i] = uint8_t((quality[i] - kMin) / kSpan * 255.0f + 0.5f);
+  return bytes;
+}
+
+// Builds the levels of detail of mesh unless it has too many faces.
+void BuildLevelsOfDetailInBudget(data_representation::TriangleMesh *mesh) {
+  if (mesh->faces_.size() / 3 > kMaxLodFaces) {
+    std::cout << "Levels of detail skipped: more than " << kMaxLodFaces
+              << " faces" << std::endl;
+    return;
+  }
+  data_representation::BuildLevelsOfDetail(mesh);
+}
+
+// Whether the model at filename is a PLY large enough to be streamed.
+bool ShouldStream(const QString &filename) {
+  return filename.endsWith(".ply", Qt::CaseInsensitive) &&
+         QFileInfo(filename).size() >= kStreamingBytes;
+}
+
+// Generates the shape named by a "<shape>_<resolution>.null" path, or the
+// default sphere for any other ".null" path.
+bool GenerateModel(const std::string &file,
+                   data_representation::TriangleMesh *mesh) {
+  const size_t kSlash = file.find_last_of('/');
+  const std::string kName = file.substr(
+      kSlash == std::string::npos ? 0 : kSlash + 1);
+  const size_t kSeparator = kName.find_last_of('_');
+  if (kSeparator == std::string::npos)
+    return data_representation::GenerateUvSphere(64, 64, mesh);
+  const size_t kResolution =
+      std::strtoul(kName.c_str() + kSeparator + 1, nullptr, 10);
+  return data_representation::GenerateMesh(kName.substr(0, kSeparator),
+                                           kResolution, mesh);
+}
+
+// Reads the model at file into mesh, reusing the post-processed mesh of a
+// previous load of the same contents when the cache is up to date. GLB files
+// are opened into glb, which keeps the arrays left out of mesh. Runs without
+// a GL context, so it can be called from any thread.
+bool ReadModel(const std::string &file,
+               data_representation::TriangleMesh *mesh,
+               data_representation::GlbFile *glb,
+               data_representation::LoadProgress *progress) {
   size_t pos = file.find_last_of(".");
   std::string type = file.substr(pos + 1);
 
+  if (type.compare("null") == 0) return GenerateModel(file, mesh);
+  // Binary glTF is already laid out for the GPU and is not cached.
+  if (type.compare("glb") == 0)
+    return data_representation::ReadFromGlb(file, glb, mesh, progress);
+  if (type.compare("ply") != 0 && type.compare("obj") != 0 &&
+      type.compare("stl") != 0)
+    return false;
+
+  uint64_t hash = 0;
+  const bool kHashed = data_representation::HashSourceFile(file, &hash);
+  if (kHashed && data_representation::ReadFromCache(file, hash, mesh)) {
+    std::cout << "Loaded from cache "
+              << data_representation::CacheFilename(file) << std::endl;
+    return true;
+  }
+
+  bool res = false;
+  if (type.compare("ply") == 0)
+    res = data_representation::ReadFromPly(file, mesh, progress);
+  else if (type.compare("stl") == 0)
+    res = data_representation::ReadFromStl(file, mesh, progress);
+  else
+    res = data_representation::ReadFromObj(file, mesh, progress);
+  if (res && kHashed &&
+      !data_representation::WriteToCache(file, hash, *mesh)) {
+    std::cerr << "Could not write cache "
+              << data_representation::CacheFilename(file) << std::endl;
+  }
+  return res;
+}
+
+}  // namespace
+
+bool GLWidget::LoadModel(const QString &filename) {
+  std::string file = filename.toUtf8().constData();
+
   std::unique_ptr<data_representation::TriangleMesh> mesh =
       std::make_unique<data_representation::TriangleMesh>();
 
-  bool res = false;
-  /*if (type.compare("ply") == 0) {
-    res = data_representation::ReadFromPly(file, mesh.get());
-  } else if (type.compare("obj") == 0) {
-    res = data_representation::ReadFromObj(file, mesh.get());
-  } else if(type.compare("null") == 0) {
-    res = data_representation::CreateSphere(mesh.get());
-  }*/
-      res = data_representation::CreateSphere(mesh.get());
+  if (ShouldStream(filename)) {
+    // Too large to hold twice: upload it chunk by chunk as it is decoded.
+    StreamUploader uploader(this, false, nullptr);
+    const bool kStreamed = uploader.Stream(file, mesh.get());
+    uploader.Finish(kStreamed);
+    if (kStreamed) {
+      SetModel(std::move(mesh), true);
+      WatchModel(filename);
+      return true;
+    }
+    mesh->Clear();
+  }
 
-  if (res) {
-    mesh_.reset(mesh.release());
-    camera_.UpdateModel(mesh_->min_, mesh_->max_);
-    //mesh_->computeNormals();
+  data_representation::GlbFile glb;
+  if (!ReadModel(file, mesh.get(), &glb, nullptr)) return false;
+  if (optimize_models_) data_representation::OptimizeMesh(mesh.get());
+  if (build_lods_) BuildLevelsOfDetailInBudget(mesh.get());
+  SetModel(std::move(mesh), false, &glb);
+  WatchModel(filename);
+  return true;
+}
 
-    // Generate VAO and Buffers
-    glGenVertexArrays(1, &VAO);
+bool GLWidget::LoadModelAsync(const QString &filename) {
+  if (load_job_ != nullptr && load_job_->reload) {
+    // The user asked for another model: the reload is no longer wanted.
+    load_job_->progress.Cancel();
+    FinishLoad(load_job_);
+  }
+  if (load_job_ != nullptr) return false;
 
-    glGenBuffers(1, &VBO_v);
-    glGenBuffers(1, &VBO_n);
-    glGenBuffers(1, &VBO_tc);
-    glGenBuffers(1, &VBO_i);
+  StartLoad(filename, false);
+  return true;
+}
 
-    // Bind VAO
-    glBindVertexArray(VAO);
+void GLWidget::StartLoad(const QString &filename, bool reload) {
+  data_representation::LoadProgress::Callback report;
+  if (!reload)
+    report = [this](int percent) { emit LoadProgressChanged(percent); };
+  load_job_ = std::make_shared<LoadJob>(report, filename, reload);
+  std::shared_ptr<LoadJob> job = load_job_;
+  const std::string kFile = filename.toUtf8().constData();
+  const bool kOptimize = optimize_models_;
+  const bool kLods = build_lods_;
+  // Too large to hold twice: decoded chunk by chunk here and uploaded on the
+  // GL thread as the chunks arrive.
+  if (ShouldStream(filename))
+    job->stream = std::make_shared<StreamUploader>(this, true, &job->progress);
+
+  load_thread_ = std::thread([this, job, kFile, kOptimize, kLods]() {
+    job->mesh = std::make_unique<data_representation::TriangleMesh>();
+    if (job->stream != nullptr) {
+      job->streamed = job->stream->Stream(kFile, job->mesh.get());
+      job->loaded = job->streamed;
+      if (!job->streamed) job->mesh->Clear();
+    }
+    if (!job->streamed && !job->progress.cancelled())
+      job->loaded = ReadModel(kFile, job->mesh.get(), &job->glb,
+                              &job->progress);
+    // The cache keeps the order of the file, so that this can be toggled
+    // between loads without invalidating it.
+    if (job->loaded && !job->streamed && kOptimize)
+      data_representation::OptimizeMesh(job->mesh.get());
+    if (job->loaded && !job->streamed && kLods)
+      BuildLevelsOfDetailInBudget(job->mesh.get());
+    job->loaded = job->loaded && job->progress.Report(100);
+    QMetaObject::invokeMethod(this, [this, job]() { FinishLoad(job); },
+                              Qt::QueuedConnection);
+  });
+}
 
-    // Configure coordinate VBO -> attrib location 0
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_v);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*mesh_->vertices_.size(), &mesh_->vertices_[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(0);
+void GLWidget::CancelLoad() {
+  if (load_job_ != nullptr) load_job_->progress.Cancel();
+}
 
-    // Configure normal VBO -> attrib location 1
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_n);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*mesh_->normals_.size(), &mesh_->normals_[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(1);
-
-    // Configure texCoords VBO -> attrib location 2
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_tc);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*mesh_->texCoords_.size(), &mesh_->texCoords_[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(2);
-
-    // Configure coordinate EBO -> elements
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO_i);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int)*mesh_->faces_.size(), &mesh_->faces_[0], GL_STATIC_DRAW);
-    
-    // Unbind VAO
-    glBindVertexArray(0);
+void GLWidget::FinishLoad(const std::shared_ptr<LoadJob> &job) {
+  if (job != load_job_) return;
+  load_thread_.join();
+  load_job_.reset();
 
-    
-    //SKY BOX
-    // --------------------------------------------------
+  const bool kCancelled = job->progress.cancelled();
+  const bool kLoaded = job->loaded && !kCancelled;
+  // A streamed model that did not load puts the previous one back.
+  if (job->stream != nullptr) {
+    job->stream->Finish(kLoaded && job->streamed);
+    updateGL();
+  }
+  if (job->reload && !job->streamed) {
+    // A file caught halfway through being written fails to load; the next
+    // change notification retries it.
+    if (kLoaded) {
+      makeCurrent();
+      UpdateModel(std::move(job->mesh), &job->glb);
+      updateGL();
+    }
+    return;
+  }
+
+  if (kLoaded) {
+    makeCurrent();
+    SetModel(std::move(job->mesh), job->streamed, &job->glb);
+    WatchModel(job->filename);
+    updateGL();
+  }
+  if (!job->reload) emit LoadFinished(kLoaded, kCancelled);
+}
+
+void GLWidget::WatchModel(const QString &filename) {
+  if (!model_watcher_.files().isEmpty())
+    model_watcher_.removePaths(model_watcher_.files());
+  if (QFileInfo::exists(filename)) model_watcher_.addPath(filename);
+}
+
+void GLWidget::ModelFileChanged(const QString &path) {
+  // Files replaced by a rename stop being watched; watch the new one.
+  if (!model_watcher_.files().contains(path) && QFileInfo::exists(path))
+    model_watcher_.addPath(path);
+  reload_timer_.start();
+}
 
+void GLWidget::ReloadModel() {
+  if (model_watcher_.files().isEmpty()) return;
+  const QString kFilename = model_watcher_.files().front();
+  if (load_job_ != nullptr) {
+    reload_timer_.start();
+    return;
+  }
+
+  std::cout << "Reloading " << kFilename.toUtf8().constData() << std::endl;
+  StartLoad(kFilename, true);
+}
+
+void GLWidget::UpdateModel(
+    std::unique_ptr<data_representation::TriangleMesh> mesh,
+    const data_representation::GlbFile *glb) {
+  const bool kSameLayout =
+      mesh_ != nullptr && !mesh_->vertices_.empty() &&
+      mesh->vertices_.size() == mesh_->vertices_.size() &&
+      mesh->normals_.size() == mesh_->normals_.size() &&
+      mesh->texCoords_.size() == mesh_->texCoords_.size() &&
+      mesh->colors_.size() == mesh_->colors_.size() &&
+      mesh->quality_.size() == mesh_->quality_.size() &&
+      mesh->faces_.size() == mesh_->faces_.size() &&
+      mesh->lodFaces_.size() == mesh_->lodFaces_.size() &&
+      mesh_->vertices_.size() == vertex_count_ * 3 &&
+      mesh_->faces_.size() == size_t(index_count_);
+  if (!kSameLayout || (glb != nullptr && !glb->primitives().empty())) {
+    SetModel(std::move(mesh), false, glb);
+    return;
+  }
+
+  size_t uploaded = 0;
+  uploaded += UploadChanges(GL_ARRAY_BUFFER, VBO_v, mesh_->vertices_,
+                            mesh->vertices_);
+  uploaded += UploadChanges(GL_ARRAY_BUFFER, VBO_n, mesh_->normals_,
+                            mesh->normals_);
+  uploaded += UploadChanges(GL_ARRAY_BUFFER, VBO_tc, mesh_->texCoords_,
+                            mesh->texCoords_);
+  uploaded += UploadChanges(GL_ARRAY_BUFFER, VBO_c, mesh_->colors_,
+                            mesh->colors_);
+  uploaded += UploadChanges(GL_ARRAY_BUFFER, VBO_q,
+                            QualityBytes(mesh_->quality_),
+                            QualityBytes(mesh->quality_));
+  uploaded += UploadChanges(GL_ELEMENT_ARRAY_BUFFER, VBO_i, mesh_->faces_,
+                            mesh->faces_);
+  uploaded += UploadChanges(GL_ELEMENT_ARRAY_BUFFER, VBO_i, mesh_->lodFaces_,
+                            mesh->lodFaces_,
+                            sizeof(int) * mesh->faces_.size());
+  const size_t kTotal =
+      sizeof(float) * (mesh->vertices_.size() + mesh->normals_.size() +
+                       mesh->texCoords_.size()) +
+      mesh->colors_.size() + mesh->quality_.size() +
+      sizeof(int) * (mesh->faces_.size() + mesh->lodFaces_.size());
+  std::cout << "Updated " << uploaded << " of " << kTotal << " bytes"
+            << std::endl;
+
+  bool same_materials =
+      mesh->materialRanges_.size() == mesh_->materialRanges_.size();
+  for (size_t i = 0; same_materials && i < mesh->materialRanges_.size(); ++i) {
+    const auto &kOld = mesh_->materialRanges_[i];
+    const auto &kNew = mesh->materialRanges_[i];
+    same_materials = kOld.first == kNew.first && kOld.count == kNew.count &&
+                     kOld.diffuse_map == kNew.diffuse_map;
+  }
+
+  mesh_ = std::move(mesh);
+  camera_.UpdateModel(mesh_->center_, mesh_->radius_);
+  if (!same_materials) LoadMaterialRanges();
+  ShowLevelOfDetail(SelectLevelOfDetail());
+}
+
+void GLWidget::SetModel(
+    std::unique_ptr<data_representation::TriangleMesh> mesh, bool uploaded,
+    const data_representation::GlbFile *glb) {
+  mesh_ = std::move(mesh);
+  camera_.UpdateModel(mesh_->center_, mesh_->radius_);
+  //mesh_->computeNormals();
+
+  if (!uploaded) {
+    CreateMeshBuffers();
+
+    using data_representation::GltfAttribute;
+    const size_t kVertices = UploadArray(
+        GL_ARRAY_BUFFER, VBO_v, mesh_->vertices_, glb, GltfAttribute::kPosition);
+    UploadArray(GL_ARRAY_BUFFER, VBO_n, mesh_->normals_, glb,
+                GltfAttribute::kNormal);
+    UploadArray(GL_ARRAY_BUFFER, VBO_tc, mesh_->texCoords_, glb,
+                GltfAttribute::kTexCoord);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_c);
+    glBufferData(GL_ARRAY_BUFFER, mesh_->colors_.size(),
+                 mesh_->colors_.data(), GL_STATIC_DRAW);
+    const std::vector<uint8_t> kQuality = QualityBytes(mesh_->quality_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_q);
+    glBufferData(GL_ARRAY_BUFFER, kQuality.size(), kQuality.data(),
+                 GL_STATIC_DRAW);
+    const size_t kIndices = UploadIndices(VBO_i, *mesh_, glb);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    index_count_ = kIndices;
+    vertex_count_ = kVertices / 3;
+    SetVertexChannels(!mesh_->colors_.empty(), !mesh_->quality_.empty());
+  }
+
+  LoadMaterialRanges();
+  if (glb != nullptr && !glb->primitives().empty())
+    LoadGltfMaterial(*glb);
+
+  
+  //SKY BOX
+  // --------------------------------------------------
+
+  // The sky box does not depend on the model, so it is only created once.
+  if (skyFaces_.empty()) {
     // Store skyVertices_ defined by my skyboxVertices
-    for(unsigned int i=0; i<sizeof(skyboxVertices); i++)
+    for(unsigned int i=0; i<sizeof(skyboxVertices)/sizeof(skyboxVertices[0]); i++)
     {
         skyVertices_.push_back(skyboxVertices[i]);
     }
 
     // Store skyFaces_ defined by my skyboxIndices
-    for(unsigned int i=0; i<sizeof(skyboxIndices); i++)
+    for(unsigned int i=0; i<sizeof(skyboxIndices)/sizeof(skyboxIndices[0]); i++)
     {
         skyFaces_.push_back(skyboxIndices[i]);
     }
@@ -261,14 +1075,14 @@ bool GLWidget::LoadModel(const QString &filename) {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-    emit SetFaces(QString(std::to_string(mesh_->faces_.size() / 3).c_str()));
-    emit SetVertices(
-        QString(std::to_string(mesh_->vertices_.size() / 3).c_str()));
-    return true;
   }
 
-  return false;
+  ShowLevelOfDetail(0);
+  std::string vertices = std::to_string(vertex_count_);
+  if (mesh_->unweldedVertices_ > vertex_count_)
+    vertices += " (" + std::to_string(mesh_->unweldedVertices_) +
+                " before welding)";
+  emit SetVertices(QString(vertices.c_str()));
 }
 
 bool GLWidget::LoadSpecularMap(const QString &dir) {
@@ -322,6 +1136,58 @@ bool GLWidget::LoadMetalnessMap(const QString &filename)
     return res;
 }
 
+void GLWidget::LoadGltfMaterial(const data_representation::GlbFile &glb) {
+  const int kIndex = glb.primitives()[0].material;
+  if (kIndex < 0 || static_cast<size_t>(kIndex) >= glb.materials().size())
+    return;
+  const data_representation::GltfMaterial &kMaterial = glb.materials()[kIndex];
+
+  metalness_ = kMaterial.metallic;
+  roughness_ = kMaterial.roughness;
+
+  QImage image;
+  if (kMaterial.base_color_image.valid() &&
+      LoadGltfImage(kMaterial.base_color_image, &image)) {
+    glBindTexture(GL_TEXTURE_2D, color_map_);
+    UploadImage(image, GL_TEXTURE_2D);
+  }
+  if (kMaterial.metallic_roughness_image.valid() &&
+      LoadGltfImage(kMaterial.metallic_roughness_image, &image)) {
+    glBindTexture(GL_TEXTURE_2D, roughness_map_);
+    UploadImage(ExtractChannel(image, 8), GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, metalness_map_);
+    UploadImage(ExtractChannel(image, 0), GL_TEXTURE_2D);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GLWidget::LoadMaterialRanges() {
+  glDeleteTextures(GLsizei(material_textures_.size()),
+                   material_textures_.data());
+  material_textures_.clear();
+  material_draws_.clear();
+
+  std::map<std::string, GLuint> textures;
+  for (const auto &range : mesh_->materialRanges_) {
+    GLuint texture = 0;
+    if (!range.diffuse_map.empty()) {
+      const auto kFound = textures.find(range.diffuse_map);
+      if (kFound != textures.end()) {
+        texture = kFound->second;
+      } else {
+        texture = LoadTexture(range.diffuse_map);
+        if (texture != 0)
+          material_textures_.push_back(texture);
+        else
+          qWarning() << "Failed to load" << range.diffuse_map.c_str();
+        textures[range.diffuse_map] = texture;
+      }
+    }
+    material_draws_.push_back(
+        {texture, GLsizei(range.first), GLsizei(range.count)});
+  }
+}
+
 bool GLWidget::LoadBRDFLUTMap(const QString &filename)
 {
     glBindTexture(GL_TEXTURE_2D, brdfLUT_map_);
@@ -426,9 +1292,11 @@ void GLWidget::resizeGL(int w, int h) {
 void GLWidget::mousePressEvent(QMouseEvent *event) {
   if (event->button() == Qt::LeftButton) {
     camera_.StartRotating(event->x(), event->y());
+    moving_ = true;
   }
   if (event->button() == Qt::RightButton) {
     camera_.StartZooming(event->x(), event->y());
+    moving_ = true;
   }
   updateGL();
 }
@@ -447,6 +1315,7 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event) {
   if (event->button() == Qt::RightButton) {
     camera_.StopZooming(event->x(), event->y());
   }
+  moving_ = event->buttons() & (Qt::LeftButton | Qt::RightButton);
   updateGL();
 }
 
@@ -569,9 +1438,37 @@ void GLWidget::paintGL() {
             glUniform1f(metalness_location, metalness_);
             glUniform3f(albedo_location, albedo[0], albedo[1], albedo[2]);
 
-            // Mesh draw call
+            // Mesh draw calls, one per material range. Ranges that share a
+            // texture are adjacent, so it is only rebound when it changes.
             glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, mesh_->faces_.size(), GL_UNSIGNED_INT, (GLvoid*)0);
+            if (index_count_ == 0 && vertex_count_ > 0) {
+                DrawPointCloud(projection, view * model);
+            } else if (material_draws_.empty()) {
+                // The faces of the levels of detail follow the ones of the
+                // model in VBO_i.
+                const size_t kLevel = SelectLevelOfDetail();
+                if (kLevel != level_of_detail_) ShowLevelOfDetail(kLevel);
+                if (kLevel == 0) {
+                    glDrawElements(GL_TRIANGLES, index_count_, GL_UNSIGNED_INT, (GLvoid*)0);
+                } else {
+                    const auto &kLod = mesh_->lods_[kLevel - 1];
+                    const size_t kFirst = mesh_->faces_.size() + kLod.first;
+                    glDrawElements(GL_TRIANGLES, GLsizei(kLod.count), GL_UNSIGNED_INT,
+                                   (GLvoid*)(sizeof(int) * kFirst));
+                }
+            } else {
+                glActiveTexture(GL_TEXTURE0);
+                GLuint bound = color_map_;
+                for (const MaterialDraw &draw : material_draws_) {
+                    const GLuint kTexture = draw.texture != 0 ? draw.texture : color_map_;
+                    if (kTexture != bound) {
+                        glBindTexture(GL_TEXTURE_2D, kTexture);
+                        bound = kTexture;
+                    }
+                    glDrawElements(GL_TRIANGLES, draw.count, GL_UNSIGNED_INT,
+                                   (GLvoid*)(sizeof(int) * draw.first));
+                }
+            }
             glBindVertexArray(0);
             
             // END.
@@ -613,6 +1510,27 @@ void GLWidget::paintGL() {
     }
 }
 
+void GLWidget::DrawPointCloud(const Eigen::Matrix4f &projection,
+                              const Eigen::Matrix4f &model_view) {
+  const size_t kPoints =
+      moving_ ? std::min(vertex_count_, kMovingPoints) : vertex_count_;
+  // A subsample of 1 / n of the points has sqrt(n) times their spacing.
+  const float kSpacing = mesh_->pointSpacing_ *
+                         std::sqrt(float(vertex_count_) / float(kPoints));
+
+  // Splats are sized for the depth of the center of the model.
+  const Eigen::Vector3f kCenter = (mesh_->min_ + mesh_->max_) / 2.0f;
+  const Eigen::Vector4f kEye =
+      model_view * Eigen::Vector4f(kCenter[0], kCenter[1], kCenter[2], 1.0f);
+  const float kDepth = std::max(-kEye[2], float(kZNear));
+  const float kScale = model_view.block<3, 1>(0, 0).norm();
+  const float kPixels = kSplatScale * kSpacing * kScale * projection(1, 1) *
+                        height_ / (2.0f * kDepth);
+
+  glPointSize(std::min(std::max(kPixels, 1.0f), kMaxSplatPixels));
+  glDrawArrays(GL_POINTS, 0, GLsizei(kPoints));
+}
+
 void GLWidget::SetReflection(bool set) {
     if(set) currentShader_ = 2;
     updateGL();
@@ -666,6 +1584,32 @@ void GLWidget::SetSkyVisible(bool set)
     skyVisible_ = set;
 }
 
+void GLWidget::SetOptimizeModels(bool set) { optimize_models_ = set; }
+
+void GLWidget::SetBuildLevelsOfDetail(bool set) { build_lods_ = set; }
+
+size_t GLWidget::SelectLevelOfDetail() const {
+  if (mesh_ == nullptr || mesh_->lods_.empty() || !(mesh_->radius_ > 0.0f))
+    return 0;
+  // The errors grow from level to level.
+  const double kPixelsPerUnit = camera_.ProjectedRadius() / mesh_->radius_;
+  size_t level = 0;
+  while (level < mesh_->lods_.size() &&
+         mesh_->lods_[level].error * kPixelsPerUnit <= kLodErrorPixels)
+    ++level;
+  return level;
+}
+
+void GLWidget::ShowLevelOfDetail(size_t level) {
+  level_of_detail_ = level;
+  std::string faces = std::to_string(index_count_ / 3);
+  if (level > 0) {
+    faces = std::to_string(mesh_->lods_[level - 1].count / 3) + " of " +
+            faces + " (level " + std::to_string(level) + ")";
+  }
+  emit SetFaces(QString(faces.c_str()));
+}
+
 void GLWidget::SetMetalness(double d) {
     metalness_ = d;
     updateGL();
@@ -4,17 +4,25 @@
 #define GLWIDGET_H_
 
 #include <GL/glew.h>
+#include <QFileSystemWatcher>
 #include <QGLWidget>
 #include <QImage>
 #include <QMouseEvent>
 #include <QOpenGLShaderProgram>
 #include <QString>
+#include <QTimer>
 
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "./camera.h"
 #include "./triangle_mesh.h"
 
+namespace data_representation {
+class GlbFile;
+}
+
 class GLWidget : public QGLWidget {
   Q_OBJECT
 
@@ -23,13 +31,26 @@ class GLWidget : public QGLWidget {
   ~GLWidget();
 
   /**
-   * @brief LoadModel Loads a PLY model at the filename path into the mesh_ data
-   * structure.
-   * @param filename Path to the PLY model.
+   * @brief LoadModel Loads a PLY, OBJ, STL or GLB model at the filename path into
+   * the mesh_ data structure. The file is then watched and reloaded whenever it
+   * changes (see ReloadModel). Paths named "<shape>_<resolution>.null" are
+   * not read but generated (see GenerateMesh).
+   * @param filename Path to the model.
    * @return Whether it was able to load the model.
    */
   bool LoadModel(const QString &filename);
 
+  /**
+   * @brief LoadModelAsync Reads the model at the filename path on a worker
+   * thread and only uploads it once it is ready, so the current model stays
+   * interactive meanwhile. Emits LoadProgressChanged while it runs and
+   * LoadFinished at the end. Models large enough to be streamed are decoded
+   * on the worker too and drawn as their chunks are uploaded.
+   * @param filename Path to the PLY, OBJ, STL or GLB model.
+   * @return Whether the load started, false if another one is still running.
+   */
+  bool LoadModelAsync(const QString &filename);
+
   /**
    * @brief LoadSpecularMap Will load load a cube map that will be used for the
    * specular component.
@@ -196,8 +217,198 @@ class GLWidget : public QGLWidget {
   GLuint VBO_v;
   GLuint VBO_n;
   GLuint VBO_tc;
+  GLuint VBO_c;
+  GLuint VBO_q;
   GLuint VBO_i;
 
+  /**
+   * @brief index_count_ Number of indices of the model in VBO_i that are
+   * drawn. It grows while a model is being streamed.
+   */
+  GLsizei index_count_;
+
+  /**
+   * @brief vertex_count_ Number of vertices of the model in the VBOs.
+   */
+  size_t vertex_count_;
+
+  /**
+   * @brief StreamUploader Uploads the chunks of a streamed model, from the
+   * GL thread or posted to it from a load thread.
+   */
+  class StreamUploader;
+
+  /**
+   * @brief MeshBuffers The VAO and VBOs of a model, kept aside while
+   * another one is being streamed.
+   */
+  struct MeshBuffers {
+    GLuint vao, v, n, tc, c, q, i;
+  };
+
+  /**
+   * @brief ExchangeMeshBuffers Swaps the model VAO and VBOs with buffers.
+   */
+  void ExchangeMeshBuffers(MeshBuffers *buffers);
+
+  /**
+   * @brief DeleteMeshBuffers Deletes buffers, if they were created.
+   */
+  void DeleteMeshBuffers(const MeshBuffers &buffers);
+
+  /**
+   * @brief CreateMeshBuffers Generates the model VAO and VBOs and sets up
+   * their attributes. Does nothing if they already exist.
+   */
+  void CreateMeshBuffers();
+
+  /**
+   * @brief SetVertexChannels Enables the color and quality arrays of the
+   * model VAO when the model has them. Disabled ones read a constant: white
+   * colors and zero quality.
+   */
+  void SetVertexChannels(bool colors, bool quality);
+
+  /**
+   * @brief SetModel Makes mesh the current model and uploads it, unless
+   * uploaded says its buffers were already filled while streaming it. The
+   * arrays of a GLB model left out of mesh are uploaded straight from glb,
+   * and its material replaces the color, roughness and metalness maps.
+   */
+  void SetModel(std::unique_ptr<data_representation::TriangleMesh> mesh,
+                bool uploaded,
+                const data_representation::GlbFile *glb = nullptr);
+
+  /**
+   * @brief LoadGltfMaterial Maps the metallic-roughness material of the
+   * first primitive of glb onto color_map_, roughness_map_, metalness_map_
+   * and the metalness_ and roughness_ factors.
+   */
+  void LoadGltfMaterial(const data_representation::GlbFile &glb);
+
+  /**
+   * @brief MaterialDraw A material range of the model and the texture it is
+   * drawn with, 0 for color_map_.
+   */
+  struct MaterialDraw {
+    GLuint texture;
+    GLsizei first;
+    GLsizei count;
+  };
+
+  /**
+   * @brief material_draws_ One draw call per material range of the model.
+   * When it is empty the whole index buffer is drawn with color_map_.
+   */
+  std::vector<MaterialDraw> material_draws_;
+
+  /**
+   * @brief material_textures_ The diffuse maps of the material ranges, each
+   * one uploaded once however many ranges use it.
+   */
+  std::vector<GLuint> material_textures_;
+
+  /**
+   * @brief LoadMaterialRanges Rebuilds material_draws_ and
+   * material_textures_ from the material ranges of mesh_.
+   */
+  void LoadMaterialRanges();
+
+  /**
+   * @brief moving_ Whether a mouse drag is moving the camera. Point clouds are
+   * drawn with fewer points meanwhile.
+   */
+  bool moving_;
+
+  /**
+   * @brief DrawPointCloud Draws the vertices of a model without faces as
+   * square splats sized after its point spacing, or only a prefix of them
+   * with larger splats while the camera is moving.
+   */
+  void DrawPointCloud(const Eigen::Matrix4f &projection,
+                      const Eigen::Matrix4f &model_view);
+
+  /**
+   * @brief LoadJob State of a load running on load_thread_.
+   */
+  struct LoadJob;
+
+  /**
+   * @brief StartLoad Reads the model at filename on load_thread_. A reload
+   * reports no progress and replaces the model with UpdateModel.
+   */
+  void StartLoad(const QString &filename, bool reload);
+
+  /**
+   * @brief FinishLoad Called on the GUI thread once the job of
+   * LoadModelAsync is done. Swaps its mesh in unless it was cancelled.
+   */
+  void FinishLoad(const std::shared_ptr<LoadJob> &job);
+
+  /**
+   * @brief UpdateModel Replaces the current model with mesh, a new version of
+   * the same file. When both have the same number of vertices and indices,
+   * only the ranges of the buffers whose contents changed are uploaded;
+   * otherwise, or if mesh left arrays in glb, it falls back to SetModel.
+   */
+  void UpdateModel(std::unique_ptr<data_representation::TriangleMesh> mesh,
+                   const data_representation::GlbFile *glb);
+
+  /**
+   * @brief WatchModel Makes filename the only watched file, or stops watching
+   * if it does not exist.
+   */
+  void WatchModel(const QString &filename);
+
+  /**
+   * @brief model_watcher_ Watches the file of the current model.
+   */
+  QFileSystemWatcher model_watcher_;
+
+  /**
+   * @brief reload_timer_ Delays reloads until the file has stopped changing,
+   * since exporters write it in several steps.
+   */
+  QTimer reload_timer_;
+
+  /**
+   * @brief load_job_ The running background load, nullptr if there is none.
+   */
+  std::shared_ptr<LoadJob> load_job_;
+
+  /**
+   * @brief load_thread_ Worker thread of load_job_.
+   */
+  std::thread load_thread_;
+
+  /**
+   * @brief optimize_models_ Whether loads run OptimizeMesh on their model.
+   */
+  bool optimize_models_;
+
+  /**
+   * @brief build_lods_ Whether loads run BuildLevelsOfDetail on their model.
+   */
+  bool build_lods_;
+
+  /**
+   * @brief level_of_detail_ The level of detail of mesh_ drawn last, 0 for
+   * the model itself and i for lods_[i - 1].
+   */
+  size_t level_of_detail_;
+
+  /**
+   * @brief SelectLevelOfDetail The coarsest level of detail of mesh_ whose
+   * error spans at most half a pixel on the viewport, 0 for the model itself.
+   */
+  size_t SelectLevelOfDetail() const;
+
+  /**
+   * @brief ShowLevelOfDetail Sets level_of_detail_ and shows its faces on the
+   * interface label "Faces".
+   */
+  void ShowLevelOfDetail(size_t level);
+
   GLuint VAO_sky;
   GLuint VBO_v_sky;
   GLuint VBO_i_sky;
@@ -271,6 +482,37 @@ class GLWidget : public QGLWidget {
      */
     void SetRoughness(double);
 
+  /**
+   * @brief SetOptimizeModels Sets whether the models loaded from now on are
+   * reordered for the GPU (see OptimizeMesh). Streamed models never are.
+   */
+  void SetOptimizeModels(bool set);
+
+  /**
+   * @brief SetBuildLevelsOfDetail Sets whether the models loaded from now on
+   * get simplified levels of detail (see BuildLevelsOfDetail), which are drawn
+   * instead of them when they are small on the viewport. Streamed models and
+   * models of more than 2^19 faces never do.
+   */
+  void SetBuildLevelsOfDetail(bool set);
+
+  /**
+   * @brief CancelLoad Stops the running LoadModelAsync, if any, and keeps the
+   * current model.
+   */
+  void CancelLoad();
+
+  /**
+   * @brief ModelFileChanged Schedules a reload of the watched model.
+   */
+  void ModelFileChanged(const QString &path);
+
+  /**
+   * @brief ReloadModel Reads the watched model again in the background, or
+   * retries later if another load is running.
+   */
+  void ReloadModel();
+
  signals:
   /**
    * @brief SetFaces Signal that updates the interface label "Faces".
@@ -287,6 +529,18 @@ class GLWidget : public QGLWidget {
    */
   void SetFramerate(QString);
 
+  /**
+   * @brief LoadProgressChanged Signal with the percentage of the running
+   * LoadModelAsync. Emitted from its worker thread.
+   */
+  void LoadProgressChanged(int);
+
+  /**
+   * @brief LoadFinished Signal emitted when LoadModelAsync is over, with
+   * whether the new model is shown and whether it was cancelled.
+   */
+  void LoadFinished(bool loaded, bool cancelled);
+
 };
 
 #endif  //  GLWIDGET_H_
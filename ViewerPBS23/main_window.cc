@@ -3,7 +3,9 @@
 #include <main_window.h>
 
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include "./mesh_generators.h"
 #include "./ui_main_window.h"
 
 namespace gui {
@@ -11,6 +13,7 @@ namespace gui {
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow) {
   ui->setupUi(this);
+  ui->LoadOptions->hide();
 }
 
 MainWindow::~MainWindow() { delete ui; }
@@ -23,14 +26,45 @@ void MainWindow::on_actionLoad_triggered() {
   QString filename;
 
   filename = QFileDialog::getOpenFileName(this, tr("Load model"), "./",
-                                          tr("3D Files ( *.ply *.obj )"));
+                                          tr("3D Files ( *.ply *.obj *.stl *.glb )"));
   if (!filename.isNull()) {
-    if (!ui->glwidget->LoadModel(filename))
-      QMessageBox::warning(this, tr("Error"),
-                           tr("The file could not be opened"));
+    ui->actionLoad->setEnabled(false);
+    ui->actionGenerate->setEnabled(false);
+    ui->Progress_Load->setValue(0);
+    ui->LoadOptions->show();
+    ui->glwidget->LoadModelAsync(filename);
   }
 }
 
+void MainWindow::on_actionGenerate_triggered() {
+  const QStringList kShapes = {"uvsphere", "icosphere", "cubesphere",
+                               "plane",    "torus",     "box"};
+  bool ok = false;
+  const QString kShape = QInputDialog::getItem(
+      this, tr("Generate model"), tr("Shape:"), kShapes, 0, false, &ok);
+  if (!ok) return;
+  const int kResolution = QInputDialog::getInt(
+      this, tr("Generate model"), tr("Resolution:"), 256, 1,
+      int(data_representation::kMaxResolution), 1, &ok);
+  if (!ok) return;
+
+  ui->actionLoad->setEnabled(false);
+  ui->actionGenerate->setEnabled(false);
+  ui->Progress_Load->setValue(0);
+  ui->LoadOptions->show();
+  ui->glwidget->LoadModelAsync(
+      QString("%1_%2.null").arg(kShape).arg(kResolution));
+}
+
+void MainWindow::on_glwidget_LoadFinished(bool loaded, bool cancelled) {
+  ui->LoadOptions->hide();
+  ui->actionLoad->setEnabled(true);
+  ui->actionGenerate->setEnabled(true);
+  if (!loaded && !cancelled)
+    QMessageBox::warning(this, tr("Error"),
+                         tr("The file could not be opened"));
+}
+
 void MainWindow::on_actionLoad_Specular_triggered() {
   QString dir =
       QFileDialog::getExistingDirectory(this, "Specular CubeMap folder.", "./");
@@ -27,10 +27,23 @@ class MainWindow : public QMainWindow {
   void on_actionQuit_triggered();
 
   /**
-   * @brief on_actionLoad_triggered Opens a file dialog to load a PLY mesh.
+   * @brief on_actionLoad_triggered Opens a file dialog to load a PLY mesh in
+   * the background.
    */
   void on_actionLoad_triggered();
 
+  /**
+   * @brief on_actionGenerate_triggered Asks for a shape and a resolution and
+   * generates the model in the background.
+   */
+  void on_actionGenerate_triggered();
+
+  /**
+   * @brief on_glwidget_LoadFinished Hides the load progress and reports
+   * models that could not be opened.
+   */
+  void on_glwidget_LoadFinished(bool loaded, bool cancelled);
+
   /**
    * @brief on_actionLoad_Specular_triggered Opens a file dialog to load a cube
    * map that will be used for the specular component.
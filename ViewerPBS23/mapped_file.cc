@@ -0,0 +1,51 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mapped_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace data_representation {
+
+MappedFile::MappedFile() : data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+bool MappedFile::Open(const std::string &filename) {
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+
+  const size_t kSize = static_cast<size_t>(info.st_size);
+  void *address = mmap(nullptr, kSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (address == MAP_FAILED) return false;
+
+  // The loaders walk the file front to back exactly once.
+  madvise(address, kSize, MADV_SEQUENTIAL);
+  madvise(address, kSize, MADV_WILLNEED);
+
+  data_ = static_cast<const char *>(address);
+  size_ = kSize;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // namespace data_representation
@@ -0,0 +1,60 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace data_representation {
+
+/**
+ * @brief The MappedFile class Read-only memory mapping of a whole file. The
+ * mapping is released when the object is destroyed or Close is called.
+ */
+class MappedFile {
+ public:
+  /**
+   * @brief MappedFile Constructor of the class. Nothing is mapped.
+   */
+  MappedFile();
+
+  /**
+   * @brief ~MappedFile Destructor of the class. Calls Close.
+   */
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /**
+   * @brief Open Maps the file at the path filename. Any previous mapping is
+   * released first.
+   * @param filename The path to the file.
+   * @return Whether it was able to map the file.
+   */
+  bool Open(const std::string &filename);
+
+  /**
+   * @brief Close Releases the current mapping, if any.
+   */
+  void Close();
+
+  /**
+   * @brief data First byte of the mapping, nullptr if nothing is mapped.
+   */
+  const char *data() const { return data_; }
+
+  /**
+   * @brief size Size in bytes of the mapping.
+   */
+  size_t size() const { return size_; }
+
+ private:
+  const char *data_;
+  size_t size_;
+};
+
+}  // namespace data_representation
+
+#endif  // MAPPED_FILE_H_
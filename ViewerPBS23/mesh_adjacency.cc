@@ -0,0 +1,81 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_adjacency.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many corners or vertices per thread a pass is not worth a thread.
+const size_t kMinItems = 1 << 15;
+
+}  // namespace
+
+void VertexAdjacency::Clear() {
+  std::vector<uint32_t>().swap(offsets);
+  std::vector<uint32_t>().swap(corners);
+}
+
+bool BuildVertexAdjacency(const std::vector<int> &faces, size_t vertices,
+                          VertexAdjacency *adjacency) {
+  adjacency->Clear();
+  // A trailing incomplete face is no face at all.
+  const size_t kCorners = faces.size() / 3 * 3;
+  if (kCorners > std::numeric_limits<uint32_t>::max()) return false;
+
+  // On a single thread the cursors are bumped without read-modify-write
+  // instructions, and the rows come out sorted.
+  const bool kShared = RangeCount(kCorners, kMinItems) > 1;
+  std::unique_ptr<std::atomic<uint32_t>[]> cursors(
+      new std::atomic<uint32_t>[vertices]);
+  auto bump = [&](int v) {
+    if (kShared) return cursors[v].fetch_add(1, std::memory_order_relaxed);
+    const uint32_t kCursor = cursors[v].load(std::memory_order_relaxed);
+    cursors[v].store(kCursor + 1, std::memory_order_relaxed);
+    return kCursor;
+  };
+  for (size_t v = 0; v < vertices; ++v)
+    cursors[v].store(0, std::memory_order_relaxed);
+  ParallelFor(kCorners, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      if (faces[c] >= 0 && size_t(faces[c]) < vertices) bump(faces[c]);
+    }
+  });
+
+  adjacency->offsets.resize(vertices + 1);
+  uint32_t offset = 0;
+  for (size_t v = 0; v < vertices; ++v) {
+    adjacency->offsets[v] = offset;
+    offset += cursors[v].load(std::memory_order_relaxed);
+    cursors[v].store(adjacency->offsets[v], std::memory_order_relaxed);
+  }
+  adjacency->offsets[vertices] = offset;
+
+  adjacency->corners.resize(offset);
+  ParallelFor(kCorners, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      if (faces[c] < 0 || size_t(faces[c]) >= vertices) continue;
+      adjacency->corners[bump(faces[c])] = static_cast<uint32_t>(c);
+    }
+  });
+
+  // Threads fill the rows in any order; sorting them makes the adjacency,
+  // and any sum over it, independent of the number of threads.
+  if (!kShared) return true;
+  ParallelFor(vertices, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      std::sort(adjacency->corners.begin() + adjacency->offsets[v],
+                adjacency->corners.begin() + adjacency->offsets[v + 1]);
+    }
+  });
+  return true;
+}
+
+}  // namespace data_representation
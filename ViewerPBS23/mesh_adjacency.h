@@ -0,0 +1,55 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_ADJACENCY_H_
+#define MESH_ADJACENCY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief The VertexAdjacency struct The faces around every vertex in
+ * compressed rows: the face corners that reference vertex v are
+ * corners[offsets[v]] to corners[offsets[v + 1] - 1], in increasing order.
+ * A corner c is the item c of the faces array, so it belongs to the face
+ * c / 3 and is its corner c % 3. Two arrays hold the whole structure, instead
+ * of one allocation per vertex.
+ */
+struct VertexAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> corners;
+
+  bool empty() const { return offsets.empty(); }
+
+  /**
+   * @brief Clear Releases both arrays.
+   */
+  void Clear();
+
+  /**
+   * @brief Degree Number of face corners that reference vertex v.
+   */
+  size_t Degree(size_t v) const { return offsets[v + 1] - offsets[v]; }
+
+  static size_t Face(uint32_t corner) { return corner / 3; }
+};
+
+/**
+ * @brief BuildVertexAdjacency Builds the adjacency of faces with a counting
+ * sort: corners are counted per vertex and scattered into their rows on all
+ * threads, and the rows are sorted afterwards if more than one thread filled
+ * them. Corners that reference no vertex are left out.
+ * @param faces Three vertex indices per triangle.
+ * @param vertices Number of vertices.
+ * @param adjacency The result.
+ * @return Whether the corners can be numbered in 32 bits. adjacency is left
+ * empty otherwise.
+ */
+bool BuildVertexAdjacency(const std::vector<int> &faces, size_t vertices,
+                          VertexAdjacency *adjacency);
+
+}  // namespace data_representation
+
+#endif  // MESH_ADJACENCY_H_
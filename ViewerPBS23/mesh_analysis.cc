@@ -0,0 +1,237 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_analysis.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many vertices or faces per thread a pass is not worth a thread.
+const size_t kMinItems = 1 << 16;
+
+// Triangles whose sine between two of their edges is below this are counted
+// as zero area. It is relative, so it does not depend on the model scale.
+const double kMinSine = 1e-6;
+
+// Bounding box and, for every axis, the vertices with the smallest and the
+// largest coordinate along it.
+struct Extremes {
+  Eigen::Vector3f min;
+  Eigen::Vector3f max;
+  size_t min_vertex[3];
+  size_t max_vertex[3];
+};
+
+struct FaceStats {
+  double area;
+  size_t degenerate;
+  size_t zero_area;
+};
+
+struct Sphere {
+  Eigen::Vector3d center;
+  double radius;
+};
+
+Eigen::Vector3d Position(const std::vector<float> &vertices, size_t v) {
+  return Eigen::Vector3d(vertices[v * 3], vertices[v * 3 + 1],
+                         vertices[v * 3 + 2]);
+}
+
+Extremes FindExtremes(const std::vector<float> &vertices, size_t first,
+                      size_t last) {
+  Extremes extremes;
+  extremes.min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+  extremes.max =
+      Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+  for (int k = 0; k < 3; ++k)
+    extremes.min_vertex[k] = extremes.max_vertex[k] = first;
+  for (size_t v = first; v < last; ++v) {
+    const float *kPosition = &vertices[v * 3];
+    for (int k = 0; k < 3; ++k) {
+      if (kPosition[k] < extremes.min[k]) {
+        extremes.min[k] = kPosition[k];
+        extremes.min_vertex[k] = v;
+      }
+      if (kPosition[k] > extremes.max[k]) {
+        extremes.max[k] = kPosition[k];
+        extremes.max_vertex[k] = v;
+      }
+    }
+  }
+  return extremes;
+}
+
+// Smallest sphere containing a and b.
+Sphere Merge(const Sphere &a, const Sphere &b) {
+  const Eigen::Vector3d kOffset = b.center - a.center;
+  const double kDistance = kOffset.norm();
+  if (kDistance + b.radius <= a.radius) return a;
+  if (kDistance + a.radius <= b.radius) return b;
+  const double kRadius = (kDistance + a.radius + b.radius) / 2.0;
+  return {a.center + kOffset * ((kRadius - a.radius) / kDistance), kRadius};
+}
+
+}  // namespace
+
+void AnalyzeMesh(const std::vector<float> &vertices,
+                 const std::vector<int> &faces, TriangleMesh *mesh) {
+  const size_t kVertices = vertices.size() / 3;
+  mesh->area_ = 0.0;
+  mesh->degenerateFaces_ = 0;
+  mesh->zeroAreaFaces_ = 0;
+  mesh->unreferencedVertices_ = 0;
+  if (kVertices == 0) {
+    mesh->center_ = Eigen::Vector3f::Zero();
+    mesh->radius_ = 0.0f;
+    return;
+  }
+
+  // Pass 1: bounding box and extreme points.
+  std::vector<Extremes> range_extremes(RangeCount(kVertices, kMinItems));
+  ParallelFor(kVertices, kMinItems, [&](size_t range, size_t first,
+                                        size_t last) {
+    range_extremes[range] = FindExtremes(vertices, first, last);
+  });
+  Extremes extremes = range_extremes[0];
+  for (size_t r = 1; r < range_extremes.size(); ++r) {
+    for (int k = 0; k < 3; ++k) {
+      if (range_extremes[r].min[k] < extremes.min[k]) {
+        extremes.min[k] = range_extremes[r].min[k];
+        extremes.min_vertex[k] = range_extremes[r].min_vertex[k];
+      }
+      if (range_extremes[r].max[k] > extremes.max[k]) {
+        extremes.max[k] = range_extremes[r].max[k];
+        extremes.max_vertex[k] = range_extremes[r].max_vertex[k];
+      }
+    }
+  }
+  mesh->min_ = extremes.min;
+  mesh->max_ = extremes.max;
+
+  // Pass 2: area and degenerate faces, marking the referenced vertices.
+  // Several faces mark the same vertex, so the marks are relaxed atomics.
+  const size_t kFaces = faces.size() / 3;
+  std::unique_ptr<std::atomic<bool>[]> referenced;
+  if (kFaces > 0) {
+    referenced.reset(new std::atomic<bool>[kVertices]);
+    for (size_t v = 0; v < kVertices; ++v)
+      referenced[v].store(false, std::memory_order_relaxed);
+  }
+  std::vector<FaceStats> face_stats(RangeCount(kFaces, kMinItems),
+                                    FaceStats{0.0, 0, 0});
+  ParallelFor(kFaces, kMinItems, [&](size_t range, size_t first,
+                                     size_t last) {
+    FaceStats stats = {0.0, 0, 0};
+    for (size_t f = first; f < last; ++f) {
+      const int *kFace = &faces[f * 3];
+      bool in_range = true;
+      for (int k = 0; k < 3; ++k) {
+        in_range &= kFace[k] >= 0 && size_t(kFace[k]) < kVertices;
+        if (in_range)
+          referenced[kFace[k]].store(true, std::memory_order_relaxed);
+      }
+      if (!in_range || kFace[0] == kFace[1] || kFace[1] == kFace[2] ||
+          kFace[2] == kFace[0]) {
+        ++stats.degenerate;
+        continue;
+      }
+
+      const Eigen::Vector3d kA = Position(vertices, size_t(kFace[0]));
+      const Eigen::Vector3d kAB = Position(vertices, size_t(kFace[1])) - kA;
+      const Eigen::Vector3d kAC = Position(vertices, size_t(kFace[2])) - kA;
+      const double kCross = kAB.cross(kAC).norm();
+      stats.area += kCross / 2.0;
+      if (kCross <= kMinSine * kAB.norm() * kAC.norm()) ++stats.zero_area;
+    }
+    face_stats[range] = stats;
+  });
+  for (const FaceStats &stats : face_stats) {
+    mesh->area_ += stats.area;
+    mesh->degenerateFaces_ += stats.degenerate;
+    mesh->zeroAreaFaces_ += stats.zero_area;
+  }
+
+  // Pass 3: Ritter sphere, seeded with the most distant pair of extreme
+  // points, the farthest vertex from the center of the box, and unreferenced
+  // vertices.
+  const Eigen::Vector3d kBoxCenter =
+      (extremes.min.cast<double>() + extremes.max.cast<double>()) / 2.0;
+  Sphere seed = {Position(vertices, extremes.min_vertex[0]), 0.0};
+  for (int k = 0; k < 3; ++k) {
+    const Eigen::Vector3d kMin = Position(vertices, extremes.min_vertex[k]);
+    const Eigen::Vector3d kMax = Position(vertices, extremes.max_vertex[k]);
+    const double kRadius = (kMax - kMin).norm() / 2.0;
+    if (kRadius > seed.radius) seed = {(kMin + kMax) / 2.0, kRadius};
+  }
+  std::vector<Sphere> spheres(RangeCount(kVertices, kMinItems));
+  std::vector<double> box_distances(spheres.size(), 0.0);
+  std::vector<size_t> unreferenced(spheres.size(), 0);
+  ParallelFor(kVertices, kMinItems, [&](size_t range, size_t first,
+                                        size_t last) {
+    Sphere sphere = seed;
+    double box_distance = 0.0;
+    for (size_t v = first; v < last; ++v) {
+      if (referenced != nullptr &&
+          !referenced[v].load(std::memory_order_relaxed))
+        ++unreferenced[range];
+
+      const Eigen::Vector3d kPosition = Position(vertices, v);
+      box_distance =
+          std::max(box_distance, (kPosition - kBoxCenter).squaredNorm());
+
+      // A point outside moves the sphere towards it just enough to enclose
+      // both it and the old sphere.
+      const Eigen::Vector3d kOffset = kPosition - sphere.center;
+      const double kDistance = kOffset.norm();
+      if (kDistance <= sphere.radius) continue;
+      const double kRadius = (sphere.radius + kDistance) / 2.0;
+      sphere.center += kOffset * ((kRadius - sphere.radius) / kDistance);
+      sphere.radius = kRadius;
+    }
+    spheres[range] = sphere;
+    box_distances[range] = box_distance;
+  });
+  Sphere sphere = spheres[0];
+  for (size_t r = 1; r < spheres.size(); ++r)
+    sphere = Merge(sphere, spheres[r]);
+  for (size_t count : unreferenced) mesh->unreferencedVertices_ += count;
+
+  // Ritter can end up looser than the sphere centered on the box, for
+  // instance on flat grids, so keep the tighter one. Its radius is the
+  // distance to the farthest vertex, not half the box diagonal, which
+  // overestimates round models by up to sqrt(3).
+  const Sphere kBoxSphere = {
+      kBoxCenter,
+      std::sqrt(*std::max_element(box_distances.begin(),
+                                  box_distances.end()))};
+  if (kBoxSphere.radius < sphere.radius) sphere = kBoxSphere;
+
+  // The radius is rounded up and grown by the rounding of the center, so the
+  // float sphere still contains every vertex.
+  mesh->center_ = sphere.center.cast<float>();
+  const double kCenterError =
+      (sphere.center - mesh->center_.cast<double>()).norm();
+  mesh->radius_ = std::nextafter(float(sphere.radius + kCenterError),
+                                 std::numeric_limits<float>::max());
+}
+
+void FitSphereToBox(TriangleMesh *mesh) {
+  if (mesh->min_[0] > mesh->max_[0]) {
+    mesh->center_ = Eigen::Vector3f::Zero();
+    mesh->radius_ = 0.0f;
+    return;
+  }
+  mesh->center_ = (mesh->min_ + mesh->max_) / 2.0f;
+  mesh->radius_ = (mesh->max_ - mesh->min_).norm() / 2.0f;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,41 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_ANALYSIS_H_
+#define MESH_ANALYSIS_H_
+
+#include <triangle_mesh.h>
+
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief AnalyzeMesh Computes the bounds and statistics of a mesh in three
+ * parallel passes over its arrays: one over the vertices for the bounding box
+ * and the extreme points along every axis, one over the faces for the surface
+ * area and the degenerate triangles, and a last one over the vertices that
+ * grows a Ritter sphere from the two most distant extreme points. Every range
+ * of vertices grows its own sphere and the spheres are merged, so the result
+ * is a bounding sphere slightly looser than a serial Ritter pass. The same
+ * pass finds the farthest vertex from the center of the bounding box, and the
+ * sphere centered there through it is used instead when it is tighter.
+ * @param vertices Three coordinates per vertex. They are passed apart from
+ * mesh because some loaders keep them out of it.
+ * @param faces Three vertex indices per triangle, possibly empty.
+ * @param mesh Receives min_, max_, center_, radius_, area_,
+ * degenerateFaces_, zeroAreaFaces_ and unreferencedVertices_.
+ */
+void AnalyzeMesh(const std::vector<float> &vertices,
+                 const std::vector<int> &faces, TriangleMesh *mesh);
+
+/**
+ * @brief FitSphereToBox Sets the bounding sphere of mesh to the sphere
+ * circumscribed to its bounding box, for meshes whose vertices are not
+ * available to AnalyzeMesh.
+ * @param mesh A mesh with its min_ and max_ set.
+ */
+void FitSphereToBox(TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_ANALYSIS_H_
@@ -0,0 +1,247 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_cache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./mapped_file.h"
+#include "./mesh_analysis.h"
+#include "./mesh_codec.h"
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+const char kMagic[8] = {'P', 'B', 'S', 'M', 'E', 'S', 'H', '\0'};
+
+// Bump whenever the layout or the post-processing of the loaders changes, so
+// stale caches are rebuilt instead of loaded.
+const uint32_t kVersion = 8;
+
+// Size of the blocks the source is hashed in. It is fixed, so the hash does
+// not depend on the number of threads.
+const size_t kHashBlock = 1 << 20;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t source_hash;
+  uint64_t vertices;
+  uint64_t normals;
+  uint64_t tex_coords;
+  uint64_t colors;
+  uint64_t quality;
+  uint64_t faces;
+  uint64_t unwelded_vertices;
+  uint64_t materials;
+  uint64_t encoded;
+  float point_spacing;
+};
+
+// Offsets of the compressed mesh and the material ranges that follow the
+// header, and total file size.
+struct CacheLayout {
+  size_t encoded;
+  size_t materials;
+  size_t size;
+};
+
+CacheLayout ComputeLayout(const CacheHeader &header) {
+  CacheLayout layout;
+  layout.encoded = sizeof(header);
+  layout.materials = layout.encoded + header.encoded;
+  layout.size = layout.materials + header.materials;
+  return layout;
+}
+
+uint64_t Mix(uint64_t hash) {
+  hash ^= hash >> 31;
+  hash *= 0x7FB5D329728EA185ull;
+  hash ^= hash >> 27;
+  hash *= 0x81DADEF4BC2DD44Dull;
+  return hash ^ (hash >> 33);
+}
+
+// Hashes a block with four independent lanes so the multiplications overlap.
+uint64_t HashBlock(const char *data, size_t size) {
+  const uint64_t kPrime = 0x9E3779B97F4A7C15ull;
+  uint64_t lanes[4] = {1, 2, 3, 4};
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    for (size_t l = 0; l < 4; ++l) {
+      uint64_t word;
+      memcpy(&word, data + i + l * 8, 8);
+      lanes[l] = (lanes[l] ^ word) * kPrime;
+    }
+  }
+  uint64_t hash = Mix(lanes[0]) ^ Mix(lanes[1] + 1) ^ Mix(lanes[2] + 2) ^
+                  Mix(lanes[3] + 3);
+  for (; i < size; ++i) hash = (hash ^ uint8_t(data[i])) * kPrime;
+  return Mix(hash);
+}
+
+// Material ranges are stored as their first and count followed by the size
+// and the characters of their diffuse map.
+std::string EncodeMaterials(
+    const std::vector<TriangleMesh::MaterialRange> &ranges) {
+  std::string encoded;
+  for (const TriangleMesh::MaterialRange &range : ranges) {
+    const uint64_t kFields[3] = {range.first, range.count,
+                                 range.diffuse_map.size()};
+    encoded.append(reinterpret_cast<const char *>(kFields), sizeof(kFields));
+    encoded.append(range.diffuse_map);
+  }
+  return encoded;
+}
+
+bool DecodeMaterials(const char *data, size_t size, size_t faces,
+                     std::vector<TriangleMesh::MaterialRange> *ranges) {
+  const char *end = data + size;
+  while (data < end) {
+    uint64_t fields[3];
+    if (static_cast<size_t>(end - data) < sizeof(fields)) return false;
+    memcpy(fields, data, sizeof(fields));
+    data += sizeof(fields);
+    if (fields[2] > static_cast<size_t>(end - data) || fields[0] > faces ||
+        fields[1] > faces - fields[0])
+      return false;
+    TriangleMesh::MaterialRange range;
+    range.first = fields[0];
+    range.count = fields[1];
+    range.diffuse_map.assign(data, fields[2]);
+    data += fields[2];
+    ranges->push_back(range);
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string CacheFilename(const std::string &filename) {
+  return filename + ".cache";
+}
+
+bool HashSourceFile(const std::string &filename, uint64_t *hash) {
+  MappedFile file;
+  if (!file.Open(filename)) return false;
+
+  const size_t kBlocks = (file.size() + kHashBlock - 1) / kHashBlock;
+  std::vector<uint64_t> block_hashes(kBlocks);
+  ParallelFor(kBlocks, 16, [&](size_t, size_t first, size_t last) {
+    for (size_t b = first; b < last; ++b) {
+      const size_t kBegin = b * kHashBlock;
+      const size_t kSize = std::min(kHashBlock, file.size() - kBegin);
+      block_hashes[b] = HashBlock(file.data() + kBegin, kSize);
+    }
+  });
+
+  uint64_t result = Mix(file.size());
+  for (uint64_t block_hash : block_hashes) result = Mix(result ^ block_hash);
+  *hash = result;
+  return true;
+}
+
+bool ReadFromCache(const std::string &filename, uint64_t source_hash,
+                   TriangleMesh *mesh) {
+  MappedFile file;
+  if (!file.Open(CacheFilename(filename))) return false;
+  if (file.size() < sizeof(CacheHeader)) return false;
+
+  CacheHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.header_size != sizeof(header) ||
+      header.source_hash != source_hash) {
+    return false;
+  }
+
+  // Sizes larger than the file would overflow the layout computation.
+  const bool kCountsFit =
+      header.encoded < file.size() && header.materials < file.size();
+  const CacheLayout kLayout = ComputeLayout(header);
+  if (!kCountsFit || kLayout.size != file.size()) {
+    std::cerr << "Corrupted cache file " << CacheFilename(filename)
+              << std::endl;
+    return false;
+  }
+
+  mesh->Clear();
+  const bool kDecoded =
+      DecodeMesh(file.data() + kLayout.encoded, header.encoded, mesh) &&
+      mesh->vertices_.size() == header.vertices &&
+      mesh->normals_.size() == header.normals &&
+      mesh->texCoords_.size() == header.tex_coords &&
+      mesh->colors_.size() == header.colors &&
+      mesh->quality_.size() == header.quality &&
+      mesh->faces_.size() == header.faces;
+  if (!kDecoded ||
+      !DecodeMaterials(file.data() + kLayout.materials, header.materials,
+                       header.faces, &mesh->materialRanges_)) {
+    std::cerr << "Corrupted cache file " << CacheFilename(filename)
+              << std::endl;
+    mesh->Clear();
+    return false;
+  }
+  mesh->unweldedVertices_ = header.unwelded_vertices;
+  mesh->pointSpacing_ = header.point_spacing;
+  // The bounds and statistics are recomputed rather than stored, so they
+  // describe the quantized positions that are actually drawn.
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+bool WriteToCache(const std::string &filename, uint64_t source_hash,
+                  const TriangleMesh &mesh) {
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.header_size = sizeof(header);
+  header.source_hash = source_hash;
+  header.vertices = mesh.vertices_.size();
+  header.normals = mesh.normals_.size();
+  header.tex_coords = mesh.texCoords_.size();
+  header.colors = mesh.colors_.size();
+  header.quality = mesh.quality_.size();
+  header.faces = mesh.faces_.size();
+  header.unwelded_vertices = mesh.unweldedVertices_;
+  header.point_spacing = mesh.pointSpacing_;
+  const std::string kMaterials = EncodeMaterials(mesh.materialRanges_);
+  header.materials = kMaterials.size();
+  std::vector<char> encoded;
+  if (!EncodeMesh(mesh, MeshCodecOptions(), &encoded)) return false;
+  header.encoded = encoded.size();
+
+  const CacheLayout kLayout = ComputeLayout(header);
+
+  // The whole file is assembled in memory and handed to the OS in one write.
+  std::vector<char> buffer(kLayout.size, 0);
+  char *out = buffer.data();
+  memcpy(out, &header, sizeof(header));
+  memcpy(out + kLayout.encoded, encoded.data(), header.encoded);
+  memcpy(out + kLayout.materials, kMaterials.data(), header.materials);
+
+  const std::string kCache = CacheFilename(filename);
+  const std::string kTemporary = kCache + ".tmp";
+  std::ofstream fout(kTemporary.c_str(),
+                     std::ios_base::out | std::ios_base::binary);
+  if (!fout.is_open()) return false;
+  fout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  fout.close();
+
+  if (!fout.good() || std::rename(kTemporary.c_str(), kCache.c_str()) != 0) {
+    std::remove(kTemporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace data_representation
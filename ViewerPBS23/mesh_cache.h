@@ -0,0 +1,58 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_CACHE_H_
+#define MESH_CACHE_H_
+
+#include <triangle_mesh.h>
+
+#include <cstdint>
+#include <string>
+
+namespace data_representation {
+
+/**
+ * @brief CacheFilename Path of the cache file of the model at filename. It is
+ * stored next to the source.
+ */
+std::string CacheFilename(const std::string &filename);
+
+/**
+ * @brief HashSourceFile Hashes the contents of the model at filename, so a
+ * cache can tell whether it was built from the current version of the file.
+ * @param filename The path to the model.
+ * @param hash The resulting hash.
+ * @return Whether it was able to read the file.
+ */
+bool HashSourceFile(const std::string &filename, uint64_t *hash);
+
+/**
+ * @brief ReadFromCache Loads the post-processed mesh (vertices, normals,
+ * texture coordinates, faces, material ranges, point spacing and bounding
+ * box) stored in the cache file of the model at filename. The cache file is
+ * memory mapped and its arrays are decompressed in parallel with DecodeMesh;
+ * nothing is parsed or recomputed.
+ * @param filename The path to the model, not to the cache file.
+ * @param source_hash The hash of the current contents of the model.
+ * @param mesh The resulting representation.
+ * @return Whether there is a valid cache built from the same contents.
+ */
+bool ReadFromCache(const std::string &filename, uint64_t source_hash,
+                   TriangleMesh *mesh);
+
+/**
+ * @brief WriteToCache Stores mesh in the cache file of the model at filename,
+ * compressed with EncodeMesh: the cached attributes are quantized and the
+ * vertices renumbered, the faces and material ranges are kept as they are.
+ * The file is written under a temporary name and renamed when complete, so a
+ * reader never maps a partial cache.
+ * @param filename The path to the model, not to the cache file.
+ * @param source_hash The hash of the contents mesh was loaded from.
+ * @param mesh The post-processed mesh.
+ * @return Whether it was able to store the file.
+ */
+bool WriteToCache(const std::string &filename, uint64_t source_hash,
+                  const TriangleMesh &mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_CACHE_H_
@@ -0,0 +1,747 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_codec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define MESH_CODEC_SSSE3 1
+#endif
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+const char kMagic[4] = {'P', 'B', 'S', 'Z'};
+const uint32_t kVersion = 2;
+
+// Values per block. Blocks are coded independently, so they are encoded and
+// decoded in parallel, and one block is as much as a thread decodes at once.
+const size_t kBlockValues = 1 << 16;
+
+// Vertices per thread below which dequantizing is not worth a thread.
+const size_t kMinVertices = 1 << 16;
+
+// Varint payloads smaller than this are stored without entropy coding; the
+// frequency table would not pay for itself.
+const size_t kMinCodedBytes = 4096;
+
+// rANS state lower bound and frequency precision. The state is renormalized a
+// byte at a time.
+const uint32_t kRansLow = 1u << 23;
+const int kRansScaleBits = 12;
+const uint32_t kRansScale = 1u << kRansScaleBits;
+const size_t kRansStates = 4;
+
+// The encoded mesh is a sequence of integer streams, each split in blocks.
+enum Stream {
+  kPositionX,
+  kPositionY,
+  kPositionZ,
+  kNormalU,
+  kNormalV,
+  kTexCoordS,
+  kTexCoordT,
+  kColorR,
+  kColorG,
+  kColorB,
+  kColorA,
+  kQuality,
+  kIndices,
+  kStreams
+};
+
+const uint32_t kHasNormals = 1;
+const uint32_t kHasTexCoords = 2;
+const uint32_t kHasColors = 4;
+const uint32_t kHasQuality = 8;
+
+struct CodecHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t vertices;
+  uint64_t corners;
+  uint32_t flags;
+  uint8_t position_bits;
+  uint8_t normal_bits;
+  uint8_t tex_coord_bits;
+  uint8_t quality_bits;
+  float position_min[3];
+  float position_scale[3];
+  float tex_coord_min[2];
+  float tex_coord_scale[2];
+  float quality_min;
+  float quality_scale;
+};
+
+struct BlockHeader {
+  uint32_t values;
+  // Number of vertices the faces had used before the block; only meaningful
+  // for the index stream.
+  uint32_t base;
+  // Size of the varints, and of their rANS coding or 0 if they are stored as
+  // they are.
+  uint32_t raw_bytes;
+  uint32_t coded_bytes;
+};
+
+// Lookup tables to decode the four varints described by a control byte.
+struct VarintTables {
+  VarintTables() {
+    for (int c = 0; c < 256; ++c) {
+      int offset = 0;
+      for (int k = 0; k < 4; ++k) {
+        const int kLength = ((c >> (k * 2)) & 3) + 1;
+        for (int b = 0; b < 4; ++b)
+          shuffle[c][k * 4 + b] = b < kLength ? uint8_t(offset + b) : 0x80;
+        offset += kLength;
+      }
+      lengths[c] = uint8_t(offset);
+    }
+  }
+
+  uint8_t shuffle[256][16];
+  uint8_t lengths[256];
+};
+
+const VarintTables &Tables() {
+  static const VarintTables kTables;
+  return kTables;
+}
+
+uint32_t ZigZag(int32_t value) {
+  return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+uint32_t UnZigZag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+uint32_t Levels(int bits) { return (1u << bits) - 1; }
+
+uint32_t Quantize(float value, float min, float scale, uint32_t levels) {
+  if (scale <= 0.0f) return 0;
+  const float kLevel = std::round((value - min) / scale);
+  return uint32_t(std::min(std::max(kLevel, 0.0f), float(levels)));
+}
+
+// Minimum and step of every coordinate of values, so that their range is
+// split in levels steps.
+void QuantizationRange(const std::vector<float> &values, size_t width,
+                       uint32_t levels, float *min, float *scale) {
+  for (size_t c = 0; c < width; ++c) {
+    float max = values.empty() ? 0.0f : values[c];
+    min[c] = max;
+    for (size_t i = c; i < values.size(); i += width) {
+      min[c] = std::min(min[c], values[i]);
+      max = std::max(max, values[i]);
+    }
+    scale[c] = max > min[c] ? (max - min[c]) / float(levels) : 0.0f;
+  }
+}
+
+float Sign(float value) { return value < 0.0f ? -1.0f : 1.0f; }
+
+// Octahedral projection of a normal to [-1, 1]^2. Zero normals map to +z.
+void EncodeOctahedral(const float *normal, float *u, float *v) {
+  const float kL1 =
+      std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+  if (!(kL1 > 0.0f)) {
+    *u = *v = 0.0f;
+    return;
+  }
+  const float kX = normal[0] / kL1;
+  const float kY = normal[1] / kL1;
+  if (normal[2] >= 0.0f) {
+    *u = kX;
+    *v = kY;
+  } else {
+    *u = (1.0f - std::abs(kY)) * Sign(kX);
+    *v = (1.0f - std::abs(kX)) * Sign(kY);
+  }
+}
+
+void DecodeOctahedral(float u, float v, float *normal) {
+  float x = u;
+  float y = v;
+  const float kZ = 1.0f - std::abs(u) - std::abs(v);
+  if (kZ < 0.0f) {
+    x = (1.0f - std::abs(v)) * Sign(u);
+    y = (1.0f - std::abs(u)) * Sign(v);
+  }
+  const float kLength = std::sqrt(x * x + y * y + kZ * kZ);
+  normal[0] = x / kLength;
+  normal[1] = y / kLength;
+  normal[2] = kZ / kLength;
+}
+
+// Stores values as one control byte per four values, with two bits holding
+// the byte length - 1 of each, followed by the little endian bytes of all of
+// them.
+void PackVarints(const uint32_t *values, size_t count,
+                 std::vector<uint8_t> *out) {
+  const size_t kControls = (count + 3) / 4;
+  out->assign(kControls, 0);
+  out->reserve(kControls + count * 4);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t kValue = values[i];
+    const int kLength = kValue < (1u << 8)    ? 1
+                        : kValue < (1u << 16) ? 2
+                        : kValue < (1u << 24) ? 3
+                                              : 4;
+    (*out)[i / 4] |= uint8_t((kLength - 1) << ((i % 4) * 2));
+    for (int b = 0; b < kLength; ++b)
+      out->push_back(uint8_t(kValue >> (8 * b)));
+  }
+}
+
+// Decodes values from the first index on, undoing the zigzag and delta
+// transforms if delta is set. previous is the last value decoded before.
+void UnpackVarints(const uint8_t *controls, const uint8_t *data, size_t first,
+                   size_t count, bool delta, uint32_t previous,
+                   uint32_t *values) {
+  for (size_t i = first; i < count; ++i) {
+    const int kLength = ((controls[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+    uint32_t value = 0;
+    for (int b = 0; b < kLength; ++b) value |= uint32_t(data[b]) << (8 * b);
+    data += kLength;
+    if (delta) value = previous += UnZigZag(value);
+    values[i] = value;
+  }
+}
+
+#ifdef MESH_CODEC_SSSE3
+// Decodes groups of four values with one shuffle each, and the zigzag and
+// prefix sum of deltas in registers. data must be readable 16 bytes past the
+// last varint. Returns the data of the first value not decoded.
+__attribute__((target("ssse3"))) const uint8_t *UnpackGroupsSsse3(
+    const uint8_t *controls, const uint8_t *data, size_t groups, bool delta,
+    uint32_t *values) {
+  const VarintTables &kTables = Tables();
+  const __m128i kOne = _mm_set1_epi32(1);
+  __m128i carry = _mm_setzero_si128();
+  for (size_t g = 0; g < groups; ++g) {
+    const uint8_t kControl = controls[g];
+    __m128i group = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(kTables.shuffle[kControl])));
+    data += kTables.lengths[kControl];
+    if (delta) {
+      group = _mm_xor_si128(
+          _mm_srli_epi32(group, 1),
+          _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(group, kOne)));
+      group = _mm_add_epi32(group, _mm_slli_si128(group, 4));
+      group = _mm_add_epi32(group, _mm_slli_si128(group, 8));
+      group = _mm_add_epi32(group, carry);
+      carry = _mm_shuffle_epi32(group, 0xFF);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + g * 4), group);
+  }
+  return data;
+}
+
+bool HasSsse3() {
+  static const bool kHasSsse3 = __builtin_cpu_supports("ssse3");
+  return kHasSsse3;
+}
+#endif
+
+// Scales the byte frequencies of data to sum kRansScale, keeping every byte
+// that occurs at a frequency of at least one.
+void NormalizeFrequencies(const uint8_t *data, size_t size, uint16_t *freqs) {
+  uint64_t counts[256] = {0};
+  for (size_t i = 0; i < size; ++i) ++counts[data[i]];
+
+  uint32_t total = 0;
+  for (int s = 0; s < 256; ++s) {
+    freqs[s] = 0;
+    if (counts[s] == 0) continue;
+    freqs[s] = uint16_t(
+        std::max<uint64_t>(1, counts[s] * kRansScale / uint64_t(size)));
+    total += freqs[s];
+  }
+
+  // Rounding is corrected on the most frequent bytes, where it costs least.
+  while (total != kRansScale) {
+    int largest = 0;
+    for (int s = 1; s < 256; ++s) {
+      if (freqs[s] > freqs[largest]) largest = s;
+    }
+    if (total > kRansScale) {
+      const uint32_t kExcess =
+          std::min<uint32_t>(total - kRansScale, freqs[largest] / 2u);
+      const uint32_t kStep = std::max<uint32_t>(kExcess, 1);
+      freqs[largest] = uint16_t(freqs[largest] - kStep);
+      total -= kStep;
+    } else {
+      freqs[largest] = uint16_t(freqs[largest] + (kRansScale - total));
+      total = kRansScale;
+    }
+  }
+}
+
+// Symbol i is coded by state i % kRansStates, so the decoder has independent
+// dependency chains to overlap. Symbols are encoded in reverse into one byte
+// stream, so the decoder reads it forwards.
+void RansEncode(const uint8_t *data, size_t size, const uint16_t *freqs,
+                std::vector<uint8_t> *out) {
+  uint32_t cumulative[256];
+  uint32_t sum = 0;
+  for (int s = 0; s < 256; ++s) {
+    cumulative[s] = sum;
+    sum += freqs[s];
+  }
+
+  out->clear();
+  uint32_t states[kRansStates];
+  std::fill(states, states + kRansStates, kRansLow);
+  for (size_t i = size; i > 0; --i) {
+    uint32_t &state = states[(i - 1) % kRansStates];
+    const uint8_t kSymbol = data[i - 1];
+    const uint32_t kFreq = freqs[kSymbol];
+    const uint32_t kMax = ((kRansLow >> kRansScaleBits) << 8) * kFreq;
+    while (state >= kMax) {
+      out->push_back(uint8_t(state));
+      state >>= 8;
+    }
+    state = ((state / kFreq) << kRansScaleBits) + state % kFreq +
+            cumulative[kSymbol];
+  }
+  for (size_t k = kRansStates; k > 0; --k) {
+    for (int b = 0; b < 4; ++b)
+      out->push_back(uint8_t(states[k - 1] >> (8 * b)));
+  }
+  std::reverse(out->begin(), out->end());
+}
+
+// Everything the decoder needs for the symbol of a slot.
+struct RansSlot {
+  uint16_t freq;
+  uint16_t bias;
+  uint8_t symbol;
+};
+
+bool RansDecode(const uint8_t *data, size_t size, const uint16_t *freqs,
+                size_t count, uint8_t *out) {
+  std::vector<RansSlot> slots(kRansScale);
+  uint32_t sum = 0;
+  for (int s = 0; s < 256; ++s) {
+    if (freqs[s] > kRansScale - sum) return false;
+    for (uint32_t f = 0; f < freqs[s]; ++f)
+      slots[sum + f] = {freqs[s], uint16_t(f), uint8_t(s)};
+    sum += freqs[s];
+  }
+  if (sum != kRansScale || size < 4 * kRansStates) return false;
+
+  const uint8_t *end = data + size;
+  uint32_t states[kRansStates];
+  for (size_t k = 0; k < kRansStates; ++k, data += 4) {
+    states[k] = uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 |
+                uint32_t(data[2]) << 8 | data[3];
+  }
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t &state = states[i % kRansStates];
+    const RansSlot kSlot = slots[state & (kRansScale - 1)];
+    out[i] = kSlot.symbol;
+    state = kSlot.freq * (state >> kRansScaleBits) + kSlot.bias;
+    while (state < kRansLow) {
+      if (data == end) return false;
+      state = state << 8 | *data++;
+    }
+  }
+  return data == end;
+}
+
+void AppendBytes(const void *data, size_t size, std::vector<char> *out) {
+  const char *kBytes = static_cast<const char *>(data);
+  out->insert(out->end(), kBytes, kBytes + size);
+}
+
+void EncodeBlock(const uint32_t *values, size_t count, uint32_t base,
+                 std::vector<char> *out) {
+  std::vector<uint8_t> raw;
+  PackVarints(values, count, &raw);
+
+  BlockHeader header = {uint32_t(count), base, uint32_t(raw.size()), 0};
+  uint16_t freqs[256];
+  std::vector<uint8_t> coded;
+  if (raw.size() >= kMinCodedBytes) {
+    NormalizeFrequencies(raw.data(), raw.size(), freqs);
+    RansEncode(raw.data(), raw.size(), freqs, &coded);
+    if (coded.size() + sizeof(freqs) < raw.size())
+      header.coded_bytes = uint32_t(coded.size());
+  }
+
+  out->clear();
+  AppendBytes(&header, sizeof(header), out);
+  if (header.coded_bytes > 0) {
+    AppendBytes(freqs, sizeof(freqs), out);
+    AppendBytes(coded.data(), coded.size(), out);
+  } else {
+    AppendBytes(raw.data(), raw.size(), out);
+  }
+}
+
+// Decodes the count values of a block into values. The varints are first
+// expanded into a buffer with room for the 16 byte loads of the SSSE3 path.
+bool DecodeBlock(const char *data, size_t size, size_t count, bool delta,
+                 uint32_t *values, uint32_t *base) {
+  BlockHeader header;
+  if (size < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  data += sizeof(header);
+  size -= sizeof(header);
+
+  const size_t kControls = (count + 3) / 4;
+  if (header.values != count || header.raw_bytes < kControls ||
+      header.raw_bytes - kControls > count * 4) {
+    return false;
+  }
+  std::vector<uint8_t> raw(header.raw_bytes + 16, 0);
+  if (header.coded_bytes > 0) {
+    uint16_t freqs[256];
+    if (size != sizeof(freqs) + header.coded_bytes) return false;
+    memcpy(freqs, data, sizeof(freqs));
+    if (!RansDecode(reinterpret_cast<const uint8_t *>(data) + sizeof(freqs),
+                    header.coded_bytes, freqs, header.raw_bytes, raw.data()))
+      return false;
+  } else {
+    if (size != header.raw_bytes) return false;
+    memcpy(raw.data(), data, size);
+  }
+
+  // The lengths in the controls have to add up to the varint bytes, which
+  // makes every read below stay within the buffer.
+  const uint8_t *controls = raw.data();
+  const VarintTables &kTables = Tables();
+  size_t lengths = 0;
+  for (size_t g = 0; g < count / 4; ++g)
+    lengths += kTables.lengths[controls[g]];
+  for (size_t i = count / 4 * 4; i < count; ++i)
+    lengths += ((controls[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+  if (lengths != header.raw_bytes - kControls) return false;
+
+  const uint8_t *varints = controls + kControls;
+  size_t first = 0;
+#ifdef MESH_CODEC_SSSE3
+  if (HasSsse3()) {
+    first = count / 4 * 4;
+    varints = UnpackGroupsSsse3(controls, varints, count / 4, delta, values);
+  }
+#endif
+  UnpackVarints(controls, varints, first, count, delta,
+                first > 0 ? values[first - 1] : 0, values);
+  *base = header.base;
+  return true;
+}
+
+// Number of values of a stream: one per vertex for the attributes the mesh
+// has, one per corner for the indices.
+size_t StreamValues(int stream, size_t vertices, size_t corners,
+                    uint32_t flags) {
+  if (stream == kIndices) return corners;
+  if (stream == kQuality) return (flags & kHasQuality) ? vertices : 0;
+  if (stream >= kColorR) return (flags & kHasColors) ? vertices : 0;
+  if (stream >= kTexCoordS) return (flags & kHasTexCoords) ? vertices : 0;
+  if (stream >= kNormalU) return (flags & kHasNormals) ? vertices : 0;
+  return vertices;
+}
+
+struct Block {
+  int stream;
+  size_t first;
+  size_t count;
+};
+
+// Blocks of every stream, in stream order.
+std::vector<Block> SplitBlocks(size_t vertices, size_t corners,
+                               uint32_t flags) {
+  std::vector<Block> blocks;
+  for (int s = 0; s < kStreams; ++s) {
+    const size_t kValues = StreamValues(s, vertices, corners, flags);
+    for (size_t first = 0; first < kValues; first += kBlockValues)
+      blocks.push_back({s, first, std::min(kBlockValues, kValues - first)});
+  }
+  return blocks;
+}
+
+}  // namespace
+
+bool EncodeMesh(const TriangleMesh &mesh, const MeshCodecOptions &options,
+                std::vector<char> *encoded) {
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  const size_t kCorners = mesh.faces_.size();
+  const bool kHasNormalArray = !mesh.normals_.empty();
+  const bool kHasTexCoordArray = !mesh.texCoords_.empty();
+  const bool kHasColorArray = !mesh.colors_.empty();
+  const bool kHasQualityArray = !mesh.quality_.empty();
+  const int kBits[4] = {options.position_bits, options.normal_bits,
+                        options.tex_coord_bits, options.quality_bits};
+  for (int bits : kBits) {
+    if (bits < 1 || bits > 24) return false;
+  }
+  if (mesh.vertices_.size() % 3 != 0 || kVertices > uint32_t(INT32_MAX) ||
+      kCorners > uint32_t(INT32_MAX) ||
+      (kHasNormalArray && mesh.normals_.size() != kVertices * 3) ||
+      (kHasTexCoordArray && mesh.texCoords_.size() != kVertices * 2) ||
+      (kHasColorArray && mesh.colors_.size() != kVertices * 4) ||
+      (kHasQualityArray && mesh.quality_.size() != kVertices)) {
+    return false;
+  }
+
+  // Vertices are renumbered in the order the faces first use them, so every
+  // corner is either 0 for a new vertex or a short distance back from the
+  // next one. Unused vertices go last, in their original order.
+  std::vector<int> order;
+  order.reserve(kVertices);
+  std::vector<int> remap(kVertices, -1);
+  std::vector<uint32_t> streams[kStreams];
+  streams[kIndices].resize(kCorners);
+  std::vector<uint32_t> bases((kCorners + kBlockValues - 1) / kBlockValues);
+  uint32_t next = 0;
+  for (size_t i = 0; i < kCorners; ++i) {
+    if (i % kBlockValues == 0) bases[i / kBlockValues] = next;
+    const int kIndex = mesh.faces_[i];
+    if (kIndex < 0 || size_t(kIndex) >= kVertices) return false;
+    if (remap[kIndex] < 0) {
+      remap[kIndex] = int(next++);
+      order.push_back(kIndex);
+      streams[kIndices][i] = 0;
+    } else {
+      streams[kIndices][i] = next - uint32_t(remap[kIndex]);
+    }
+  }
+  for (size_t v = 0; v < kVertices; ++v) {
+    if (remap[v] < 0) order.push_back(int(v));
+  }
+
+  CodecHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.vertices = kVertices;
+  header.corners = kCorners;
+  header.flags = (kHasNormalArray ? kHasNormals : 0) |
+                 (kHasTexCoordArray ? kHasTexCoords : 0) |
+                 (kHasColorArray ? kHasColors : 0) |
+                 (kHasQualityArray ? kHasQuality : 0);
+  header.position_bits = uint8_t(options.position_bits);
+  header.normal_bits = uint8_t(options.normal_bits);
+  header.tex_coord_bits = uint8_t(options.tex_coord_bits);
+  header.quality_bits = uint8_t(options.quality_bits);
+
+  const uint32_t kPositionLevels = Levels(options.position_bits);
+  const uint32_t kNormalLevels = Levels(options.normal_bits);
+  const uint32_t kTexCoordLevels = Levels(options.tex_coord_bits);
+  const uint32_t kQualityLevels = Levels(options.quality_bits);
+  QuantizationRange(mesh.vertices_, 3, kPositionLevels, header.position_min,
+                    header.position_scale);
+  QuantizationRange(mesh.texCoords_, 2, kTexCoordLevels, header.tex_coord_min,
+                    header.tex_coord_scale);
+  QuantizationRange(mesh.quality_, 1, kQualityLevels, &header.quality_min,
+                    &header.quality_scale);
+
+  // Attributes are quantized in the new vertex order.
+  for (int s = kPositionX; s < kIndices; ++s)
+    streams[s].resize(StreamValues(s, kVertices, kCorners, header.flags));
+  ParallelFor(kVertices, kMinVertices, [&](size_t, size_t first,
+                                           size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      const size_t kSource = size_t(order[v]);
+      for (int c = 0; c < 3; ++c) {
+        streams[kPositionX + c][v] = Quantize(
+            mesh.vertices_[kSource * 3 + c], header.position_min[c],
+            header.position_scale[c], kPositionLevels);
+      }
+      if (kHasNormalArray) {
+        float uv[2];
+        EncodeOctahedral(&mesh.normals_[kSource * 3], &uv[0], &uv[1]);
+        for (int c = 0; c < 2; ++c) {
+          streams[kNormalU + c][v] = Quantize(
+              uv[c], -1.0f, 2.0f / float(kNormalLevels), kNormalLevels);
+        }
+      }
+      if (kHasTexCoordArray) {
+        for (int c = 0; c < 2; ++c) {
+          streams[kTexCoordS + c][v] = Quantize(
+              mesh.texCoords_[kSource * 2 + c], header.tex_coord_min[c],
+              header.tex_coord_scale[c], kTexCoordLevels);
+        }
+      }
+      if (kHasColorArray) {
+        for (int c = 0; c < 4; ++c)
+          streams[kColorR + c][v] = mesh.colors_[kSource * 4 + c];
+      }
+      if (kHasQualityArray) {
+        streams[kQuality][v] =
+            Quantize(mesh.quality_[kSource], header.quality_min,
+                     header.quality_scale, kQualityLevels);
+      }
+    }
+  });
+
+  // Every block of an attribute stream stores the zigzagged differences to the
+  // previous vertex, starting from 0, so blocks do not depend on each other.
+  const std::vector<Block> kBlocks =
+      SplitBlocks(kVertices, kCorners, header.flags);
+  std::vector<std::vector<char>> coded(kBlocks.size());
+  ParallelFor(kBlocks.size(), 1, [&](size_t, size_t first, size_t last) {
+    std::vector<uint32_t> values;
+    for (size_t b = first; b < last; ++b) {
+      const Block &kBlock = kBlocks[b];
+      const uint32_t *kValues = &streams[kBlock.stream][kBlock.first];
+      uint32_t base = 0;
+      if (kBlock.stream == kIndices) {
+        base = bases[kBlock.first / kBlockValues];
+      } else {
+        values.resize(kBlock.count);
+        uint32_t previous = 0;
+        for (size_t i = 0; i < kBlock.count; ++i) {
+          values[i] = ZigZag(int32_t(kValues[i] - previous));
+          previous = kValues[i];
+        }
+        kValues = values.data();
+      }
+      EncodeBlock(kValues, kBlock.count, base, &coded[b]);
+    }
+  });
+
+  // Header, offset of every block and the end of the last one, blocks.
+  std::vector<uint64_t> offsets(kBlocks.size() + 1);
+  uint64_t offset = sizeof(header) + offsets.size() * sizeof(uint64_t);
+  for (size_t b = 0; b < kBlocks.size(); ++b) {
+    offsets[b] = offset;
+    offset += coded[b].size();
+  }
+  offsets.back() = offset;
+
+  encoded->clear();
+  encoded->reserve(offset);
+  AppendBytes(&header, sizeof(header), encoded);
+  AppendBytes(offsets.data(), offsets.size() * sizeof(uint64_t), encoded);
+  for (const std::vector<char> &block : coded)
+    AppendBytes(block.data(), block.size(), encoded);
+  return true;
+}
+
+bool DecodeMesh(const char *data, size_t size, TriangleMesh *mesh) {
+  CodecHeader header;
+  if (size < sizeof(header)) return false;
+  memcpy(&header, data, sizeof(header));
+  const int kBits[4] = {header.position_bits, header.normal_bits,
+                        header.tex_coord_bits, header.quality_bits};
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.vertices > uint32_t(INT32_MAX) ||
+      header.corners > uint32_t(INT32_MAX)) {
+    return false;
+  }
+  for (int bits : kBits) {
+    if (bits < 1 || bits > 24) return false;
+  }
+
+  const size_t kVertices = header.vertices;
+  const size_t kCorners = header.corners;
+  const bool kHasNormalArray = (header.flags & kHasNormals) != 0;
+  const bool kHasTexCoordArray = (header.flags & kHasTexCoords) != 0;
+  const bool kHasColorArray = (header.flags & kHasColors) != 0;
+  const bool kHasQualityArray = (header.flags & kHasQuality) != 0;
+  const std::vector<Block> kBlocks =
+      SplitBlocks(kVertices, kCorners, header.flags);
+
+  // Every block needs its offset, so the counts cannot be larger than the
+  // data can describe.
+  const size_t kOffsets = kBlocks.size() + 1;
+  if ((size - sizeof(header)) / sizeof(uint64_t) < kOffsets) return false;
+  std::vector<uint64_t> offsets(kOffsets);
+  memcpy(offsets.data(), data + sizeof(header), kOffsets * sizeof(uint64_t));
+  if (offsets.front() != sizeof(header) + kOffsets * sizeof(uint64_t) ||
+      offsets.back() != size) {
+    return false;
+  }
+  for (size_t b = 0; b + 1 < kOffsets; ++b) {
+    if (offsets[b] > offsets[b + 1]) return false;
+  }
+
+  std::vector<uint32_t> streams[kStreams];
+  for (int s = 0; s < kIndices; ++s)
+    streams[s].resize(StreamValues(s, kVertices, kCorners, header.flags));
+  mesh->faces_.resize(kCorners);
+
+  std::vector<uint8_t> valid(kBlocks.size(), 0);
+  ParallelFor(kBlocks.size(), 1, [&](size_t, size_t first, size_t last) {
+    std::vector<uint32_t> codes;
+    for (size_t b = first; b < last; ++b) {
+      const Block &kBlock = kBlocks[b];
+      const char *kData = data + offsets[b];
+      const size_t kSize = offsets[b + 1] - offsets[b];
+      uint32_t base = 0;
+      if (kBlock.stream != kIndices) {
+        valid[b] = DecodeBlock(kData, kSize, kBlock.count, true,
+                               &streams[kBlock.stream][kBlock.first], &base);
+        continue;
+      }
+
+      codes.resize(kBlock.count);
+      if (!DecodeBlock(kData, kSize, kBlock.count, false, codes.data(), &base))
+        continue;
+      uint32_t next = base;
+      bool in_range = true;
+      for (size_t i = 0; i < kBlock.count; ++i) {
+        const uint32_t kCode = codes[i];
+        in_range &= kCode <= next;
+        const uint32_t kIndex = kCode == 0 ? next++ : next - kCode;
+        mesh->faces_[kBlock.first + i] = int(kIndex);
+      }
+      valid[b] = in_range && next <= kVertices;
+    }
+  });
+  if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+    mesh->faces_.clear();
+    return false;
+  }
+
+  mesh->vertices_.resize(kVertices * 3);
+  mesh->normals_.resize(kHasNormalArray ? kVertices * 3 : 0);
+  mesh->texCoords_.resize(kHasTexCoordArray ? kVertices * 2 : 0);
+  mesh->colors_.resize(kHasColorArray ? kVertices * 4 : 0);
+  mesh->quality_.resize(kHasQualityArray ? kVertices : 0);
+  const float kNormalScale = 2.0f / float(Levels(header.normal_bits));
+  ParallelFor(kVertices, kMinVertices, [&](size_t, size_t first,
+                                           size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      for (int c = 0; c < 3; ++c) {
+        mesh->vertices_[v * 3 + c] =
+            header.position_min[c] +
+            float(streams[kPositionX + c][v]) * header.position_scale[c];
+      }
+      if (kHasNormalArray) {
+        DecodeOctahedral(float(streams[kNormalU][v]) * kNormalScale - 1.0f,
+                         float(streams[kNormalV][v]) * kNormalScale - 1.0f,
+                         &mesh->normals_[v * 3]);
+      }
+      if (kHasTexCoordArray) {
+        for (int c = 0; c < 2; ++c) {
+          mesh->texCoords_[v * 2 + c] =
+              header.tex_coord_min[c] +
+              float(streams[kTexCoordS + c][v]) * header.tex_coord_scale[c];
+        }
+      }
+      if (kHasColorArray) {
+        for (int c = 0; c < 4; ++c)
+          mesh->colors_[v * 4 + c] = uint8_t(streams[kColorR + c][v]);
+      }
+      if (kHasQualityArray) {
+        mesh->quality_[v] = header.quality_min +
+                            float(streams[kQuality][v]) * header.quality_scale;
+      }
+    }
+  });
+  return true;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,78 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_CODEC_H_
+#define MESH_CODEC_H_
+
+#include <triangle_mesh.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief The MeshCodecOptions struct Number of bits every attribute is
+ * quantized to, from 1 to 24.
+ */
+struct MeshCodecOptions {
+  MeshCodecOptions()
+      : position_bits(16),
+        normal_bits(12),
+        tex_coord_bits(16),
+        quality_bits(16) {}
+
+  /**
+   * @brief position_bits Bits per coordinate, over the bounding box.
+   */
+  int position_bits;
+
+  /**
+   * @brief normal_bits Bits per coordinate of the octahedral projection of
+   * the normals.
+   */
+  int normal_bits;
+
+  /**
+   * @brief tex_coord_bits Bits per coordinate, over the range of the texture
+   * coordinates.
+   */
+  int tex_coord_bits;
+
+  /**
+   * @brief quality_bits Bits per value, over the range of the quality.
+   */
+  int quality_bits;
+};
+
+/**
+ * @brief EncodeMesh Compresses the vertices, normals, texture coordinates,
+ * colors, quality and faces of mesh. Vertices are renumbered in the order the
+ * faces first use them, so the faces are coded as small distances to the
+ * newest vertex, and every attribute is quantized and predicted from the
+ * previous vertex. The resulting integers are stored as byte-aligned varints
+ * compressed with an order 0 rANS coder, in independent blocks that are
+ * encoded and decoded in parallel.
+ * @param mesh The mesh to compress. Every attribute other than the positions
+ * is stored when it is not empty. Colors are kept exact.
+ * @param options Quantization of the attributes.
+ * @param encoded The compressed mesh.
+ * @return Whether the mesh could be encoded: its arrays have consistent sizes
+ * and its faces reference existing vertices.
+ */
+bool EncodeMesh(const TriangleMesh &mesh, const MeshCodecOptions &options,
+                std::vector<char> *encoded);
+
+/**
+ * @brief DecodeMesh Decompresses a mesh produced by EncodeMesh. Varints are
+ * decoded with SSSE3 when the processor supports it.
+ * @param data The compressed mesh.
+ * @param size Size in bytes of data.
+ * @param mesh Receives the vertices, normals, texture coordinates, colors,
+ * quality and faces; the rest of it is left untouched.
+ * @return Whether data is a valid compressed mesh.
+ */
+bool DecodeMesh(const char *data, size_t size, TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_CODEC_H_
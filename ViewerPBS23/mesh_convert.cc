@@ -0,0 +1,301 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+// Headless batch converter: loads PLY, OBJ and STL models, writes them as
+// loaded to viewer caches and/or, optionally welded, with recomputed normals
+// and optimized, to binary PLY files. Files are converted concurrently by a
+// pool of threads.
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "./mesh_cache.h"
+#include "./mesh_io.h"
+#include "./mesh_optimize.h"
+#include "./mesh_weld.h"
+#include "./parallel_for.h"
+#include "./triangle_mesh.h"
+
+namespace {
+
+struct Options {
+  Options()
+      : threads(0),
+        weld(false),
+        normals(false),
+        optimize(false),
+        cache(false) {}
+
+  std::vector<std::string> inputs;
+  std::string output_dir;
+  size_t threads;
+  bool weld;
+  bool normals;
+  bool optimize;
+  bool cache;
+};
+
+// Discards everything written to it. It has no state, so any number of
+// threads can write to it at once.
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+};
+
+// Outcome of the conversion of one file.
+struct Result {
+  Result() : converted(false), bytes(0), vertices(0), faces(0), ms(0.0) {}
+
+  bool converted;
+  uint64_t bytes;
+  size_t vertices;
+  size_t faces;
+  double ms;
+};
+
+void PrintUsage(std::ostream &out) {
+  out << "Usage: mesh_convert [options] <file or directory>...\n"
+      << "Converts the PLY, OBJ and STL models given, or found recursively in\n"
+      << "the directories given, to binary PLY and/or viewer caches.\n"
+      << "  -o <dir>      Write <dir>/<name>.ply for every model.\n"
+      << "  --cache       Write the viewer cache next to every model, from\n"
+      << "                the model as loaded.\n"
+      << "  --weld        Merge vertices with the same position in the PLY.\n"
+      << "  --normals     Recompute smooth normals in the PLY.\n"
+      << "  --optimize    Reorder the PLY faces and vertices for the GPU.\n"
+      << "  -j <threads>  Files converted at once (default: hardware "
+         "threads).\n";
+}
+
+bool ParseOptions(int argc, char *argv[], Options *options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string kArg = argv[i];
+    if (kArg == "-o" && i + 1 < argc) {
+      options->output_dir = argv[++i];
+    } else if (kArg == "-j" && i + 1 < argc) {
+      options->threads = std::strtoul(argv[++i], nullptr, 10);
+      if (options->threads == 0) return false;
+    } else if (kArg == "--cache") {
+      options->cache = true;
+    } else if (kArg == "--weld") {
+      options->weld = true;
+    } else if (kArg == "--normals") {
+      options->normals = true;
+    } else if (kArg == "--optimize") {
+      options->optimize = true;
+    } else if (!kArg.empty() && kArg[0] == '-') {
+      return false;
+    } else {
+      options->inputs.push_back(kArg);
+    }
+  }
+  return !options->inputs.empty() &&
+         (!options->output_dir.empty() || options->cache);
+}
+
+std::string Extension(const std::string &path) {
+  const size_t kDot = path.find_last_of('.');
+  const size_t kSlash = path.find_last_of('/');
+  if (kDot == std::string::npos ||
+      (kSlash != std::string::npos && kDot < kSlash))
+    return "";
+  std::string extension = path.substr(kDot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return char(std::tolower(c)); });
+  return extension;
+}
+
+bool IsModel(const std::string &path) {
+  const std::string kExtension = Extension(path);
+  return kExtension == "ply" || kExtension == "obj" || kExtension == "stl";
+}
+
+// Appends path, or the models under it if it is a directory, to files.
+void CollectFiles(const std::string &path, std::vector<std::string> *files) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    std::cerr << "Cannot access " << path << std::endl;
+    return;
+  }
+  if (!S_ISDIR(info.st_mode)) {
+    if (IsModel(path))
+      files->push_back(path);
+    else
+      std::cerr << "Skipping " << path << ": unknown format" << std::endl;
+    return;
+  }
+
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    std::cerr << "Cannot open directory " << path << std::endl;
+    return;
+  }
+  std::vector<std::string> entries;
+  while (const dirent *entry = readdir(dir)) {
+    const std::string kName = entry->d_name;
+    if (kName == "." || kName == "..") continue;
+    entries.push_back(path + "/" + kName);
+  }
+  closedir(dir);
+
+  // Directory order is arbitrary; sorting keeps runs reproducible.
+  std::sort(entries.begin(), entries.end());
+  for (const std::string &entry : entries) {
+    struct stat entry_info;
+    if (stat(entry.c_str(), &entry_info) != 0) continue;
+    if (S_ISDIR(entry_info.st_mode))
+      CollectFiles(entry, files);
+    else if (IsModel(entry))
+      files->push_back(entry);
+  }
+}
+
+// Path of the PLY written for file in output_dir.
+std::string OutputPath(const std::string &output_dir,
+                       const std::string &file) {
+  const size_t kSlash = file.find_last_of('/');
+  std::string name =
+      kSlash == std::string::npos ? file : file.substr(kSlash + 1);
+  name = name.substr(0, name.find_last_of('.'));
+  return output_dir + "/" + name + ".ply";
+}
+
+bool Load(const std::string &file, data_representation::TriangleMesh *mesh) {
+  const std::string kExtension = Extension(file);
+  if (kExtension == "ply") return data_representation::ReadFromPly(file, mesh);
+  if (kExtension == "stl") return data_representation::ReadFromStl(file, mesh);
+  return data_representation::ReadFromObj(file, mesh);
+}
+
+Result Convert(const std::string &file, const Options &options,
+               std::string *error) {
+  const auto kStart = std::chrono::steady_clock::now();
+  Result result;
+  struct stat info;
+  if (stat(file.c_str(), &info) == 0) result.bytes = uint64_t(info.st_size);
+
+  data_representation::TriangleMesh mesh;
+  if (!Load(file, &mesh)) {
+    *error = "could not be read";
+    return result;
+  }
+  // The viewer processes what it reads from the cache like what it reads from
+  // the model, so the cache holds the model as loaded.
+  uint64_t hash = 0;
+  if (options.cache && (!data_representation::HashSourceFile(file, &hash) ||
+                        !data_representation::WriteToCache(file, hash, mesh))) {
+    *error = "could not write " + data_representation::CacheFilename(file);
+    return result;
+  }
+
+  // Point clouds have no faces to weld or compute normals from.
+  if (!mesh.faces_.empty() && !options.output_dir.empty()) {
+    const bool kWelded =
+        options.weld && data_representation::WeldVertices(&mesh) > 0;
+    if (kWelded || options.normals) mesh.computeNormals();
+    if (options.optimize) data_representation::OptimizeMesh(&mesh);
+  }
+
+  if (!options.output_dir.empty() &&
+      !data_representation::WriteToPly(OutputPath(options.output_dir, file),
+                                       mesh)) {
+    *error = "could not write " + OutputPath(options.output_dir, file);
+    return result;
+  }
+
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  result.converted = true;
+  result.vertices = mesh.vertices_.size() / 3;
+  result.faces = mesh.faces_.size() / 3;
+  result.ms = kElapsed.count();
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(std::cerr);
+    return 2;
+  }
+
+  std::vector<std::string> files;
+  for (const std::string &input : options.inputs) CollectFiles(input, &files);
+  if (files.empty()) {
+    std::cerr << "No models to convert." << std::endl;
+    return 1;
+  }
+  if (!options.output_dir.empty()) mkdir(options.output_dir.c_str(), 0755);
+
+  // The loaders log every stage to std::cout, which would interleave across
+  // threads, so it is discarded; the report goes to the original stream.
+  std::ostream report(std::cout.rdbuf());
+  NullBuffer discard;
+  std::cout.rdbuf(&discard);
+
+  // Every worker takes the next unconverted file until none is left. The
+  // loaders are parallel themselves, so the threads mostly overlap their
+  // serial stages and the file I/O.
+  const size_t kThreads =
+      std::min(files.size(), options.threads > 0
+                                 ? options.threads
+                                 : data_representation::ThreadCount());
+  std::vector<Result> results(files.size());
+  std::atomic<size_t> next(0);
+  std::mutex report_mutex;
+  const auto kStart = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < kThreads; ++t) {
+    workers.emplace_back([&]() {
+      for (size_t f = next++; f < files.size(); f = next++) {
+        std::string error;
+        results[f] = Convert(files[f], options, &error);
+
+        std::lock_guard<std::mutex> lock(report_mutex);
+        if (results[f].converted) {
+          report << files[f] << ": " << results[f].vertices << " vertices, "
+                 << results[f].faces << " faces, " << results[f].ms << " ms"
+                 << std::endl;
+        } else {
+          std::cerr << files[f] << ": " << error << std::endl;
+        }
+      }
+    });
+  }
+  for (std::thread &worker : workers) worker.join();
+  std::cout.rdbuf(report.rdbuf());
+
+  const std::chrono::duration<double> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  size_t converted = 0;
+  uint64_t bytes = 0;
+  size_t faces = 0;
+  for (const Result &result : results) {
+    if (!result.converted) continue;
+    ++converted;
+    bytes += result.bytes;
+    faces += result.faces;
+  }
+  const double kSeconds = std::max(kElapsed.count(), 1e-9);
+  std::cout << "Converted " << converted << " of " << files.size()
+            << " files in " << kSeconds << " s with " << kThreads
+            << " threads: " << converted / kSeconds << " files/s, "
+            << bytes / kSeconds / (1 << 20) << " MB/s, "
+            << faces / kSeconds << " faces/s" << std::endl;
+
+  return converted == files.size() ? 0 : 1;
+}
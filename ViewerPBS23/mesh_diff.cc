@@ -0,0 +1,62 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_diff.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Bytes compared at a time. Changes are reported with this granularity.
+const size_t kDiffBlock = 4096;
+
+// Runs of changed blocks closer than this many equal blocks are merged: one
+// larger copy is cheaper than another call.
+const size_t kMergeBlocks = 4;
+
+// Blocks per thread below which comparing is not worth a thread.
+const size_t kMinDiffBlocks = 1 << 10;
+
+}  // namespace
+
+std::vector<ByteRange> DiffBytes(const void *old_data, const void *new_data,
+                                 size_t size) {
+  const char *kOld = static_cast<const char *>(old_data);
+  const char *kNew = static_cast<const char *>(new_data);
+  const size_t kBlocks = (size + kDiffBlock - 1) / kDiffBlock;
+
+  std::vector<uint8_t> changed(kBlocks, 0);
+  ParallelFor(kBlocks, kMinDiffBlocks, [&](size_t, size_t first,
+                                           size_t last) {
+    for (size_t b = first; b < last; ++b) {
+      const size_t kOffset = b * kDiffBlock;
+      const size_t kSize = std::min(kDiffBlock, size - kOffset);
+      changed[b] = memcmp(kOld + kOffset, kNew + kOffset, kSize) != 0;
+    }
+  });
+
+  std::vector<ByteRange> ranges;
+  size_t b = 0;
+  while (b < kBlocks) {
+    if (!changed[b]) {
+      ++b;
+      continue;
+    }
+    const size_t kFirst = b;
+    size_t last = b + 1;
+    for (b = last; b < kBlocks && b - last < kMergeBlocks; ++b) {
+      if (changed[b]) last = b + 1;
+    }
+    b = last;
+    const size_t kOffset = kFirst * kDiffBlock;
+    ranges.push_back({kOffset, std::min(last * kDiffBlock, size) - kOffset});
+  }
+  return ranges;
+}
+
+}  // namespace data_representation
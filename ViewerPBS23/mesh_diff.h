@@ -0,0 +1,35 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_DIFF_H_
+#define MESH_DIFF_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief The ByteRange struct A run of bytes of a buffer.
+ */
+struct ByteRange {
+  size_t offset;
+  size_t size;
+};
+
+/**
+ * @brief DiffBytes Compares two buffers of the same size in fixed blocks, in
+ * parallel, and returns the runs of blocks where they differ in increasing
+ * order. Runs separated by only a few equal blocks are merged, so a scattered
+ * edit does not turn into one upload per block.
+ * @param old_data The current contents.
+ * @param new_data The updated contents.
+ * @param size Size in bytes of both buffers.
+ * @return The ranges of new_data that have to be copied over old_data to make
+ * them equal; empty if they already are.
+ */
+std::vector<ByteRange> DiffBytes(const void *old_data, const void *new_data,
+                                 size_t size);
+
+}  // namespace data_representation
+
+#endif  // MESH_DIFF_H_
@@ -0,0 +1,441 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_generators.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "./mesh_analysis.h"
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many vertices per thread a range of rows is not worth a thread.
+const size_t kMinVertices = 1 << 15;
+
+const double kPi = 3.14159265358979323846;
+
+bool CheckResolution(const char *shape, const char *name, size_t value,
+                     size_t min) {
+  if (value >= min && value <= kMaxResolution) return true;
+  std::cerr << "The " << name << " of a " << shape << " must be in [" << min
+            << ", " << kMaxResolution << "], not " << value << std::endl;
+  return false;
+}
+
+// Clears mesh and sizes its arrays for the given number of vertices and
+// triangles.
+void Allocate(size_t vertices, size_t triangles, TriangleMesh *mesh) {
+  mesh->Clear();
+  mesh->vertices_.resize(vertices * 3);
+  mesh->normals_.resize(vertices * 3);
+  mesh->texCoords_.resize(vertices * 2);
+  mesh->faces_.resize(triangles * 3);
+}
+
+// Calls function(first, last) on all threads for ranges of [0, rows), where
+// every row writes about row_vertices vertices.
+template <typename Function>
+void ForEachRow(size_t rows, size_t row_vertices, Function function) {
+  const size_t kMinRows = std::max<size_t>(1, kMinVertices / row_vertices);
+  ParallelFor(rows, kMinRows, [&](size_t, size_t first, size_t last) {
+    function(first, last);
+  });
+}
+
+void SetVertex(size_t v, const double position[3], const double normal[3],
+               double s, double t, TriangleMesh *mesh) {
+  for (int k = 0; k < 3; ++k) {
+    mesh->vertices_[v * 3 + k] = static_cast<float>(position[k]);
+    mesh->normals_[v * 3 + k] = static_cast<float>(normal[k]);
+  }
+  mesh->texCoords_[v * 2] = static_cast<float>(s);
+  mesh->texCoords_[v * 2 + 1] = static_cast<float>(t);
+}
+
+void SetTriangle(size_t f, size_t a, size_t b, size_t c, TriangleMesh *mesh) {
+  mesh->faces_[f * 3] = static_cast<int>(a);
+  mesh->faces_[f * 3 + 1] = static_cast<int>(b);
+  mesh->faces_[f * 3 + 2] = static_cast<int>(c);
+}
+
+// Writes the two triangles of every quad between the grid rows of columns + 1
+// vertices starting at first_row and first_row + columns + 1, from face f on.
+// They face the side from which columns grow to the right and rows upwards.
+void SetQuadRow(size_t f, size_t first_row, size_t columns,
+                TriangleMesh *mesh) {
+  const size_t kNextRow = first_row + columns + 1;
+  for (size_t c = 0; c < columns; ++c) {
+    SetTriangle(f++, first_row + c, first_row + c + 1, kNextRow + c + 1, mesh);
+    SetTriangle(f++, first_row + c, kNextRow + c + 1, kNextRow + c, mesh);
+  }
+}
+
+// Cosines and sines of the angles 2 * pi * i / segments for i in
+// [0, segments]. The last pair repeats the first exactly, so seams close.
+void ComputeCircle(size_t segments, std::vector<double> *cosines,
+                   std::vector<double> *sines) {
+  cosines->resize(segments + 1);
+  sines->resize(segments + 1);
+  for (size_t i = 0; i < segments; ++i) {
+    const double kAngle = 2.0 * kPi * i / segments;
+    (*cosines)[i] = std::cos(kAngle);
+    (*sines)[i] = std::sin(kAngle);
+  }
+  (*cosines)[segments] = (*cosines)[0];
+  (*sines)[segments] = (*sines)[0];
+}
+
+void Normalize(double v[3]) {
+  const double kLength = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  for (int k = 0; k < 3; ++k) v[k] /= kLength;
+}
+
+// Equirectangular texture coordinates of a point of the unit sphere, with t
+// growing from the +z pole like in GenerateUvSphere.
+void SphereTexCoords(const double p[3], double *s, double *t) {
+  const double kS = std::atan2(p[1], p[0]) / (2.0 * kPi);
+  *s = kS < 0.0 ? kS + 1.0 : kS;
+  *t = std::acos(std::max(-1.0, std::min(1.0, p[2]))) / kPi;
+}
+
+const double kGolden = 1.61803398874989484820;
+
+const double kIcosahedronVertices[12][3] = {
+    {-1, kGolden, 0}, {1, kGolden, 0}, {-1, -kGolden, 0}, {1, -kGolden, 0},
+    {0, -1, kGolden}, {0, 1, kGolden}, {0, -1, -kGolden}, {0, 1, -kGolden},
+    {kGolden, 0, -1}, {kGolden, 0, 1}, {-kGolden, 0, -1}, {-kGolden, 0, 1}};
+
+const int kIcosahedronFaces[20][3] = {
+    {0, 11, 5}, {0, 5, 1},  {0, 1, 7},   {0, 7, 10}, {0, 10, 11},
+    {1, 5, 9},  {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+    {3, 9, 4},  {3, 4, 2},  {3, 2, 6},   {3, 6, 8},  {3, 8, 9},
+    {4, 9, 5},  {2, 4, 11}, {6, 2, 10},  {8, 6, 7},  {9, 8, 1}};
+
+// Vertex numbering of an icosphere: the 12 corners, then frequency - 1
+// vertices per edge ordered from its lower corner, then the vertices inside
+// every face row by row. A point of a face (a, b, c) is addressed as (i, j)
+// with 0 <= j <= i <= frequency, at a * (f - i) + b * (i - j) + c * j.
+class Icosphere {
+ public:
+  explicit Icosphere(size_t frequency) : frequency_(frequency) {
+    for (int a = 0; a < 12; ++a)
+      std::fill(edges_[a], edges_[a] + 12, -1);
+    int edges = 0;
+    for (const int *kFace : kIcosahedronFaces) {
+      for (int k = 0; k < 3; ++k) {
+        const int kA = std::min(kFace[k], kFace[(k + 1) % 3]);
+        const int kB = std::max(kFace[k], kFace[(k + 1) % 3]);
+        if (edges_[kA][kB] >= 0) continue;
+        edges_[kA][kB] = edges_[kB][kA] = edges;
+        ends_[edges][0] = kA;
+        ends_[edges][1] = kB;
+        ++edges;
+      }
+    }
+  }
+
+  size_t vertices() const { return 10 * frequency_ * frequency_ + 2; }
+
+  // Interior vertices of a face: (f - 1) (f - 2) / 2.
+  size_t face_vertices() const {
+    return (frequency_ - 1) * (frequency_ - 2) / 2;
+  }
+
+  size_t EdgeVertex(int a, int b, size_t k) const {
+    const size_t kFirst = 12 + edges_[a][b] * (frequency_ - 1);
+    return a < b ? kFirst + k - 1 : kFirst + frequency_ - k - 1;
+  }
+
+  size_t InteriorVertex(size_t face, size_t i, size_t j) const {
+    return 12 + 30 * (frequency_ - 1) + face * face_vertices() +
+           (i - 1) * (i - 2) / 2 + j - 1;
+  }
+
+  size_t Vertex(size_t face, size_t i, size_t j) const {
+    const int *kCorners = kIcosahedronFaces[face];
+    if (i == 0) return kCorners[0];
+    if (i == frequency_) {
+      if (j == 0) return kCorners[1];
+      if (j == frequency_) return kCorners[2];
+      return EdgeVertex(kCorners[1], kCorners[2], j);
+    }
+    if (j == 0) return EdgeVertex(kCorners[0], kCorners[1], i);
+    if (j == i) return EdgeVertex(kCorners[0], kCorners[2], i);
+    return InteriorVertex(face, i, j);
+  }
+
+  const int *ends(size_t edge) const { return ends_[edge]; }
+
+ private:
+  size_t frequency_;
+  int edges_[12][12];
+  int ends_[30][2];
+};
+
+// Writes vertex v at the normalized weighted sum of the icosahedron corners
+// a, b and c.
+void SetIcosphereVertex(size_t v, int a, double wa, int b, double wb, int c,
+                        double wc, TriangleMesh *mesh) {
+  double p[3];
+  for (int k = 0; k < 3; ++k) {
+    p[k] = kIcosahedronVertices[a][k] * wa + kIcosahedronVertices[b][k] * wb +
+           kIcosahedronVertices[c][k] * wc;
+  }
+  Normalize(p);
+  double s, t;
+  SphereTexCoords(p, &s, &t);
+  SetVertex(v, p, p, s, t, mesh);
+}
+
+// Axes of the cube faces: normal, then u and v with u x v = normal.
+const double kCubeFaces[6][3][3] = {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+    {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},  {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+    {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}};
+
+bool GenerateCube(size_t resolution, bool sphere, TriangleMesh *mesh) {
+  if (!CheckResolution(sphere ? "cube sphere" : "box", "resolution",
+                       resolution, 1))
+    return false;
+  const size_t kSide = resolution + 1;
+  Allocate(6 * kSide * kSide, 12 * resolution * resolution, mesh);
+
+  // Row r is the row r % kSide of the face r / kSide.
+  ForEachRow(6 * kSide, kSide, [&](size_t first, size_t last) {
+    for (size_t r = first; r < last; ++r) {
+      const size_t kFace = r / kSide;
+      const size_t kRow = r % kSide;
+      const double(*kAxes)[3] = kCubeFaces[kFace];
+      const double kV = 2.0 * kRow / resolution - 1.0;
+      for (size_t c = 0; c < kSide; ++c) {
+        const double kU = 2.0 * c / resolution - 1.0;
+        double p[3];
+        for (int k = 0; k < 3; ++k)
+          p[k] = kAxes[0][k] + kU * kAxes[1][k] + kV * kAxes[2][k];
+        if (sphere) {
+          // Maps the cube onto the sphere with less area distortion than
+          // normalizing.
+          double q[3];
+          for (int k = 0; k < 3; ++k) {
+            const double kA = p[(k + 1) % 3] * p[(k + 1) % 3];
+            const double kB = p[(k + 2) % 3] * p[(k + 2) % 3];
+            q[k] = p[k] * std::sqrt(1.0 - kA / 2.0 - kB / 2.0 + kA * kB / 3.0);
+          }
+          SetVertex(r * kSide + c, q, q, double(c) / resolution,
+                    double(kRow) / resolution, mesh);
+        } else {
+          SetVertex(r * kSide + c, p, kAxes[0], double(c) / resolution,
+                    double(kRow) / resolution, mesh);
+        }
+      }
+      if (kRow < resolution) {
+        SetQuadRow((kFace * resolution + kRow) * 2 * resolution, r * kSide,
+                   resolution, mesh);
+      }
+    }
+  });
+
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+}  // namespace
+
+bool GenerateUvSphere(size_t sectors, size_t stacks, TriangleMesh *mesh) {
+  if (!CheckResolution("UV sphere", "sectors", sectors, 3) ||
+      !CheckResolution("UV sphere", "stacks", stacks, 2))
+    return false;
+  const size_t kRow = sectors + 1;
+  // The first and last stacks are fans of a single triangle per sector.
+  Allocate((stacks + 1) * kRow, 2 * sectors * (stacks - 1), mesh);
+  std::vector<double> cosines, sines;
+  ComputeCircle(sectors, &cosines, &sines);
+
+  ForEachRow(stacks + 1, kRow, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      // From the +z pole at i = 0 to the -z pole at i = stacks.
+      // The poles are set exactly, so all their vertices share a position.
+      const double kStackAngle = kPi / 2.0 - kPi * i / stacks;
+      const bool kPole = i == 0 || i == stacks;
+      const double kXY = kPole ? 0.0 : std::cos(kStackAngle);
+      const double kZ = kPole ? (i == 0 ? 1.0 : -1.0) : std::sin(kStackAngle);
+      for (size_t j = 0; j <= sectors; ++j) {
+        const double kP[3] = {kXY * cosines[j], kXY * sines[j], kZ};
+        SetVertex(i * kRow + j, kP, kP, double(j) / sectors,
+                  double(i) / stacks, mesh);
+      }
+      if (i == stacks) continue;
+
+      size_t f = i == 0 ? 0 : sectors * (2 * i - 1);
+      const size_t kK1 = i * kRow, kK2 = kK1 + kRow;
+      for (size_t j = 0; j < sectors; ++j) {
+        if (i != 0) SetTriangle(f++, kK1 + j, kK2 + j, kK1 + j + 1, mesh);
+        if (i != stacks - 1)
+          SetTriangle(f++, kK1 + j + 1, kK2 + j, kK2 + j + 1, mesh);
+      }
+    }
+  });
+
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+bool GenerateIcosphere(size_t frequency, TriangleMesh *mesh) {
+  if (!CheckResolution("icosphere", "frequency", frequency, 1)) return false;
+  const Icosphere kIcosphere(frequency);
+  Allocate(kIcosphere.vertices(), 20 * frequency * frequency, mesh);
+
+  for (int c = 0; c < 12; ++c)
+    SetIcosphereVertex(c, c, 1.0, c, 0.0, c, 0.0, mesh);
+  ForEachRow(30, frequency, [&](size_t first, size_t last) {
+    for (size_t e = first; e < last; ++e) {
+      const int *kEnds = kIcosphere.ends(e);
+      for (size_t k = 1; k < frequency; ++k) {
+        SetIcosphereVertex(kIcosphere.EdgeVertex(kEnds[0], kEnds[1], k),
+                           kEnds[0], double(frequency - k), kEnds[1],
+                           double(k), kEnds[0], 0.0, mesh);
+      }
+    }
+  });
+
+  // Row r is the strip of 2 * i + 1 triangles between the rows i and i + 1
+  // of the face r / frequency, with i = r % frequency. It also writes the
+  // interior vertices of row i.
+  ForEachRow(20 * frequency, frequency, [&](size_t first, size_t last) {
+    for (size_t r = first; r < last; ++r) {
+      const size_t kFace = r / frequency;
+      const size_t kI = r % frequency;
+      const int *kCorners = kIcosahedronFaces[kFace];
+      for (size_t j = 1; j + 1 <= kI; ++j) {
+        SetIcosphereVertex(kIcosphere.InteriorVertex(kFace, kI, j),
+                           kCorners[0], double(frequency - kI), kCorners[1],
+                           double(kI - j), kCorners[2], double(j), mesh);
+      }
+
+      size_t f = kFace * frequency * frequency + kI * kI;
+      for (size_t j = 0; j <= kI; ++j) {
+        SetTriangle(f++, kIcosphere.Vertex(kFace, kI, j),
+                    kIcosphere.Vertex(kFace, kI + 1, j),
+                    kIcosphere.Vertex(kFace, kI + 1, j + 1), mesh);
+        if (j == kI) break;
+        SetTriangle(f++, kIcosphere.Vertex(kFace, kI, j),
+                    kIcosphere.Vertex(kFace, kI + 1, j + 1),
+                    kIcosphere.Vertex(kFace, kI, j + 1), mesh);
+      }
+    }
+  });
+
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+bool GenerateCubeSphere(size_t resolution, TriangleMesh *mesh) {
+  return GenerateCube(resolution, true, mesh);
+}
+
+bool GeneratePlane(size_t columns, size_t rows, TriangleMesh *mesh) {
+  if (!CheckResolution("plane", "columns", columns, 1) ||
+      !CheckResolution("plane", "rows", rows, 1))
+    return false;
+  const size_t kRow = columns + 1;
+  Allocate((rows + 1) * kRow, 2 * columns * rows, mesh);
+  const double kNormal[3] = {0.0, 0.0, 1.0};
+
+  ForEachRow(rows + 1, kRow, [&](size_t first, size_t last) {
+    for (size_t r = first; r < last; ++r) {
+      for (size_t c = 0; c <= columns; ++c) {
+        const double kP[3] = {2.0 * c / columns - 1.0, 2.0 * r / rows - 1.0,
+                              0.0};
+        SetVertex(r * kRow + c, kP, kNormal, double(c) / columns,
+                  double(r) / rows, mesh);
+      }
+      if (r < rows) SetQuadRow(r * 2 * columns, r * kRow, columns, mesh);
+    }
+  });
+
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+bool GenerateTorus(size_t rings, size_t sides, float minor_radius,
+                   TriangleMesh *mesh) {
+  if (!CheckResolution("torus", "rings", rings, 3) ||
+      !CheckResolution("torus", "sides", sides, 3))
+    return false;
+  if (!(minor_radius > 0.0f && minor_radius <= 0.5f)) {
+    std::cerr << "The minor radius of a torus must be in (0, 0.5], not "
+              << minor_radius << std::endl;
+    return false;
+  }
+  // Rows go around the tube, so the quads face outwards.
+  const size_t kRow = rings + 1;
+  Allocate((sides + 1) * kRow, 2 * rings * sides, mesh);
+  std::vector<double> ring_cosines, ring_sines, side_cosines, side_sines;
+  ComputeCircle(rings, &ring_cosines, &ring_sines);
+  ComputeCircle(sides, &side_cosines, &side_sines);
+  const double kMinor = minor_radius;
+  const double kMajor = 1.0 - kMinor;
+
+  ForEachRow(sides + 1, kRow, [&](size_t first, size_t last) {
+    for (size_t j = first; j < last; ++j) {
+      for (size_t i = 0; i <= rings; ++i) {
+        const double kN[3] = {side_cosines[j] * ring_cosines[i],
+                              side_cosines[j] * ring_sines[i], side_sines[j]};
+        const double kP[3] = {ring_cosines[i] * kMajor + kN[0] * kMinor,
+                              ring_sines[i] * kMajor + kN[1] * kMinor,
+                              kN[2] * kMinor};
+        SetVertex(j * kRow + i, kP, kN, double(i) / rings, double(j) / sides,
+                  mesh);
+      }
+      if (j < sides) SetQuadRow(j * 2 * rings, j * kRow, rings, mesh);
+    }
+  });
+
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  return true;
+}
+
+bool GenerateBox(size_t resolution, TriangleMesh *mesh) {
+  return GenerateCube(resolution, false, mesh);
+}
+
+bool GenerateMesh(const std::string &shape, size_t resolution,
+                  TriangleMesh *mesh) {
+  const auto kStart = std::chrono::steady_clock::now();
+  bool generated = false;
+  if (shape == "uvsphere") {
+    generated = GenerateUvSphere(resolution,
+                                 std::max<size_t>(2, resolution / 2), mesh);
+  } else if (shape == "icosphere") {
+    generated = GenerateIcosphere(resolution, mesh);
+  } else if (shape == "cubesphere") {
+    generated = GenerateCubeSphere(resolution, mesh);
+  } else if (shape == "plane") {
+    generated = GeneratePlane(resolution, resolution, mesh);
+  } else if (shape == "torus") {
+    generated = GenerateTorus(resolution, std::max<size_t>(3, resolution / 4),
+                              0.25f, mesh);
+  } else if (shape == "box") {
+    generated = GenerateBox(resolution, mesh);
+  } else {
+    std::cerr << "Unknown shape " << shape << std::endl;
+  }
+  if (!generated) return false;
+
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  std::cout << "Generated " << shape << std::endl;
+  std::cout << "\tVertices = " << mesh->vertices_.size() / 3 << std::endl;
+  std::cout << "\tFaces = " << mesh->faces_.size() / 3 << std::endl;
+  std::cout << "\tGeneration time = " << kElapsed.count() << " ms"
+            << std::endl;
+  return true;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,83 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_GENERATORS_H_
+#define MESH_GENERATORS_H_
+
+#include <cstddef>
+#include <string>
+
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief kMaxResolution Largest resolution the generators accept. It keeps the
+ * vertex count of every shape within the range of int indices.
+ */
+const size_t kMaxResolution = 1 << 15;
+
+// Every generator clears mesh, sizes its arrays exactly from the resolution
+// and fills them in place, row by row, on all threads. The results have
+// positions, normals, texture coordinates and counter-clockwise triangles,
+// and fit in the [-1, 1] cube. They return false, after reporting to
+// std::cerr, for resolutions out of range.
+
+/**
+ * @brief GenerateUvSphere Unit sphere around the z axis made of stacks rings
+ * of sectors quads, with triangles at the poles. The first and last vertex of
+ * every ring share their position but not their texture coordinates.
+ */
+bool GenerateUvSphere(size_t sectors, size_t stacks, TriangleMesh *mesh);
+
+/**
+ * @brief GenerateIcosphere Unit sphere made by splitting every edge of an
+ * icosahedron into frequency segments and every face into frequency^2
+ * triangles projected onto the sphere. The 10 * frequency^2 + 2 vertices are
+ * shared by all the faces around them, so the texture coordinates, an
+ * equirectangular projection, wrap around at the seam.
+ */
+bool GenerateIcosphere(size_t frequency, TriangleMesh *mesh);
+
+/**
+ * @brief GenerateCubeSphere Unit sphere made by projecting a cube with
+ * resolution x resolution quads per face onto the sphere, with a mapping that
+ * keeps the quads close to the same area. Every face has its own vertices
+ * and the whole [0, 1] texture square.
+ */
+bool GenerateCubeSphere(size_t resolution, TriangleMesh *mesh);
+
+/**
+ * @brief GeneratePlane Square [-1, 1]^2 in the xy plane, facing +z, made of
+ * columns x rows quads.
+ */
+bool GeneratePlane(size_t columns, size_t rows, TriangleMesh *mesh);
+
+/**
+ * @brief GenerateTorus Torus around the z axis with a major radius of
+ * 1 - minor_radius, so it fits the unit sphere, made of rings sections of
+ * sides quads.
+ * @param minor_radius Radius of the tube, in (0, 0.5].
+ */
+bool GenerateTorus(size_t rings, size_t sides, float minor_radius,
+                   TriangleMesh *mesh);
+
+/**
+ * @brief GenerateBox Cube [-1, 1]^3 with resolution x resolution quads per
+ * face. Every face has its own vertices, flat normals and the whole [0, 1]
+ * texture square.
+ */
+bool GenerateBox(size_t resolution, TriangleMesh *mesh);
+
+/**
+ * @brief GenerateMesh Generates a shape by name with a single resolution:
+ * "uvsphere" (resolution sectors and resolution / 2 stacks), "icosphere"
+ * (frequency), "cubesphere", "plane", "torus" (resolution rings of
+ * resolution / 4 sides around a 0.25 tube) or "box".
+ * @return Whether the shape is known and could be generated.
+ */
+bool GenerateMesh(const std::string &shape, size_t resolution,
+                  TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_GENERATORS_H_
@@ -2,16 +2,31 @@
 
 #include <mesh_io.h>
 
-#include <assert.h>
-
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <math.h>
 
+#include "./float_parser.h"
+#include "./gltf_format.h"
+#include "./mapped_file.h"
+#include "./mesh_analysis.h"
+#include "./mesh_normals.h"
+#include "./mesh_triangulate.h"
+#include "./mesh_weld.h"
+#include "./obj_parser.h"
+#include "./parallel_for.h"
+#include "./ply_format.h"
+#include "./point_cloud.h"
 #include "./triangle_mesh.h"
 #include "./tiny_obj_loader.h"
 
@@ -21,141 +36,6 @@ namespace data_representation {
 
 namespace {
 
-template <typename T>
-void Add3Items(T i1, T i2, T i3, size_t index, std::vector<T> *vector) {
-  (*vector)[index] = i1;
-  (*vector)[index + 1] = i2;
-  (*vector)[index + 2] = i3;
-}
-
-bool ReadPlyHeader(std::ifstream *fin, int *vertices, int *faces) {
-  char line[100];
-
-  fin->getline(line, 100);
-  if (strncmp(line, "ply", 3) != 0) return false;
-
-  *vertices = 0;
-  fin->getline(line, 100);
-  while (strncmp(line, "end_header", 10) != 0) {
-    if (strncmp(line, "element vertex", 14) == 0) *vertices = atoi(&line[15]);
-    fin->getline(line, 100);
-    if (strncmp(line, "element face", 12) == 0) *faces = atoi(&line[13]);
-    if (strncmp(line, "property float n", 16) == 0) hasNormals = true;
-  }
-
-  if (*vertices <= 0) return false;
-
-  std::cout << "Loading triangle mesh" << std::endl;
-  std::cout << "\tVertices = " << *vertices << std::endl;
-  std::cout << "\tFaces = " << *faces << std::endl;
-
-  return true;
-}
-
-void ReadPlyVertices(std::ifstream *fin, TriangleMesh *mesh) {
-  const size_t kVertices = mesh->vertices_.size() / 3;
-  for (size_t i = 0; i < kVertices; ++i) {
-    float x, y, z;
-    fin->read(reinterpret_cast<char *>(&x), sizeof(float));
-    fin->read(reinterpret_cast<char *>(&y), sizeof(float));
-    fin->read(reinterpret_cast<char *>(&z), sizeof(float));
-
-    Add3Items(x, y, z, i * 3, &(mesh->vertices_));
-    if(hasNormals) {
-        fin->read(reinterpret_cast<char *>(&x), sizeof(float));
-        fin->read(reinterpret_cast<char *>(&y), sizeof(float));
-        fin->read(reinterpret_cast<char *>(&z), sizeof(float));
-
-        Add3Items(x, y, z, i * 3, &(mesh->normals_));
-    }
-  }
-}
-
-void ReadPlyFaces(std::ifstream *fin, TriangleMesh *mesh) {
-  unsigned char vertex_per_face;
-
-  const size_t kFaces = mesh->faces_.size() / 3;
-  for (size_t i = 0; i < kFaces; ++i) {
-    int v1, v2, v3;
-    fin->read(reinterpret_cast<char *>(&vertex_per_face),
-              sizeof(unsigned char));
-    assert(vertex_per_face == 3);
-
-    fin->read(reinterpret_cast<char *>(&v1), sizeof(int));
-    fin->read(reinterpret_cast<char *>(&v2), sizeof(int));
-    fin->read(reinterpret_cast<char *>(&v3), sizeof(int));
-    Add3Items(v1, v2, v3, i * 3, &(mesh->faces_));
-  }
-}
-
-void ComputeVertexNormals(const std::vector<float> &vertices,
-                          const std::vector<int> &faces,
-                          std::vector<float> *normals) {
-  const size_t kFaces = faces.size();
-  std::vector<float> face_normals(kFaces, 0);
-
-  for (size_t i = 0; i < kFaces; i += 3) {
-    Eigen::Vector3d v1(vertices[faces[i] * 3], vertices[faces[i] * 3 + 1],
-                       vertices[faces[i] * 3 + 2]);
-    Eigen::Vector3d v2(vertices[faces[i + 1] * 3],
-                       vertices[faces[i + 1] * 3 + 1],
-                       vertices[faces[i + 1] * 3 + 2]);
-    Eigen::Vector3d v3(vertices[faces[i + 2] * 3],
-                       vertices[faces[i + 2] * 3 + 1],
-                       vertices[faces[i + 2] * 3 + 2]);
-    Eigen::Vector3d v1v2 = v2 - v1;
-    Eigen::Vector3d v1v3 = v3 - v1;
-    Eigen::Vector3d normal = v1v2.cross(v1v3);
-
-    if (normal.norm() < 0.00001) {
-      normal = Eigen::Vector3d(0.0, 0.0, 0.0);
-    } else {
-      normal.normalize();
-    }
-
-    for (size_t j = 0; j < 3; ++j) face_normals[i + j] = normal[j];
-  }
-
-  const size_t kVertices = vertices.size();
-  normals->resize(kVertices, 0);
-  for (size_t i = 0; i < kFaces; i += 3) {
-    for (size_t j = 0; j < 3; ++j) {
-      size_t idx = static_cast<size_t>(faces[i + j]);
-      Eigen::Vector3d v1(vertices[faces[i + j] * 3],
-                         vertices[faces[i + j] * 3 + 1],
-                         vertices[faces[i + j] * 3 + 2]);
-      Eigen::Vector3d v2(vertices[faces[i + (j + 1) % 3] * 3],
-                         vertices[faces[i + (j + 1) % 3] * 3 + 1],
-                         vertices[faces[i + (j + 1) % 3] * 3 + 2]);
-      Eigen::Vector3d v3(vertices[faces[i + (j + 2) % 3] * 3],
-                         vertices[faces[i + (j + 2) % 3] * 3 + 1],
-                         vertices[faces[i + (j + 2) % 3] * 3 + 2]);
-
-      Eigen::Vector3d v1v2 = v2 - v1;
-      Eigen::Vector3d v1v3 = v3 - v1;
-      double angle = acos(v1v2.dot(v1v3) / (v1v2.norm() * v1v3.norm()));
-
-      if (angle == angle) {
-        for (size_t k = 0; k < 3; ++k) {
-          (*normals)[idx * 3 + k] += face_normals[i + k] * angle;
-        }
-      }
-    }
-  }
-
-  const size_t kNormals = normals->size();
-  for (size_t i = 0; i < kNormals; i += 3) {
-    Eigen::Vector3d normal((*normals)[i], (*normals)[i + 1], (*normals)[i + 2]);
-    if (normal.norm() > 0) {
-      normal.normalize();
-    } else {
-      normal = Eigen::Vector3d(0, 0, 0);
-    }
-
-    for (size_t j = 0; j < 3; ++j) (*normals)[i + j] = normal[j];
-  }
-}
-
 void ComputeTexCoords(const std::vector<float> &vertices,
                       std::vector<float> *texCoords) {
 
@@ -176,7 +56,10 @@ void ComputeTexCoords(const std::vector<float> &vertices,
     }
 
 }
-void ComputeBoundingBox(const std::vector<float> vertices, TriangleMesh *mesh) {
+// Grows the bounding box of mesh to contain vertices. Used where the vertices
+// are not all available to AnalyzeMesh at once.
+void ComputeBoundingBox(const std::vector<float> &vertices,
+                        TriangleMesh *mesh) {
   const size_t kVertices = vertices.size() / 3;
   for (size_t i = 0; i < kVertices; ++i) {
     mesh->min_[0] = std::min(mesh->min_[0], vertices[i * 3]);
@@ -189,50 +72,356 @@ void ComputeBoundingBox(const std::vector<float> vertices, TriangleMesh *mesh) {
   }
 }
 
+// Binary STL layout: an 80 byte header, the facet count and 50 byte facets
+// made of a normal, three vertices and a 16 bit attribute.
+const size_t kStlHeaderBytes = 84;
+const size_t kStlFacetBytes = 50;
+
+// Below this many facets per thread decoding is not worth a thread.
+const size_t kMinStlFacets = 1 << 15;
+
+// Returns the next whitespace separated token of an ascii body in
+// [*token, *token_end) and moves cursor past it.
+bool NextToken(const char *end, const char **cursor, const char **token,
+               const char **token_end) {
+  const char *p = *cursor;
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+  *token = p;
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+  *token_end = p;
+  *cursor = p;
+  return p > *token;
+}
+
+// Parses the three coordinates that follow an ascii STL vertex keyword.
+bool ParseStlVertex(const char *end, const char **cursor, float *position) {
+  const char *token, *token_end;
+  for (int i = 0; i < 3; ++i) {
+    // ParseFloat does not depend on the locale, unlike strtof.
+    if (!NextToken(end, cursor, &token, &token_end) ||
+        ParseFloat(token, token_end, &position[i]) != token_end)
+      return false;
+  }
+  return true;
+}
+
+// Below this many triangles per thread grouping them is not worth a thread.
+const size_t kMinGroupTriangles = 1 << 16;
+
+// Reorders the triangles of corners, three corners each, so the triangles of
+// every material are contiguous, stably, and returns the runs in ranges.
+// Runs are ordered by diffuse map, so the ones that share a texture are
+// adjacent, and then by material id. Faces without a (known) material form
+// the run of id -1, which has no texture.
+void GroupByMaterial(const std::vector<int> &triangle_materials,
+                     const std::vector<tinyobj::material_t> &materials,
+                     const std::string &base_dir,
+                     std::vector<tinyobj::index_t> *corners,
+                     std::vector<TriangleMesh::MaterialRange> *ranges) {
+  // Slot m + 1 holds material m.
+  const size_t kSlots = materials.size() + 1;
+  std::vector<size_t> order(kSlots);
+  for (size_t i = 0; i < kSlots; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    const std::string kNone;
+    const std::string &kA = a == 0 ? kNone : materials[a - 1].diffuse_texname;
+    const std::string &kB = b == 0 ? kNone : materials[b - 1].diffuse_texname;
+    return kA < kB;
+  });
+  std::vector<size_t> rank(kSlots);
+  for (size_t i = 0; i < kSlots; ++i) rank[order[i]] = i;
+  auto Rank = [&](int material) {
+    const bool kKnown =
+        material >= 0 && static_cast<size_t>(material) < materials.size();
+    return rank[kKnown ? material + 1 : 0];
+  };
+
+  // Counting sort: every range counts its triangles per rank, and the counts
+  // give every (rank, range) pair its place in the output.
+  const size_t kTriangles = triangle_materials.size();
+  const size_t kRanges = RangeCount(kTriangles, kMinGroupTriangles);
+  std::vector<size_t> counts(kRanges * kSlots, 0);
+  ParallelFor(kTriangles, kMinGroupTriangles,
+              [&](size_t range, size_t first, size_t last) {
+                size_t *range_counts = &counts[range * kSlots];
+                for (size_t t = first; t < last; ++t)
+                  ++range_counts[Rank(triangle_materials[t])];
+              });
+
+  ranges->clear();
+  std::vector<size_t> offsets(kRanges * kSlots);
+  size_t offset = 0;
+  for (size_t r = 0; r < kSlots; ++r) {
+    const size_t kFirst = offset;
+    for (size_t range = 0; range < kRanges; ++range) {
+      offsets[range * kSlots + r] = offset;
+      offset += counts[range * kSlots + r];
+    }
+    if (offset == kFirst) continue;
+    TriangleMesh::MaterialRange material_range;
+    material_range.first = kFirst * 3;
+    material_range.count = (offset - kFirst) * 3;
+    const size_t kSlot = order[r];
+    if (kSlot > 0 && !materials[kSlot - 1].diffuse_texname.empty()) {
+      material_range.diffuse_map =
+          base_dir + "/" + materials[kSlot - 1].diffuse_texname;
+    }
+    ranges->push_back(material_range);
+  }
+  if (ranges->size() < 2) return;
+
+  std::vector<tinyobj::index_t> grouped(corners->size());
+  ParallelFor(kTriangles, kMinGroupTriangles,
+              [&](size_t range, size_t first, size_t last) {
+                size_t *range_offsets = &offsets[range * kSlots];
+                for (size_t t = first; t < last; ++t) {
+                  const size_t kTo =
+                      range_offsets[Rank(triangle_materials[t])]++;
+                  std::copy(corners->begin() + t * 3,
+                            corners->begin() + t * 3 + 3,
+                            grouped.begin() + kTo * 3);
+                }
+              });
+  corners->swap(grouped);
+}
+
+// Reports percent to progress, if any. Returns false when the load has been
+// cancelled.
+bool Continue(LoadProgress *progress, int percent) {
+  return progress == nullptr || progress->Report(percent);
+}
+
 }  // namespace
 
-bool ReadFromPly(const std::string &filename, TriangleMesh *mesh) {
-  std::ifstream fin;
+bool ReadFromPly(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress) {
+  const auto kStart = std::chrono::steady_clock::now();
 
-  fin.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
-  if (!fin.is_open() || !fin.good()) return false;
+  MappedFile file;
+  if (!file.Open(filename)) return false;
 
-  int vertices = 0, faces = 0;
-  if (!ReadPlyHeader(&fin, &vertices, &faces)) {
-    fin.close();
+  PlyHeader header;
+  PlyMeshDecoder decoder;
+  if (!ReadPlyHeader(file.data(), file.size(), &header) ||
+      !decoder.Compile(header))
     return false;
+
+  std::cout << "Loading triangle mesh" << std::endl;
+  std::cout << "\tVertices = " << header.Find("vertex")->count << std::endl;
+  std::cout << "\tFaces = "
+            << (header.Find("face") ? header.Find("face")->count : 0)
+            << std::endl;
+  if (!Continue(progress, 5)) return false;
+
+  if (!decoder.Decode(file.data(), file.size(), mesh)) {
+    std::cerr << "The PLY data does not match its header." << std::endl;
+    return false;
+  }
+  file.Close();
+  if (!Continue(progress, 60)) return false;
+
+  if (mesh->faces_.empty()) {
+    // A point cloud: normals are fitted to the nearest neighbours and the
+    // points are shuffled, so the renderer can draw any prefix of them as a
+    // subsample.
+    mesh->pointSpacing_ = EstimatePointNormals(
+        mesh->vertices_, kPointNeighbours,
+        decoder.has_normals() ? nullptr : &mesh->normals_);
+    ShufflePoints(mesh);
+    std::cout << "\tPoint spacing = " << mesh->pointSpacing_ << std::endl;
+  } else if (!decoder.has_normals()) {
+    mesh->computeNormals();
   }
+  if (!Continue(progress, 85)) return false;
+  if (!decoder.has_tex_coords())
+    ComputeTexCoords(mesh->vertices_, &mesh->texCoords_);
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
+  if (!Continue(progress, 95)) return false;
 
-  mesh->vertices_.resize(static_cast<size_t>(vertices) * 3);
-  if(hasNormals) mesh->normals_.resize(static_cast<size_t>(vertices) * 3);
-  ReadPlyVertices(&fin, mesh);
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  std::cout << "\tLoad time = " << kElapsed.count() << " ms" << std::endl;
 
-  mesh->faces_.resize(static_cast<size_t>(faces) * 3);
-  ReadPlyFaces(&fin, mesh);
+  return true;
+}
 
-  fin.close();
+bool StreamFromPly(const std::string &filename, size_t chunk_records,
+                   MeshStreamSink *sink, TriangleMesh *mesh,
+                   LoadProgress *progress) {
+  const auto kStart = std::chrono::steady_clock::now();
+  chunk_records = std::max<size_t>(chunk_records, 1);
 
-  if(!hasNormals) ComputeVertexNormals(mesh->vertices_, mesh->faces_, &mesh->normals_);
-  ComputeTexCoords(mesh->vertices_, &mesh->texCoords_);
-  ComputeBoundingBox(mesh->vertices_, mesh);
+  MappedFile file;
+  if (!file.Open(filename)) return false;
+
+  PlyHeader header;
+  PlyMeshDecoder decoder;
+  if (!ReadPlyHeader(file.data(), file.size(), &header) ||
+      !decoder.Compile(header) || !decoder.CanStream())
+    return false;
+
+  // ReadPlyHeader bounds the counts by the file size, so the arrays sized
+  // from them below cannot wrap.
+  const size_t kVertices = header.Find("vertex")->count;
+  const size_t kFaces = header.Find("face") ? header.Find("face")->count : 0;
+  if (kFaces == 0) {
+    // Point clouds need all of their points to estimate normals and shuffle.
+    std::cerr << "Point clouds are not streamed." << std::endl;
+    return false;
+  }
+  std::cout << "Streaming triangle mesh" << std::endl;
+  std::cout << "\tVertices = " << kVertices << std::endl;
+  std::cout << "\tFaces = " << kFaces << std::endl;
+
+  if (!sink->Begin(kVertices, kFaces, decoder.has_colors())) return false;
+
+  // Without normals in the file the positions have to outlive their chunk,
+  // and the normals are summed over every face before being sent: 24 bytes
+  // per vertex, still far from the whole mesh.
+  const bool kComputeNormals = !decoder.has_normals();
+  std::vector<float> positions;
+  std::vector<float> normals;
+  if (kComputeNormals) {
+    positions.resize(kVertices * 3);
+    normals.resize(kVertices * 3, 0);
+  }
+
+  // The records decoded so far, for the progress report.
+  const double kRecords = static_cast<double>(kVertices + kFaces);
+  size_t records = 0;
+  std::vector<float> tex_coords;
+  const bool kStreamed = decoder.DecodeChunks(
+      file.data(), file.size(), chunk_records,
+      [&](PlyMeshDecoder::Target target, size_t first, size_t count,
+          const TriangleMesh &chunk) {
+        records += count;
+        if (!Continue(progress, int(95.0 * double(records) / kRecords)))
+          return false;
+        if (target == PlyMeshDecoder::kIndex) {
+          if (kComputeNormals) {
+            AccumulateVertexNormals(positions, chunk.faces_.data(),
+                                    chunk.faces_.size(), &normals);
+          }
+          sink->AddFaces(first, count, chunk.faces_.data());
+          return true;
+        }
+
+        ComputeBoundingBox(chunk.vertices_, mesh);
+        // The whole mesh is never in memory, so its sphere is the one of
+        // its box.
+        if (first + count == kVertices) FitSphereToBox(mesh);
+        if (kComputeNormals) {
+          std::copy(chunk.vertices_.begin(), chunk.vertices_.end(),
+                    positions.begin() + first * 3);
+        }
+        if (!decoder.has_tex_coords())
+          ComputeTexCoords(chunk.vertices_, &tex_coords);
+        sink->AddVertices(first, count, chunk.vertices_.data(),
+                          kComputeNormals ? nullptr : chunk.normals_.data(),
+                          decoder.has_tex_coords() ? chunk.texCoords_.data()
+                                                   : tex_coords.data(),
+                          decoder.has_colors() ? chunk.colors_.data()
+                                               : nullptr);
+        return true;
+      });
+  if (!kStreamed) {
+    if (progress == nullptr || !progress->cancelled())
+      std::cerr << "The PLY data does not match its header." << std::endl;
+    return false;
+  }
+
+  if (kComputeNormals) {
+    NormalizeVertexNormals(&normals);
+    for (size_t first = 0; first < kVertices; first += chunk_records) {
+      sink->AddNormals(first, std::min(chunk_records, kVertices - first),
+                       normals.data() + first * 3);
+    }
+  }
+
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  std::cout << "\tLoad time = " << kElapsed.count() << " ms" << std::endl;
 
   return true;
 }
 
 bool WriteToPly(const std::string &filename, const TriangleMesh &mesh) {
-  (void)filename;
-  (void)mesh;
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  const size_t kFaces = mesh.faces_.size() / 3;
+  const bool kNormals = mesh.normals_.size() == kVertices * 3;
+  const bool kTexCoords = mesh.texCoords_.size() == kVertices * 2;
+  const bool kColors = mesh.colors_.size() == kVertices * 4;
+  const bool kQuality = mesh.quality_.size() == kVertices;
+
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "element vertex " << kVertices << "\n"
+         << "property float x\nproperty float y\nproperty float z\n";
+  if (kNormals)
+    header << "property float nx\nproperty float ny\nproperty float nz\n";
+  if (kTexCoords) header << "property float s\nproperty float t\n";
+  if (kColors) {
+    header << "property uchar red\nproperty uchar green\n"
+           << "property uchar blue\nproperty uchar alpha\n";
+  }
+  if (kQuality) header << "property float quality\n";
+  header << "element face " << kFaces << "\n"
+         << "property list uchar int vertex_indices\n"
+         << "end_header\n";
+  const std::string kHeader = header.str();
+
+  const size_t kVertexBytes =
+      (3 + (kNormals ? 3 : 0) + (kTexCoords ? 2 : 0) + (kQuality ? 1 : 0)) *
+          sizeof(float) +
+      (kColors ? 4 : 0);
+  const size_t kFaceBytes = sizeof(unsigned char) + 3 * sizeof(int);
+
+  // The whole file is assembled in memory and handed to the OS in one write.
+  std::vector<char> buffer(kHeader.size() + kVertices * kVertexBytes +
+                           kFaces * kFaceBytes);
+  char *out = buffer.data();
+  memcpy(out, kHeader.data(), kHeader.size());
+  out += kHeader.size();
 
-  std::cerr << "Not yet implemented" << std::endl;
+  for (size_t i = 0; i < kVertices; ++i) {
+    memcpy(out, &mesh.vertices_[i * 3], 3 * sizeof(float));
+    out += 3 * sizeof(float);
+    if (kNormals) {
+      memcpy(out, &mesh.normals_[i * 3], 3 * sizeof(float));
+      out += 3 * sizeof(float);
+    }
+    if (kTexCoords) {
+      memcpy(out, &mesh.texCoords_[i * 2], 2 * sizeof(float));
+      out += 2 * sizeof(float);
+    }
+    if (kColors) {
+      memcpy(out, &mesh.colors_[i * 4], 4);
+      out += 4;
+    }
+    if (kQuality) {
+      memcpy(out, &mesh.quality_[i], sizeof(float));
+      out += sizeof(float);
+    }
+  }
 
-  // TODO(students): Implement storing to PLY format.
+  for (size_t i = 0; i < kFaces; ++i) {
+    *out++ = 3;
+    memcpy(out, &mesh.faces_[i * 3], 3 * sizeof(int));
+    out += 3 * sizeof(int);
+  }
 
-  // END.
+  std::ofstream fout(filename.c_str(),
+                     std::ios_base::out | std::ios_base::binary);
+  if (!fout.is_open()) return false;
+  fout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  fout.close();
 
-  return false;
+  return fout.good();
 }
 
-bool ReadFromObj(const std::string &filename, TriangleMesh *mesh)
+bool ReadFromObj(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress)
 {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
@@ -243,7 +432,9 @@ bool ReadFromObj(const std::string &filename, TriangleMesh *mesh)
 
     std::string baseDir = filename.substr(0, filename.rfind("/"));
 
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename.c_str(),baseDir.c_str());
+    bool hasPolygons = false;
+    bool ret = LoadObjParallel(filename, baseDir + "/", &attrib, &shapes,
+                               &materials, &warn, &err, &hasPolygons);
 
     if (!warn.empty()) {
       std::cout << warn << std::endl;
@@ -253,157 +444,278 @@ bool ReadFromObj(const std::string &filename, TriangleMesh *mesh)
       std::cerr << err << std::endl;
     }
 
-    if (!ret) {
-      exit(1);
+    if (!ret || !Continue(progress, 50)) {
+      return false;
     }
 
-    int currentIndex = 0;
+    std::vector<tinyobj::index_t> corners;
+    std::vector<int> sizes;
+    std::vector<int> faceMaterials;
     for(const auto& shape: shapes)
     {
-        mesh->faces_.resize(mesh->faces_.size()+shape.mesh.indices.size());
-        mesh->vertices_.resize((mesh->vertices_.size()+shape.mesh.indices.size())*3);
-        if(attrib.normals.size() > 0)
-            mesh->normals_.resize((mesh->normals_.size()+shape.mesh.indices.size())*3);
-        if(attrib.texcoords.size() > 0)
-            mesh->texCoords_.resize((mesh->texCoords_.size()+shape.mesh.indices.size())*2);
-
-        for(const auto& nfv : shape.mesh.num_face_vertices)
-            if(size_t(nfv) != 3) {
-                std::cerr << "Only supports triangles." << std::endl;
-                exit(1);
-            }
+        corners.insert(corners.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+        if(hasPolygons)
+            sizes.insert(sizes.end(), shape.mesh.num_face_vertices.begin(), shape.mesh.num_face_vertices.end());
+        faceMaterials.insert(faceMaterials.end(), shape.mesh.material_ids.begin(), shape.mesh.material_ids.end());
+    }
 
-        for(const auto& index : shape.mesh.indices)
+    if(hasPolygons)
+    {
+        // Quads and larger polygons are split into triangles of their corners.
+        std::vector<int> positions(corners.size());
+        for(size_t i = 0; i < corners.size(); ++i)
+            positions[i] = corners[i].vertex_index;
+        std::vector<int> triangles;
+        TriangulatePolygons(attrib.vertices, positions, sizes, &triangles);
+
+        std::vector<tinyobj::index_t> triangulated(triangles.size());
+        ParallelFor(triangles.size(), 1 << 16, [&](size_t, size_t first, size_t last) {
+            for(size_t i = first; i < last; ++i)
+                triangulated[i] = corners[triangles[i]];
+        });
+        std::cout << "Triangulated " << sizes.size() << " polygons into "
+                  << triangles.size() / 3 << " triangles" << std::endl;
+        corners.swap(triangulated);
+
+        // Every triangle keeps the material of its polygon.
+        std::vector<int> triangleMaterials;
+        triangleMaterials.reserve(corners.size() / 3);
+        for(size_t f = 0; f < sizes.size(); ++f)
+            triangleMaterials.insert(triangleMaterials.end(), std::max(sizes[f] - 2, 0), faceMaterials[f]);
+        faceMaterials.swap(triangleMaterials);
+    }
+
+    if(!materials.empty())
+        GroupByMaterial(faceMaterials, materials, baseDir, &corners, &mesh->materialRanges_);
+
+    // Corners with the same position, normal and texture coordinate become a
+    // single shared vertex.
+    std::vector<int> firsts;
+    const size_t kVertices = WeldCorners(corners, &mesh->faces_, &firsts);
+    mesh->unweldedVertices_ = corners.size();
+    if (!Continue(progress, 65)) return false;
+
+    // Normals and texture coordinates are optional per corner ("f v//vn",
+    // "f v/vt"). Normals are computed if any corner lacks one.
+    const bool kHasNormals = !attrib.normals.empty() &&
+        std::none_of(corners.begin(), corners.end(),
+                     [](const tinyobj::index_t& index) { return index.normal_index < 0; });
+
+    mesh->vertices_.resize(kVertices*3);
+    if(kHasNormals)
+        mesh->normals_.resize(kVertices*3);
+    if(attrib.texcoords.size() > 0)
+        mesh->texCoords_.resize(kVertices*2);
+
+    ParallelFor(kVertices, 1 << 16, [&](size_t, size_t first, size_t last) {
+        for(size_t i = first; i < last; ++i)
         {
-            //auto currentIndex = mesh->faces_.size();
-            mesh->faces_[currentIndex] = currentIndex;
+            const tinyobj::index_t& index = corners[firsts[i]];
 
-            mesh->vertices_[3*currentIndex]   = attrib.vertices[3*index.vertex_index];
-            mesh->vertices_[3*currentIndex+1] = attrib.vertices[3*index.vertex_index+1];
-            mesh->vertices_[3*currentIndex+2] = attrib.vertices[3*index.vertex_index+2];
+            mesh->vertices_[3*i]   = attrib.vertices[3*index.vertex_index];
+            mesh->vertices_[3*i+1] = attrib.vertices[3*index.vertex_index+1];
+            mesh->vertices_[3*i+2] = attrib.vertices[3*index.vertex_index+2];
 
-            if(attrib.normals.size() > 0) {
-                mesh->normals_[3*currentIndex]   = attrib.normals[3*index.normal_index];
-                mesh->normals_[3*currentIndex+1] = attrib.normals[3*index.normal_index+1];
-                mesh->normals_[3*currentIndex+2] = attrib.normals[3*index.normal_index+2];
+            if(kHasNormals) {
+                mesh->normals_[3*i]   = attrib.normals[3*index.normal_index];
+                mesh->normals_[3*i+1] = attrib.normals[3*index.normal_index+1];
+                mesh->normals_[3*i+2] = attrib.normals[3*index.normal_index+2];
             }
 
-            if(attrib.texcoords.size() > 0) {
-                mesh->texCoords_[2*currentIndex]   = attrib.texcoords[2*index.texcoord_index];
-                mesh->texCoords_[2*currentIndex+1] = 1.f -attrib.texcoords[2*index.texcoord_index+1];
+            if(attrib.texcoords.size() > 0 && index.texcoord_index >= 0) {
+                mesh->texCoords_[2*i]   = attrib.texcoords[2*index.texcoord_index];
+                mesh->texCoords_[2*i+1] = 1.f -attrib.texcoords[2*index.texcoord_index+1];
+            } else if(attrib.texcoords.size() > 0) {
+                mesh->texCoords_[2*i]   = 0.f;
+                mesh->texCoords_[2*i+1] = 0.f;
             }
-
-            //std::cout << mesh->vertices_[3*currentIndex] << " " << mesh->vertices_[3*currentIndex+1] << " " << mesh->vertices_[3*currentIndex+2] << std::endl;
-
-            currentIndex++;
         }
-    }
+    });
 
-    if(attrib.normals.size() == 0)
-        ComputeVertexNormals(mesh->vertices_, mesh->faces_, &mesh->normals_);
+    std::cout << "Vertices welded from " << corners.size() << " to "
+              << kVertices << std::endl;
+    if (!Continue(progress, 75)) return false;
 
-    ComputeBoundingBox(mesh->vertices_, mesh);
+    if(!kHasNormals)
+        mesh->computeNormals();
+    if (!Continue(progress, 90)) return false;
+
+    AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
 
-    if(materials.size() > 0)
-    {
-        mesh->diffuseMap_ = baseDir+"/"+materials[0].diffuse_texname;
-    }
     //for(auto i = 0; i < mesh->texCoords_.size(); i+=2)
     //    std::cout << mesh->texCoords_[i] << " " << mesh->texCoords_[i+1] << std::endl;
 
+    return true;
 }
 
-bool CreateSphere(TriangleMesh *mesh)
-{
-    // clear memory of prev arrays
-    std::vector<float> vertices;
-    std::vector<float> normals;
-    std::vector<float> texCoords;
-    float radius = 1;
-    float sectorCount = 64;
-    float stackCount =  64;
-    float PI = 3.141592;
-
-    float x, y, z, xy;                              // vertex position
-    float nx, ny, nz, lengthInv = 1.0f / radius;    // vertex normal
-    float s, t;                                     // vertex texCoord
-
-    float sectorStep = 2 * PI / sectorCount;
-    float stackStep = PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    for(int i = 0; i <= stackCount; ++i)
-    {
-        stackAngle = PI / 2 - i * stackStep;        // starting from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);             // r * cos(u)
-        z = radius * sinf(stackAngle);              // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal, but different tex coords
-        for(int j = 0; j <= sectorCount; ++j)
-        {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-            // vertex position (x, y, z)
-            x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            // normalized vertex normal (nx, ny, nz)
-            nx = x * lengthInv;
-            ny = y * lengthInv;
-            nz = z * lengthInv;
-            normals.push_back(nx);
-            normals.push_back(ny);
-            normals.push_back(nz);
-
-            // vertex tex coord (s, t) range between [0, 1]
-            s = (float)j / sectorCount;
-            t = (float)i / stackCount;
-            texCoords.push_back(s);
-            texCoords.push_back(t);
-        }
+bool ReadFromStl(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress) {
+  const auto kStart = std::chrono::steady_clock::now();
+
+  MappedFile file;
+  if (!file.Open(filename)) return false;
+  const char *kData = file.data();
+  const size_t kSize = file.size();
+
+  // Binary files may also start with "solid", so the size decides.
+  uint32_t facets = 0;
+  if (kSize >= kStlHeaderBytes)
+    memcpy(&facets, kData + kStlHeaderBytes - 4, sizeof(facets));
+  const bool kBinary = kSize >= kStlHeaderBytes &&
+                       kSize == kStlHeaderBytes + facets * kStlFacetBytes;
+
+  // Triangle soup: three positions per facet.
+  std::vector<float> corners;
+  if (kBinary) {
+    corners.resize(size_t(facets) * 9);
+    ParallelFor(facets, kMinStlFacets, [&](size_t, size_t first,
+                                           size_t last) {
+      const char *facet = kData + kStlHeaderBytes + first * kStlFacetBytes;
+      for (size_t f = first; f < last; ++f, facet += kStlFacetBytes)
+        memcpy(&corners[f * 9], facet + 3 * sizeof(float), 9 * sizeof(float));
+    });
+  } else if (kSize >= 5 && memcmp(kData, "solid", 5) == 0) {
+    const char *cursor = kData;
+    const char *kEnd = kData + kSize;
+    const char *token, *token_end;
+    float position[3];
+    while (NextToken(kEnd, &cursor, &token, &token_end)) {
+      if (token_end - token != 6 || memcmp(token, "vertex", 6) != 0) continue;
+      if (!ParseStlVertex(kEnd, &cursor, position)) {
+        std::cerr << "The STL vertex is not valid." << std::endl;
+        return false;
+      }
+      corners.insert(corners.end(), position, position + 3);
+    }
+    if (corners.size() % 9 != 0) {
+      std::cerr << "The STL facets are not triangles." << std::endl;
+      return false;
     }
+  } else {
+    std::cerr << "Not an STL file." << std::endl;
+    return false;
+  }
+  file.Close();
+
+  const size_t kCorners = corners.size() / 3;
+  if (kCorners > size_t(std::numeric_limits<int>::max())) return false;
+  std::cout << "Loading triangle soup" << std::endl;
+  std::cout << "\tFaces = " << kCorners / 3 << std::endl;
+  if (!Continue(progress, 40)) return false;
+
+  // Corners at the same position become a single shared vertex.
+  std::vector<int> firsts;
+  const size_t kVertices = WeldPositions(corners, &mesh->faces_, &firsts);
+  mesh->unweldedVertices_ = kCorners;
+  mesh->vertices_.resize(kVertices * 3);
+  ParallelFor(kVertices, 1 << 16, [&](size_t, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i)
+      memcpy(&mesh->vertices_[i * 3], &corners[size_t(firsts[i]) * 3],
+             3 * sizeof(float));
+  });
+  std::cout << "\tVertices welded from " << kCorners << " to " << kVertices
+            << std::endl;
+  if (!Continue(progress, 70)) return false;
+
+  mesh->computeNormals();
+  if (!Continue(progress, 90)) return false;
+  ComputeTexCoords(mesh->vertices_, &mesh->texCoords_);
+  AnalyzeMesh(mesh->vertices_, mesh->faces_, mesh);
 
-    std::vector<int> indices;
-    int k1, k2;
-    for(int i = 0; i < stackCount; ++i)
-    {
-        k1 = i * (sectorCount + 1);     // beginning of current stack
-        k2 = k1 + sectorCount + 1;      // beginning of next stack
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  std::cout << "\tLoad time = " << kElapsed.count() << " ms" << std::endl;
 
-        for(int j = 0; j < sectorCount; ++j, ++k1, ++k2)
-        {
-            // 2 triangles per sector excluding first and last stacks
-            // k1 => k2 => k1+1
-            if(i != 0)
-            {
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
-            }
+  return true;
+}
 
-            // k1+1 => k2 => k2+1
-            if(i != (stackCount-1))
-            {
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
-            }
-        }
+bool ReadFromGlb(const std::string &filename, GlbFile *glb, TriangleMesh *mesh,
+                 LoadProgress *progress) {
+  const auto kStart = std::chrono::steady_clock::now();
+  if (!glb->Open(filename) || !Continue(progress, 10)) return false;
+
+  const std::vector<GltfPrimitive> &kPrimitives = glb->primitives();
+  size_t vertices = 0, corners = 0;
+  bool normals = true, tex_coords = true;
+  for (const GltfPrimitive &primitive : kPrimitives) {
+    vertices += primitive.positions.count;
+    corners += primitive.indices.data ? primitive.indices.count
+                                      : primitive.positions.count;
+    normals = normals && primitive.normals.data != nullptr;
+    tex_coords = tex_coords && primitive.tex_coords.data != nullptr;
+  }
+  if (vertices > size_t(std::numeric_limits<int>::max())) return false;
+  std::cout << "Loading glTF binary" << std::endl;
+  std::cout << "\tVertices = " << vertices << std::endl;
+  std::cout << "\tFaces = " << corners / 3 << std::endl;
+
+  const bool kCopyPositions = !glb->ZeroCopy(GltfAttribute::kPosition);
+  const bool kCopyNormals = !glb->ZeroCopy(GltfAttribute::kNormal);
+  const bool kCopyTexCoords = !glb->ZeroCopy(GltfAttribute::kTexCoord);
+  const bool kCopyIndices = !glb->ZeroCopy(GltfAttribute::kIndex);
+
+  // Computing normals needs the positions and indices on the CPU, but they
+  // are kept out of mesh unless they have to be uploaded from there.
+  std::vector<float> positions(kCopyPositions || !normals ? vertices * 3 : 0);
+  std::vector<int> faces(kCopyIndices || !normals ? corners : 0);
+  if (kCopyNormals && normals) mesh->normals_.resize(vertices * 3);
+  if (kCopyTexCoords && tex_coords) mesh->texCoords_.resize(vertices * 2);
+
+  size_t first_vertex = 0, first_corner = 0;
+  for (const GltfPrimitive &primitive : kPrimitives) {
+    const size_t kCount = primitive.positions.count;
+    if (!positions.empty())
+      primitive.positions.DecodeFloats(&positions[first_vertex * 3]);
+    if (!mesh->normals_.empty())
+      primitive.normals.DecodeFloats(&mesh->normals_[first_vertex * 3]);
+    if (!mesh->texCoords_.empty())
+      primitive.tex_coords.DecodeFloats(&mesh->texCoords_[first_vertex * 2]);
+
+    if (!faces.empty() && primitive.indices.data) {
+      primitive.indices.DecodeIndices(static_cast<int>(first_vertex),
+                                      &faces[first_corner]);
+      first_corner += primitive.indices.count;
+    } else if (!faces.empty()) {
+      for (size_t i = 0; i < kCount; ++i)
+        faces[first_corner++] = static_cast<int>(first_vertex + i);
     }
 
-    mesh->faces_ = indices;
-    mesh->vertices_ = vertices;
-    mesh->normals_ = normals;
-    mesh->texCoords_ = texCoords;
+    if (primitive.has_bounds) {
+      mesh->min_ = mesh->min_.cwiseMin(primitive.min);
+      mesh->max_ = mesh->max_.cwiseMax(primitive.max);
+    } else {
+      std::vector<float> bounds(kCount * 3);
+      primitive.positions.DecodeFloats(bounds.data());
+      ComputeBoundingBox(bounds, mesh);
+    }
+    first_vertex += kCount;
+  }
+  if (!Continue(progress, 50)) return false;
+
+  if (!normals)
+    ComputeVertexNormals(positions, faces, &mesh->normals_);
+  if (!tex_coords) {
+    if (positions.empty()) {
+      positions.resize(vertices * 3);
+      kPrimitives[0].positions.DecodeFloats(positions.data());
+    }
+    ComputeTexCoords(positions, &mesh->texCoords_);
+  }
+  if (!Continue(progress, 90)) return false;
 
-    ComputeBoundingBox(mesh->vertices_, mesh);
+  // Without the positions on the CPU only the accessor bounds are known.
+  if (!positions.empty())
+    AnalyzeMesh(positions, faces, mesh);
+  else
+    FitSphereToBox(mesh);
+  if (kCopyPositions) mesh->vertices_.swap(positions);
+  if (kCopyIndices) mesh->faces_.swap(faces);
 
-    return true;
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+  std::cout << "\tLoad time = " << kElapsed.count() << " ms" << std::endl;
 
+  return true;
 }
 
 }  // namespace data_representation
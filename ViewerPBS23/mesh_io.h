@@ -5,24 +5,132 @@
 
 #include <triangle_mesh.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace data_representation {
 
-static bool hasNormals = false;
+/**
+ * @brief The LoadProgress class Lets a load running on another thread report
+ * how far it got and be cancelled. The readers only look at it between their
+ * stages, so cancelling takes effect at the next stage boundary.
+ */
+class LoadProgress {
+ public:
+  /**
+   * @brief Callback Receives the percentage, on the thread of the load.
+   */
+  typedef std::function<void(int percent)> Callback;
+
+  explicit LoadProgress(const Callback &on_report = Callback())
+      : on_report_(on_report), cancelled_(false) {}
+
+  /**
+   * @brief Report Called by the load once percent of the work is done.
+   * @return Whether the load should go on, false once it is cancelled.
+   */
+  bool Report(int percent) {
+    if (on_report_) on_report_(percent);
+    return !cancelled();
+  }
+
+  /**
+   * @brief Cancel Asks the load to stop at its next Report. Thread safe.
+   */
+  void Cancel() { cancelled_ = true; }
+
+  bool cancelled() const { return cancelled_; }
+
+ private:
+  Callback on_report_;
+  std::atomic<bool> cancelled_;
+};
 
 /**
- * @brief ReadFromPly Read the mesh stored in PLY format at the path filename
- * and stores the corresponding TriangleMesh representation
+ * @brief ReadFromPly Read the mesh stored in PLY format (ascii or binary, any
+ * scalar types and property order) at the path filename and stores the
+ * corresponding TriangleMesh representation. Normals and texture coordinates
+ * are read from the file when present and computed otherwise; vertex colors
+ * (red, green, blue and optional alpha) and quality are only read. Files
+ * without faces are read as point clouds: their normals are estimated from the
+ * nearest neighbours of every point, pointSpacing_ is measured and the points
+ * are shuffled (see ShufflePoints).
  * @param filename The path to the PLY mesh.
  * @param mesh The resulting representation with computed per-vertex normals.
- * @return Whether it was able to read the file.
+ * @param progress Optional progress report and cancellation of the read.
+ * @return Whether it was able to read the file and was not cancelled.
+ */
+bool ReadFromPly(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress = nullptr);
+
+/**
+ * @brief The MeshStreamSink class Receives the geometry produced by
+ * StreamFromPly chunk by chunk. The pointers are only valid during the call.
+ */
+class MeshStreamSink {
+ public:
+  virtual ~MeshStreamSink() {}
+
+  /**
+   * @brief Begin Called once before any chunk with the final sizes.
+   * @param colors Whether the vertices come with colors.
+   * @return Whether the sink is able to hold them.
+   */
+  virtual bool Begin(size_t vertices, size_t faces, bool colors) = 0;
+
+  /**
+   * @brief AddVertices The vertices [first, first + count). normals is
+   * nullptr when the file has none; they are then sent with AddNormals once
+   * every face has been read. colors, four bytes per vertex, is nullptr
+   * unless Begin announced them.
+   */
+  virtual void AddVertices(size_t first, size_t count, const float *vertices,
+                           const float *normals, const float *tex_coords,
+                           const uint8_t *colors) = 0;
+
+  /**
+   * @brief AddFaces The faces [first, first + count), three indices each.
+   */
+  virtual void AddFaces(size_t first, size_t count, const int *faces) = 0;
+
+  /**
+   * @brief AddNormals The computed normals of the vertices
+   * [first, first + count).
+   */
+  virtual void AddNormals(size_t first, size_t count,
+                          const float *normals) = 0;
+};
+
+/**
+ * @brief StreamFromPly Reads a binary PLY in chunks of at most chunk_records
+ * vertices or faces and hands each one to sink as soon as it is decoded, so
+ * the whole mesh is never held in memory. Memory use peaks at one chunk,
+ * plus 24 bytes per vertex if the file has no normals: the positions, to
+ * weight the normals of every face chunk, and the normals accumulated from
+ * them, which are only complete once every face has been read.
+ * @param filename The path to the PLY mesh.
+ * @param chunk_records Maximum number of vertices or faces per chunk.
+ * @param sink Receiver of the chunks.
+ * @param mesh Receives the bounding box; its arrays are left empty.
+ * @param progress Optional progress report and cancellation, checked between
+ * chunks.
+ * @return Whether it was able to stream the file and was not cancelled.
+ * ASCII files, point clouds and layouts that are not fixed size (other than
+ * triangle lists) cannot be streamed. Quality is not streamed, since it is
+ * normalized over its whole range.
  */
-bool ReadFromPly(const std::string &filename, TriangleMesh *mesh);
+bool StreamFromPly(const std::string &filename, size_t chunk_records,
+                   MeshStreamSink *sink, TriangleMesh *mesh,
+                   LoadProgress *progress = nullptr);
 
 /**
- * @brief WriteToPly Stores the mesh representation in PLY format at the path
- * filename.
+ * @brief WriteToPly Stores the mesh representation in binary little endian
+ * PLY format at the path filename. Normals, texture coordinates, colors and
+ * quality are written when the mesh has one per vertex.
  * @param filename The path where the mesh will be stored.
  * @param mesh The mesh to be stored.
  * @return Whether it was able to store the file.
@@ -31,20 +139,50 @@ bool WriteToPly(const std::string &filename, const TriangleMesh &mesh);
 
 /**
  * @brief ReadFromObj Read the mesh stored in OBJ format at the path filename
- * and stores the corresponding TriangleMesh representation. It only works for
- * models with a unique material.
+ * and stores the corresponding TriangleMesh representation. Face corners that
+ * share position, normal and texture coordinate indices are welded into a
+ * single indexed vertex. The faces are grouped by material and every group
+ * is recorded in materialRanges_, with the path of its diffuse map, so the
+ * viewer draws each one with its own texture; faces without a material form
+ * a group without texture.
  * @param filename The path to the OBJ mesh.
  * @param mesh The resulting representation with computed per-vertex normals.
- * @return Whether it was able to read the file.
+ * @param progress Optional progress report and cancellation of the read.
+ * @return Whether it was able to read the file and was not cancelled.
  */
-bool ReadFromObj(const std::string &filename, TriangleMesh *mesh);
+bool ReadFromObj(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress = nullptr);
 
 /**
- * @brief CreateSphere Creates an sphere
+ * @brief ReadFromStl Read the triangle soup stored in STL format (binary or
+ * ascii) at the path filename and stores it as an indexed TriangleMesh.
+ * Binary facets are decoded in parallel batches and corners with the same
+ * position are welded into a single vertex. The facet normals are ignored and
+ * smooth per-vertex normals are computed instead.
+ * @param filename The path to the STL mesh.
  * @param mesh The resulting representation with computed per-vertex normals.
- * @return true
+ * @param progress Optional progress report and cancellation of the read.
+ * @return Whether it was able to read the file and was not cancelled.
+ */
+bool ReadFromStl(const std::string &filename, TriangleMesh *mesh,
+                 LoadProgress *progress = nullptr);
+
+class GlbFile;
+
+/**
+ * @brief ReadFromGlb Opens the glTF 2.0 binary file at filename into glb and
+ * stores the triangle primitives of all its meshes in mesh. Attributes that
+ * glb->ZeroCopy provides are left out of mesh, so they can be uploaded
+ * straight from the mapped file; missing normals and texture coordinates
+ * are computed.
+ * @param filename The path to the GLB model.
+ * @param glb The opened file, which has to outlive any use of its accessors.
+ * @param mesh The resulting representation.
+ * @param progress Optional progress report and cancellation of the read.
+ * @return Whether it was able to read the file and was not cancelled.
  */
-bool CreateSphere(TriangleMesh *mesh);
+bool ReadFromGlb(const std::string &filename, GlbFile *glb, TriangleMesh *mesh,
+                 LoadProgress *progress = nullptr);
 
 }  // namespace data_representation
 
@@ -0,0 +1,213 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_normals.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Faces whose weights are computed together. Their corners are gathered into
+// small arrays the kernel can process with full SIMD vectors.
+const size_t kBlock = 64;
+
+// Below this many faces or vertices per thread a pass is not worth a thread.
+const size_t kMinItems = 1 << 15;
+
+// Faces with a smaller cross product get a zero normal.
+const float kMinCross = 0.00001f;
+
+const float kPi = 3.14159265358979f;
+
+// Angle between a vector (x, y) with y >= 0 and the x axis, in [0, pi], to
+// within 1e-5. Written without branches so that the kernel vectorizes.
+inline float Atan2(float y, float x) {
+  const float kX = std::fabs(x);
+  const float kMin = std::min(kX, y);
+  const float kMax = std::max(kX, y);
+  const float kT = kMin / std::max(kMax, std::numeric_limits<float>::min());
+  const float kT2 = kT * kT;
+  float angle =
+      kT * (0.99997726f +
+            kT2 * (-0.33262347f +
+                   kT2 * (0.19354346f +
+                          kT2 * (-0.11643287f +
+                                 kT2 * (0.05265332f + kT2 * -0.01172120f)))));
+  angle = y > kX ? kPi / 2.0f - angle : angle;
+  return x < 0.0f ? kPi - angle : angle;
+}
+
+// Unit normals and corner angles of a run of faces, structure of arrays.
+struct FaceWeights {
+  float *normal[3];
+  float *angle[3];
+};
+
+bool IsValid(const int *face, size_t vertices) {
+  return face[0] >= 0 && size_t(face[0]) < vertices && face[1] >= 0 &&
+         size_t(face[1]) < vertices && face[2] >= 0 &&
+         size_t(face[2]) < vertices;
+}
+
+// Computes the weights of the faces [first, last) at faces into weights,
+// which is indexed the same way. Faces with indices out of range get zero
+// weights.
+void ComputeFaceWeights(const std::vector<float> &vertices, const int *faces,
+                        size_t first, size_t last,
+                        const FaceWeights &weights) {
+  const size_t kVertices = vertices.size() / 3;
+  const float kOrigin[3] = {0.0f, 0.0f, 0.0f};
+  alignas(32) float corners[3][3][kBlock];
+  alignas(32) float valid[kBlock];
+  for (size_t block = first; block < last; block += kBlock) {
+    const size_t kCount = std::min(kBlock, last - block);
+    for (size_t i = 0; i < kCount; ++i) {
+      const int *kFace = faces + (block + i) * 3;
+      const bool kValid = IsValid(kFace, kVertices);
+      valid[i] = kValid ? 1.0f : 0.0f;
+      for (int c = 0; c < 3; ++c) {
+        const float *kPosition =
+            kValid ? &vertices[size_t(kFace[c]) * 3] : kOrigin;
+        for (int k = 0; k < 3; ++k) corners[c][k][i] = kPosition[k];
+      }
+    }
+
+    // Written out per axis, since inner loops keep the compiler from
+    // vectorizing this one.
+    float *normal_x = weights.normal[0] + block;
+    float *normal_y = weights.normal[1] + block;
+    float *normal_z = weights.normal[2] + block;
+    float *angle_a = weights.angle[0] + block;
+    float *angle_b = weights.angle[1] + block;
+    float *angle_c = weights.angle[2] + block;
+#pragma omp simd
+    for (size_t i = 0; i < kCount; ++i) {
+      const float kABx = corners[1][0][i] - corners[0][0][i];
+      const float kABy = corners[1][1][i] - corners[0][1][i];
+      const float kABz = corners[1][2][i] - corners[0][2][i];
+      const float kACx = corners[2][0][i] - corners[0][0][i];
+      const float kACy = corners[2][1][i] - corners[0][1][i];
+      const float kACz = corners[2][2][i] - corners[0][2][i];
+      const float kBCx = corners[2][0][i] - corners[1][0][i];
+      const float kBCy = corners[2][1][i] - corners[1][1][i];
+      const float kBCz = corners[2][2][i] - corners[1][2][i];
+      const float kCrossX = kABy * kACz - kABz * kACy;
+      const float kCrossY = kABz * kACx - kABx * kACz;
+      const float kCrossZ = kABx * kACy - kABy * kACx;
+      const float kLength = std::sqrt(kCrossX * kCrossX + kCrossY * kCrossY +
+                                      kCrossZ * kCrossZ);
+      const float kInverse = valid[i] / std::max(kLength, kMinCross);
+      const float kScale = kLength < kMinCross ? 0.0f : kInverse;
+      normal_x[i] = kCrossX * kScale;
+      normal_y[i] = kCrossY * kScale;
+      normal_z[i] = kCrossZ * kScale;
+
+      // The three corners span the same parallelogram, so the sine of every
+      // angle is proportional to kLength and only the cosines differ.
+      angle_a[i] = Atan2(kLength, kABx * kACx + kABy * kACy + kABz * kACz);
+      angle_b[i] = Atan2(kLength, -(kABx * kBCx + kABy * kBCy + kABz * kBCz));
+      angle_c[i] = Atan2(kLength, kACx * kBCx + kACy * kBCy + kACz * kBCz);
+    }
+  }
+}
+
+}  // namespace
+
+void ComputeVertexNormals(const std::vector<float> &vertices,
+                          const std::vector<int> &faces,
+                          std::vector<float> *normals) {
+  VertexAdjacency adjacency;
+  if (!faces.empty())
+    BuildVertexAdjacency(faces, vertices.size() / 3, &adjacency);
+  ComputeVertexNormals(vertices, faces, adjacency, normals);
+}
+
+void ComputeVertexNormals(const std::vector<float> &vertices,
+                          const std::vector<int> &faces,
+                          const VertexAdjacency &adjacency,
+                          std::vector<float> *normals) {
+  // Meshes too large for the adjacency are accumulated serially, as are
+  // meshes without faces, which only get zero normals.
+  if (adjacency.empty()) {
+    normals->assign(vertices.size(), 0);
+    AccumulateVertexNormals(vertices, faces.data(), faces.size(), normals);
+    NormalizeVertexNormals(normals);
+    return;
+  }
+
+  const size_t kVertices = vertices.size() / 3;
+  const size_t kFaces = faces.size() / 3;
+  // Every weight is written by the kernel, so the storage is not initialized.
+  std::unique_ptr<float[]> storage(new float[kFaces * 6]);
+  const FaceWeights kWeights = {
+      {&storage[0], &storage[kFaces], &storage[kFaces * 2]},
+      {&storage[kFaces * 3], &storage[kFaces * 4], &storage[kFaces * 5]}};
+  ParallelFor(kFaces, kMinItems, [&](size_t, size_t first, size_t last) {
+    ComputeFaceWeights(vertices, faces.data(), first, last, kWeights);
+  });
+
+  normals->resize(vertices.size());
+  ParallelFor(kVertices, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      float normal[3] = {0.0f, 0.0f, 0.0f};
+      for (size_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1];
+           ++a) {
+        const size_t kFace = VertexAdjacency::Face(adjacency.corners[a]);
+        const float kAngle = kWeights.angle[adjacency.corners[a] % 3][kFace];
+        for (int k = 0; k < 3; ++k)
+          normal[k] += kWeights.normal[k][kFace] * kAngle;
+      }
+      const float kLength = std::sqrt(normal[0] * normal[0] +
+                                      normal[1] * normal[1] +
+                                      normal[2] * normal[2]);
+      const float kScale = kLength > 0.0f ? 1.0f / kLength : 0.0f;
+      for (int k = 0; k < 3; ++k) (*normals)[v * 3 + k] = normal[k] * kScale;
+    }
+  });
+}
+
+void AccumulateVertexNormals(const std::vector<float> &vertices,
+                             const int *faces, size_t count,
+                             std::vector<float> *normals) {
+  const size_t kVertices = vertices.size() / 3;
+  std::vector<float> storage(kBlock * 6);
+  const FaceWeights kWeights = {
+      {&storage[0], &storage[kBlock], &storage[kBlock * 2]},
+      {&storage[kBlock * 3], &storage[kBlock * 4], &storage[kBlock * 5]}};
+  for (size_t block = 0; block < count / 3; block += kBlock) {
+    const int *kFaces = faces + block * 3;
+    const size_t kCount = std::min(kBlock, count / 3 - block);
+    ComputeFaceWeights(vertices, kFaces, 0, kCount, kWeights);
+    for (size_t f = 0; f < kCount; ++f) {
+      if (!IsValid(&kFaces[f * 3], kVertices)) continue;
+      for (int c = 0; c < 3; ++c) {
+        const float kAngle = kWeights.angle[c][f];
+        float *normal = &(*normals)[size_t(kFaces[f * 3 + c]) * 3];
+        for (int k = 0; k < 3; ++k)
+          normal[k] += kWeights.normal[k][f] * kAngle;
+      }
+    }
+  }
+}
+
+void NormalizeVertexNormals(std::vector<float> *normals) {
+  ParallelFor(normals->size() / 3, kMinItems,
+              [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      float *normal = &(*normals)[v * 3];
+      const float kLength = std::sqrt(normal[0] * normal[0] +
+                                      normal[1] * normal[1] +
+                                      normal[2] * normal[2]);
+      const float kScale = kLength > 0.0f ? 1.0f / kLength : 0.0f;
+      for (int k = 0; k < 3; ++k) normal[k] *= kScale;
+    }
+  });
+}
+
+}  // namespace data_representation
@@ -0,0 +1,64 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_NORMALS_H_
+#define MESH_NORMALS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "./mesh_adjacency.h"
+
+namespace data_representation {
+
+/**
+ * @brief ComputeVertexNormals Smooth per-vertex normals: the angle weighted
+ * average of the normals of the faces around every vertex. The face normals
+ * and corner angles are computed in single precision, a block of faces at a
+ * time, by a vectorized kernel; every vertex then gathers the faces around it
+ * from adjacency, so both steps run on all threads without sharing any
+ * output. The sum over the faces of a vertex always follows the face order,
+ * so the result does not depend on the number of threads.
+ * @param vertices Three coordinates per vertex.
+ * @param faces Three vertex indices per triangle. Faces with indices out of
+ * range are ignored.
+ * @param adjacency The adjacency of faces, or an empty one to accumulate the
+ * normals serially instead.
+ * @param normals Resulting unit normals, three per vertex. Vertices without
+ * faces get a zero normal.
+ */
+void ComputeVertexNormals(const std::vector<float> &vertices,
+                          const std::vector<int> &faces,
+                          const VertexAdjacency &adjacency,
+                          std::vector<float> *normals);
+
+/**
+ * @brief ComputeVertexNormals Same as above with an adjacency built for the
+ * call and released afterwards.
+ */
+void ComputeVertexNormals(const std::vector<float> &vertices,
+                          const std::vector<int> &faces,
+                          std::vector<float> *normals);
+
+/**
+ * @brief AccumulateVertexNormals Adds to normals the angle weighted normals of
+ * the count / 3 triangles at faces, for meshes whose faces arrive in chunks.
+ * The weights are computed by the same kernel as ComputeVertexNormals, but
+ * they are added to the vertices on the calling thread.
+ * @param vertices Three coordinates per vertex.
+ * @param faces The corners of the triangles.
+ * @param count Number of corners at faces.
+ * @param normals One accumulated normal per vertex.
+ */
+void AccumulateVertexNormals(const std::vector<float> &vertices,
+                             const int *faces, size_t count,
+                             std::vector<float> *normals);
+
+/**
+ * @brief NormalizeVertexNormals Scales the accumulated normals to unit
+ * length, leaving zero normals as they are.
+ */
+void NormalizeVertexNormals(std::vector<float> *normals);
+
+}  // namespace data_representation
+
+#endif  // MESH_NORMALS_H_
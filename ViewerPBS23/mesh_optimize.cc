@@ -0,0 +1,518 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_optimize.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+#include "./mesh_weld.h"
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many items per thread a pass is not worth a thread.
+const size_t kMinItems = 1 << 15;
+
+// Clusters of OptimizeOverdraw per thread when computing their sort keys.
+const size_t kMinClusters = 1 << 10;
+
+// Steps per bounding sphere radius the sort keys of OptimizeOverdraw are
+// rounded to. Clusters that differ less keep the order of Tipsify, so convex
+// parts, where every cluster gets about the same key, keep their locality.
+const float kKeySteps = 32.0f;
+
+// Side in pixels of the depth buffers of MeasureOverdraw.
+const int kOverdrawResolution = 256;
+
+// Line size and number of lines of the cache of MeasureVertexFetch, 128 KB.
+const size_t kFetchLine = 64;
+const size_t kFetchCacheLines = 2048;
+
+// Looks up an entry in a FIFO cache of size entries that has had misses
+// misses so far. stamp is the miss that brought the entry in, 0 if none.
+// Returns whether it misses.
+bool MissesFifo(size_t size, uint64_t *stamp, uint64_t *misses) {
+  if (*stamp != 0 && *misses - *stamp < size) return false;
+  *stamp = ++*misses;
+  return true;
+}
+
+bool IsValid(const int *face, size_t vertices) {
+  return face[0] >= 0 && size_t(face[0]) < vertices && face[1] >= 0 &&
+         size_t(face[1]) < vertices && face[2] >= 0 &&
+         size_t(face[2]) < vertices;
+}
+
+// The state of Tipsify over a mesh, kept across its material ranges.
+class Tipsify {
+ public:
+  Tipsify(const std::vector<int> &faces, const VertexAdjacency &adjacency,
+          size_t cache_size)
+      : faces_(faces),
+        adjacency_(adjacency),
+        vertices_(adjacency.offsets.size() - 1),
+        cache_size_(cache_size),
+        live_(vertices_, 0),
+        stamps_(vertices_, 0),
+        emitted_(faces.size() / 3, 0),
+        time_(cache_size + 1) {}
+
+  // Writes the faces [first, last) in cache friendly order at out.
+  void Run(size_t first, size_t last, int *out) {
+    std::vector<size_t> invalid;
+    for (size_t f = first; f < last; ++f) {
+      if (!IsValid(&faces_[f * 3], vertices_)) {
+        invalid.push_back(f);
+        emitted_[f] = 1;
+        continue;
+      }
+      for (int c = 0; c < 3; ++c) ++live_[faces_[f * 3 + c]];
+    }
+
+    dead_ends_.clear();
+    size_t cursor = first * 3;
+    int fan = SkipDeadEnd(last * 3, &cursor);
+    while (fan >= 0) {
+      candidates_.clear();
+      for (uint32_t a = adjacency_.offsets[fan];
+           a < adjacency_.offsets[fan + 1]; ++a) {
+        const size_t kFace = VertexAdjacency::Face(adjacency_.corners[a]);
+        if (kFace < first || kFace >= last || emitted_[kFace]) continue;
+        emitted_[kFace] = 1;
+        for (int c = 0; c < 3; ++c) {
+          const int kVertex = faces_[kFace * 3 + c];
+          *out++ = kVertex;
+          dead_ends_.push_back(kVertex);
+          candidates_.push_back(kVertex);
+          --live_[kVertex];
+          if (time_ - stamps_[kVertex] > cache_size_)
+            stamps_[kVertex] = time_++;
+        }
+      }
+      fan = NextVertex(last * 3, &cursor);
+    }
+
+    for (size_t f : invalid) {
+      for (int c = 0; c < 3; ++c) *out++ = faces_[f * 3 + c];
+    }
+  }
+
+ private:
+  // The candidate that was cached last among those whose live faces would
+  // still find it in the cache once emitted, or a dead end.
+  int NextVertex(size_t end, size_t *cursor) {
+    int next = -1;
+    int64_t best = -1;
+    for (int candidate : candidates_) {
+      if (live_[candidate] == 0) continue;
+      const int64_t kAge = int64_t(time_ - stamps_[candidate]);
+      const int64_t kPriority =
+          kAge + 2 * int64_t(live_[candidate]) <= int64_t(cache_size_) ? kAge
+                                                                      : 0;
+      if (kPriority > best) {
+        best = kPriority;
+        next = candidate;
+      }
+    }
+    return next >= 0 ? next : SkipDeadEnd(end, cursor);
+  }
+
+  // The last emitted vertex that still has live faces or, if none is left,
+  // the next one in input order from cursor. -1 once every face is emitted.
+  int SkipDeadEnd(size_t end, size_t *cursor) {
+    while (!dead_ends_.empty()) {
+      const int kVertex = dead_ends_.back();
+      dead_ends_.pop_back();
+      if (live_[kVertex] > 0) return kVertex;
+    }
+    for (; *cursor < end; ++*cursor) {
+      const int kVertex = faces_[*cursor];
+      if (kVertex >= 0 && size_t(kVertex) < vertices_ && live_[kVertex] > 0)
+        return kVertex;
+    }
+    return -1;
+  }
+
+  const std::vector<int> &faces_;
+  const VertexAdjacency &adjacency_;
+  const size_t vertices_;
+  const size_t cache_size_;
+  // Faces of the current range not yet emitted, per vertex.
+  std::vector<uint32_t> live_;
+  // Value of time_ when every vertex last entered the cache.
+  std::vector<uint64_t> stamps_;
+  std::vector<uint8_t> emitted_;
+  std::vector<int> dead_ends_;
+  std::vector<int> candidates_;
+  uint64_t time_;
+};
+
+// The cache Tipsify orders faces for, to find where its fans break.
+class VertexCache {
+ public:
+  VertexCache(size_t vertices, size_t cache_size)
+      : stamps_(vertices, 0), size_(cache_size), time_(cache_size + 1) {}
+
+  // The corners of face that miss the cache, 0 for faces out of range.
+  int Misses(const int *face) {
+    if (!IsValid(face, stamps_.size())) return 0;
+    int misses = 0;
+    for (int c = 0; c < 3; ++c) {
+      if (time_ - stamps_[face[c]] <= size_) continue;
+      stamps_[face[c]] = time_++;
+      ++misses;
+    }
+    return misses;
+  }
+
+  void Flush() { time_ += size_ + 1; }
+
+ private:
+  std::vector<uint64_t> stamps_;
+  const size_t size_;
+  uint64_t time_;
+};
+
+// Splits the faces [first, last) into the clusters of OptimizeOverdraw.
+// Returns the first face of every cluster.
+std::vector<size_t> FindClusters(const std::vector<int> &faces, size_t first,
+                                 size_t last, float threshold,
+                                 VertexCache *cache) {
+  // Tipsify only misses with every corner when it jumps to a new patch.
+  std::vector<size_t> patches;
+  cache->Flush();
+  for (size_t f = first; f < last; ++f) {
+    if (cache->Misses(&faces[f * 3]) == 3 || f == first) patches.push_back(f);
+  }
+
+  std::vector<size_t> clusters;
+  for (size_t p = 0; p < patches.size(); ++p) {
+    const size_t kStart = patches[p];
+    const size_t kEnd = p + 1 < patches.size() ? patches[p + 1] : last;
+    cache->Flush();
+    size_t misses = 0;
+    for (size_t f = kStart; f < kEnd; ++f)
+      misses += cache->Misses(&faces[f * 3]);
+    const float kLimit = threshold * float(misses) / float(kEnd - kStart);
+
+    // A cluster ends as soon as its ACMR reaches the limit. The tail after
+    // the last one rarely does, and is merged into it.
+    clusters.push_back(kStart);
+    cache->Flush();
+    misses = 0;
+    size_t count = 0;
+    for (size_t f = kStart; f < kEnd; ++f) {
+      misses += cache->Misses(&faces[f * 3]);
+      if (float(misses) > kLimit * float(++count)) continue;
+      clusters.push_back(f + 1);
+      cache->Flush();
+      misses = 0;
+      count = 0;
+    }
+    if (clusters.back() != kStart) clusters.pop_back();
+  }
+  return clusters;
+}
+
+// Twice the signed area of the triangle (a, b, p), positive when p is to the
+// left of the edge from a to b.
+float Edge(float ax, float ay, float bx, float by, float px, float py) {
+  return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Rasterizes faces as seen from one of the six axis directions into a
+// kOverdrawResolution^2 depth buffer. Adds the fragments that pass the depth
+// test to shaded and the pixels covered to covered.
+void RasterizeView(const std::vector<float> &vertices,
+                   const std::vector<int> &faces, const float *minimum,
+                   float scale, int view, uint64_t *shaded,
+                   uint64_t *covered) {
+  // Seen from the positive side of the axis, (u, v, axis) is right handed;
+  // swapping u and v mirrors it for the negative side.
+  const int kAxis = view / 2;
+  const bool kNegative = view % 2 == 1;
+  const int kU = (kAxis + (kNegative ? 2 : 1)) % 3;
+  const int kV = (kAxis + (kNegative ? 1 : 2)) % 3;
+  const float kDepthSign = kNegative ? 1.0f : -1.0f;
+  const int kSize = kOverdrawResolution;
+  std::vector<float> depth(size_t(kSize) * kSize,
+                           std::numeric_limits<float>::infinity());
+
+  const size_t kVertices = vertices.size() / 3;
+  for (size_t f = 0; f < faces.size() / 3; ++f) {
+    if (!IsValid(&faces[f * 3], kVertices)) continue;
+    float x[3], y[3], z[3];
+    for (int c = 0; c < 3; ++c) {
+      const float *kPosition = &vertices[size_t(faces[f * 3 + c]) * 3];
+      x[c] = (kPosition[kU] - minimum[kU]) * scale;
+      y[c] = (kPosition[kV] - minimum[kV]) * scale;
+      z[c] = kDepthSign * kPosition[kAxis];
+    }
+    // Faces facing away, or edge on, are culled.
+    const float kArea = Edge(x[0], y[0], x[1], y[1], x[2], y[2]);
+    if (!(kArea > 0.0f)) continue;
+
+    const int kMinX = std::max(0, int(std::min({x[0], x[1], x[2]})));
+    const int kMaxX = std::min(kSize - 1, int(std::max({x[0], x[1], x[2]})));
+    const int kMinY = std::max(0, int(std::min({y[0], y[1], y[2]})));
+    const int kMaxY = std::min(kSize - 1, int(std::max({y[0], y[1], y[2]})));
+    for (int py = kMinY; py <= kMaxY; ++py) {
+      const float kY = py + 0.5f;
+      for (int px = kMinX; px <= kMaxX; ++px) {
+        const float kX = px + 0.5f;
+        const float kW0 = Edge(x[1], y[1], x[2], y[2], kX, kY);
+        const float kW1 = Edge(x[2], y[2], x[0], y[0], kX, kY);
+        const float kW2 = Edge(x[0], y[0], x[1], y[1], kX, kY);
+        if (kW0 < 0.0f || kW1 < 0.0f || kW2 < 0.0f) continue;
+        const float kDepth = (kW0 * z[0] + kW1 * z[1] + kW2 * z[2]) / kArea;
+        float &pixel = depth[size_t(py) * kSize + px];
+        if (kDepth >= pixel) continue;
+        pixel = kDepth;
+        ++*shaded;
+      }
+    }
+  }
+  for (float pixel : depth) {
+    if (pixel < std::numeric_limits<float>::infinity()) ++*covered;
+  }
+}
+
+}  // namespace
+
+VertexCacheStats MeasureVertexCache(const std::vector<int> &faces,
+                                    size_t vertices, size_t cache_size) {
+  // The vertex entered the cache with miss number stamps[v], 0 if never:
+  // it is still cached while fewer than cache_size misses followed it.
+  std::vector<uint64_t> stamps(vertices, 0);
+  uint64_t misses = 0;
+  size_t referenced = 0;
+  for (size_t c = 0; c < faces.size() / 3 * 3; ++c) {
+    if (faces[c] < 0 || size_t(faces[c]) >= vertices) continue;
+    if (stamps[faces[c]] == 0) ++referenced;
+    MissesFifo(cache_size, &stamps[faces[c]], &misses);
+  }
+
+  VertexCacheStats stats = {0.0, 0.0};
+  if (faces.size() >= 3) stats.acmr = double(misses) / (faces.size() / 3);
+  if (referenced > 0) stats.atvr = double(misses) / referenced;
+  return stats;
+}
+
+double MeasureOverdraw(const std::vector<float> &vertices,
+                       const std::vector<int> &faces) {
+  float minimum[3], maximum[3];
+  for (int k = 0; k < 3; ++k) {
+    minimum[k] = std::numeric_limits<float>::max();
+    maximum[k] = std::numeric_limits<float>::lowest();
+  }
+  for (size_t i = 0; i < vertices.size() / 3 * 3; ++i) {
+    minimum[i % 3] = std::min(minimum[i % 3], vertices[i]);
+    maximum[i % 3] = std::max(maximum[i % 3], vertices[i]);
+  }
+  float extent = 0.0f;
+  for (int k = 0; k < 3; ++k)
+    extent = std::max(extent, maximum[k] - minimum[k]);
+  if (!(extent > 0.0f)) return 0.0;
+  const float kScale = kOverdrawResolution / extent;
+
+  const int kViews = 6;
+  uint64_t shaded[kViews] = {}, covered[kViews] = {};
+  ParallelFor(kViews, 1, [&](size_t, size_t first, size_t last) {
+    for (size_t view = first; view < last; ++view) {
+      RasterizeView(vertices, faces, minimum, kScale, int(view),
+                    &shaded[view], &covered[view]);
+    }
+  });
+  uint64_t total_shaded = 0, total_covered = 0;
+  for (int view = 0; view < kViews; ++view) {
+    total_shaded += shaded[view];
+    total_covered += covered[view];
+  }
+  return total_covered > 0 ? double(total_shaded) / total_covered : 0.0;
+}
+
+double MeasureVertexFetch(const std::vector<int> &faces, size_t vertices,
+                          size_t stride) {
+  std::vector<uint64_t> stamps(vertices, 0);
+  std::vector<uint64_t> lines((vertices * stride + kFetchLine - 1) /
+                              kFetchLine, 0);
+  uint64_t misses = 0, fetched = 0;
+  size_t referenced = 0;
+  for (size_t c = 0; c < faces.size() / 3 * 3; ++c) {
+    if (faces[c] < 0 || size_t(faces[c]) >= vertices) continue;
+    if (stamps[faces[c]] == 0) ++referenced;
+    if (!MissesFifo(kVertexCacheSize, &stamps[faces[c]], &misses)) continue;
+    const size_t kFirst = size_t(faces[c]) * stride;
+    for (size_t line = kFirst / kFetchLine;
+         line <= (kFirst + stride - 1) / kFetchLine; ++line)
+      MissesFifo(kFetchCacheLines, &lines[line], &fetched);
+  }
+  return referenced > 0 ? double(fetched * kFetchLine) / (referenced * stride)
+                        : 0.0;
+}
+
+bool OptimizeVertexCache(TriangleMesh *mesh, size_t cache_size) {
+  const VertexAdjacency &kAdjacency = mesh->Adjacency();
+  if (kAdjacency.empty()) return false;
+
+  std::vector<int> faces(mesh->faces_);
+  Tipsify tipsify(mesh->faces_, kAdjacency, cache_size);
+  if (mesh->materialRanges_.empty()) {
+    tipsify.Run(0, faces.size() / 3, faces.data());
+  } else {
+    for (const TriangleMesh::MaterialRange &range : mesh->materialRanges_) {
+      tipsify.Run(range.first / 3, (range.first + range.count) / 3,
+                  &faces[range.first]);
+    }
+  }
+  mesh->faces_.swap(faces);
+  mesh->ResetAdjacency();
+  return true;
+}
+
+bool OptimizeOverdraw(TriangleMesh *mesh, float threshold,
+                      size_t cache_size) {
+  const size_t kVertices = mesh->vertices_.size() / 3;
+  if (kVertices == 0) return false;
+  const std::vector<int> &kFaces = mesh->faces_;
+  const std::vector<float> &kPositions = mesh->vertices_;
+  const Eigen::Vector3f kCenter = mesh->center_;
+  const float kStep = mesh->radius_ > 0.0f ? mesh->radius_ / kKeySteps : 1.0f;
+
+  std::vector<int> faces(kFaces);
+  VertexCache cache(kVertices, cache_size);
+  auto reorder = [&](size_t first, size_t last) {
+    const std::vector<size_t> kClusters =
+        FindClusters(kFaces, first, last, threshold, &cache);
+    auto end = [&](size_t i) {
+      return i + 1 < kClusters.size() ? kClusters[i + 1] : last;
+    };
+
+    // How much the area weighted mean normal of every cluster points away
+    // from the center, from its area weighted centroid, in steps.
+    std::vector<float> keys(kClusters.size());
+    ParallelFor(kClusters.size(), kMinClusters, [&](size_t, size_t begin,
+                                                    size_t finish) {
+      for (size_t i = begin; i < finish; ++i) {
+        Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+        Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+        float area = 0.0f;
+        for (size_t f = kClusters[i]; f < end(i); ++f) {
+          if (!IsValid(&kFaces[f * 3], kVertices)) continue;
+          const Eigen::Vector3f kA(&kPositions[size_t(kFaces[f * 3]) * 3]);
+          const Eigen::Vector3f kB(&kPositions[size_t(kFaces[f * 3 + 1]) * 3]);
+          const Eigen::Vector3f kC(&kPositions[size_t(kFaces[f * 3 + 2]) * 3]);
+          const Eigen::Vector3f kCross = (kB - kA).cross(kC - kA);
+          const float kArea = kCross.norm();
+          centroid += kArea / 3.0f * (kA + kB + kC);
+          normal += kCross;
+          area += kArea;
+        }
+        if (area > 0.0f) centroid /= area;
+        const float kLength = normal.norm();
+        if (kLength > 0.0f) normal /= kLength;
+        keys[i] = std::floor((centroid - kCenter).dot(normal) / kStep);
+      }
+    });
+
+    std::vector<size_t> order(kClusters.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+    int *out = &faces[first * 3];
+    for (size_t i : order) {
+      out = std::copy(kFaces.begin() + kClusters[i] * 3,
+                      kFaces.begin() + end(i) * 3, out);
+    }
+  };
+  if (mesh->materialRanges_.empty()) {
+    if (kFaces.size() >= 3) reorder(0, kFaces.size() / 3);
+  } else {
+    for (const TriangleMesh::MaterialRange &range : mesh->materialRanges_) {
+      if (range.count >= 3)
+        reorder(range.first / 3, (range.first + range.count) / 3);
+    }
+  }
+  mesh->faces_.swap(faces);
+  mesh->ResetAdjacency();
+  return true;
+}
+
+bool OptimizeVertexFetch(TriangleMesh *mesh) {
+  const size_t kVertices = mesh->vertices_.size() / 3;
+  if (kVertices == 0 || mesh->normals_.size() != kVertices * 3 ||
+      mesh->texCoords_.size() != kVertices * 2 ||
+      (!mesh->colors_.empty() && mesh->colors_.size() != kVertices * 4) ||
+      (!mesh->quality_.empty() && mesh->quality_.size() != kVertices))
+    return false;
+
+  std::vector<int> remap(kVertices, -1);
+  std::vector<int> firsts;
+  firsts.reserve(kVertices);
+  for (int v : mesh->faces_) {
+    if (v < 0 || size_t(v) >= kVertices || remap[v] >= 0) continue;
+    remap[v] = static_cast<int>(firsts.size());
+    firsts.push_back(v);
+  }
+  for (size_t v = 0; v < kVertices; ++v) {
+    if (remap[v] >= 0) continue;
+    remap[v] = static_cast<int>(firsts.size());
+    firsts.push_back(static_cast<int>(v));
+  }
+
+  GatherVertices(firsts, mesh);
+  std::vector<int> &faces = mesh->faces_;
+  ParallelFor(faces.size(), kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      if (faces[i] >= 0 && size_t(faces[i]) < kVertices)
+        faces[i] = remap[faces[i]];
+    }
+  });
+  mesh->ResetAdjacency();
+  return true;
+}
+
+void OptimizeMesh(TriangleMesh *mesh) {
+  if (mesh->faces_.empty() || mesh->vertices_.empty()) return;
+  const size_t kVertices = mesh->vertices_.size() / 3;
+  const size_t kStride = 3 * sizeof(float);
+  const VertexCacheStats kCacheBefore =
+      MeasureVertexCache(mesh->faces_, kVertices);
+  const double kOverdrawBefore =
+      MeasureOverdraw(mesh->vertices_, mesh->faces_);
+  const double kFetchBefore =
+      MeasureVertexFetch(mesh->faces_, kVertices, kStride);
+
+  const auto kStart = std::chrono::steady_clock::now();
+  if (!OptimizeVertexCache(mesh)) {
+    std::cerr << "The mesh is too large to optimize" << std::endl;
+    return;
+  }
+  OptimizeOverdraw(mesh);
+  const bool kRenumbered = OptimizeVertexFetch(mesh);
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+
+  const VertexCacheStats kCacheAfter =
+      MeasureVertexCache(mesh->faces_, kVertices);
+  std::cout << "Optimized triangle mesh" << std::endl;
+  std::cout << "\tACMR = " << kCacheBefore.acmr << " -> " << kCacheAfter.acmr
+            << std::endl;
+  std::cout << "\tATVR = " << kCacheBefore.atvr << " -> " << kCacheAfter.atvr
+            << std::endl;
+  std::cout << "\tOverdraw = " << kOverdrawBefore << " -> "
+            << MeasureOverdraw(mesh->vertices_, mesh->faces_) << std::endl;
+  std::cout << "\tPosition overfetch = " << kFetchBefore << " -> "
+            << MeasureVertexFetch(mesh->faces_, kVertices, kStride)
+            << (kRenumbered ? "" : " (vertices not renumbered)") << std::endl;
+  std::cout << "\tOptimization time = " << kElapsed.count() << " ms"
+            << std::endl;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,139 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_OPTIMIZE_H_
+#define MESH_OPTIMIZE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief kVertexCacheSize Entries of the post-transform vertex cache the
+ * faces are ordered for and measured with.
+ */
+const size_t kVertexCacheSize = 16;
+
+/**
+ * @brief kOverdrawThreshold How much higher than the ACMR of the input the
+ * ACMR of every cluster of OptimizeOverdraw may get.
+ */
+const float kOverdrawThreshold = 1.05f;
+
+/**
+ * @brief The VertexCacheStats struct How well an index buffer reuses the
+ * post-transform vertex cache.
+ */
+struct VertexCacheStats {
+  /**
+   * @brief acmr Average cache miss ratio: vertex shader invocations per
+   * triangle, 3 at worst and about 0.5 at best for a regular mesh.
+   */
+  double acmr;
+
+  /**
+   * @brief atvr Average transformed vertex ratio: vertex shader invocations
+   * per referenced vertex, 1 at best.
+   */
+  double atvr;
+};
+
+/**
+ * @brief MeasureVertexCache Simulates drawing faces through a FIFO
+ * post-transform cache. Corners with indices out of range are not counted.
+ * @param faces Three vertex indices per triangle.
+ * @param vertices Number of vertices.
+ * @param cache_size Entries of the simulated cache.
+ */
+VertexCacheStats MeasureVertexCache(const std::vector<int> &faces,
+                                    size_t vertices,
+                                    size_t cache_size = kVertexCacheSize);
+
+/**
+ * @brief MeasureOverdraw Rasterizes faces without the faces facing away, as
+ * the viewer draws them, into small depth buffers from the six axis
+ * directions and counts the fragments that pass the depth test.
+ * @param vertices Three coordinates per vertex.
+ * @param faces Three vertex indices per triangle, counterclockwise seen from
+ * the front. Faces with indices out of range are not drawn.
+ * @return Shaded fragments per covered pixel, 1 at best; 0 if nothing is
+ * covered.
+ */
+double MeasureOverdraw(const std::vector<float> &vertices,
+                       const std::vector<int> &faces);
+
+/**
+ * @brief MeasureVertexFetch Simulates the vertex shader invocations of faces
+ * (see MeasureVertexCache) reading a vertex buffer of stride bytes per vertex
+ * through a small cache of 64 byte lines.
+ * @param faces Three vertex indices per triangle.
+ * @param vertices Number of vertices.
+ * @param stride Bytes per vertex of the buffer.
+ * @return Bytes read per byte of referenced vertices, 1 at best; 0 if no
+ * vertex is referenced.
+ */
+double MeasureVertexFetch(const std::vector<int> &faces, size_t vertices,
+                          size_t stride);
+
+/**
+ * @brief OptimizeVertexCache Reorders the faces of mesh for the
+ * post-transform vertex cache with Tipsify (Sander et al. 2007): faces are
+ * emitted in fans around a vertex, and the next vertex is the most recently
+ * cached one whose remaining faces still fit in the cache, or a dead end
+ * from the stack of emitted vertices. Runs in time linear in the faces, over
+ * mesh->Adjacency(). Every material range is reordered on its own, so the
+ * ranges stay valid; faces with indices out of range are moved to the end of
+ * their range.
+ * @param mesh The mesh to reorder. Only faces_ changes.
+ * @param cache_size Entries of the cache to order the faces for.
+ * @return Whether the faces were reordered, false if the mesh has no
+ * adjacency.
+ */
+bool OptimizeVertexCache(TriangleMesh *mesh,
+                         size_t cache_size = kVertexCacheSize);
+
+/**
+ * @brief OptimizeOverdraw Reorders the clusters of faces left by
+ * OptimizeVertexCache to reduce overdraw (Sander et al. 2007). Clusters start
+ * wherever a face misses the cache with all its corners, and are split
+ * further wherever their ACMR so far is within threshold of the ACMR of the
+ * whole cluster. Clusters are then drawn from the one that faces the most
+ * away from the mesh center to the one that faces the most towards it, so
+ * the outer surfaces, which occlude the rest from most directions, are drawn
+ * first. Every material range is reordered on its own.
+ * @param mesh The mesh to reorder, whose center_ is known. Only faces_
+ * changes.
+ * @param threshold How much the ACMR of a cluster may exceed the one of the
+ * input, at least 1. Higher values make smaller clusters.
+ * @param cache_size Entries of the cache the faces were ordered for.
+ * @return Whether the faces were reordered, false if the positions of mesh
+ * are not in vertices_.
+ */
+bool OptimizeOverdraw(TriangleMesh *mesh,
+                      float threshold = kOverdrawThreshold,
+                      size_t cache_size = kVertexCacheSize);
+
+/**
+ * @brief OptimizeVertexFetch Renumbers the vertices of mesh in the order the
+ * faces first use them, so that the vertex shader reads the vertex buffers
+ * almost sequentially. Vertices that no face uses go last, in their order.
+ * Every per-vertex array is permuted along (see GatherVertices).
+ * @param mesh The mesh to renumber.
+ * @return Whether the vertices were renumbered, false if some per-vertex
+ * array is not held by mesh, as happens with GLB models.
+ */
+bool OptimizeVertexFetch(TriangleMesh *mesh);
+
+/**
+ * @brief OptimizeMesh Runs OptimizeVertexCache, OptimizeOverdraw and
+ * OptimizeVertexFetch on mesh and reports what they achieved. Point clouds,
+ * and meshes whose positions are not in vertices_, are left as they are.
+ * @param mesh The mesh to optimize.
+ */
+void OptimizeMesh(TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_OPTIMIZE_H_
@@ -0,0 +1,440 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_simplify.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many vertices or corners per thread a pass is not worth a thread.
+const size_t kMinItems = 1 << 13;
+
+// Collapses may turn the normal of a face by up to about 75 degrees.
+const float kMinFaceCosine = 0.25f;
+
+// Collapses may leave a vertex with up to this many faces. Fans of long thin
+// faces are poor approximations, and slow down every later pass.
+const uint32_t kMaxValence = 24;
+
+// Weight of the squared length of an edge in the cost of its collapse, so
+// that flat regions, where every collapse is free, collapse their shortest
+// edges first. Too small to reorder collapses with any actual error.
+const float kLengthWeight = 1e-6f;
+
+// Collapses a pass applies may cost this much more than the last of the ones
+// it needs.
+const float kPassCostSlack = 1.5f;
+
+// A level that keeps more of the faces of the previous one than this is
+// dropped, and ends the chain.
+const float kMaxLevelFraction = 0.8f;
+
+// The sum of the squared distances to a set of planes, each one weighted by
+// the area of the face it comes from. Kept in double precision, since the
+// errors of flat regions are tiny differences of large terms.
+struct Quadric {
+  double xx, xy, xz, yy, yz, zz;
+  double x, y, z;
+  double c;
+  double weight;
+};
+
+void AddQuadric(const Quadric &q, Quadric *sum) {
+  sum->xx += q.xx;
+  sum->xy += q.xy;
+  sum->xz += q.xz;
+  sum->yy += q.yy;
+  sum->yz += q.yz;
+  sum->zz += q.zz;
+  sum->x += q.x;
+  sum->y += q.y;
+  sum->z += q.z;
+  sum->c += q.c;
+  sum->weight += q.weight;
+}
+
+// The quadric of the plane of the triangle a, b, c. Degenerate triangles give
+// an empty one.
+Quadric FaceQuadric(const float *a, const float *b, const float *c) {
+  const double kAB[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const double kAC[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  double normal[3] = {kAB[1] * kAC[2] - kAB[2] * kAC[1],
+                      kAB[2] * kAC[0] - kAB[0] * kAC[2],
+                      kAB[0] * kAC[1] - kAB[1] * kAC[0]};
+  const double kLength = std::sqrt(normal[0] * normal[0] +
+                                   normal[1] * normal[1] +
+                                   normal[2] * normal[2]);
+  Quadric q = {};
+  if (!(kLength > 0.0)) return q;
+  for (int k = 0; k < 3; ++k) normal[k] /= kLength;
+  const double kD = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+  const double kArea = kLength / 2.0;
+  q.xx = kArea * normal[0] * normal[0];
+  q.xy = kArea * normal[0] * normal[1];
+  q.xz = kArea * normal[0] * normal[2];
+  q.yy = kArea * normal[1] * normal[1];
+  q.yz = kArea * normal[1] * normal[2];
+  q.zz = kArea * normal[2] * normal[2];
+  q.x = kArea * normal[0] * kD;
+  q.y = kArea * normal[1] * kD;
+  q.z = kArea * normal[2] * kD;
+  q.c = kArea * kD * kD;
+  q.weight = kArea;
+  return q;
+}
+
+// Mean squared distance from p to the planes of a and b together.
+float MeanError(const Quadric &a, const Quadric &b, const float *p) {
+  Quadric q = a;
+  AddQuadric(b, &q);
+  if (!(q.weight > 0.0)) return 0.0f;
+  const double kX = q.xx * p[0] + q.xy * p[1] + q.xz * p[2];
+  const double kY = q.xy * p[0] + q.yy * p[1] + q.yz * p[2];
+  const double kZ = q.xz * p[0] + q.yz * p[1] + q.zz * p[2];
+  const double kError = kX * p[0] + kY * p[1] + kZ * p[2] +
+                        2.0 * (q.x * p[0] + q.y * p[1] + q.z * p[2]) + q.c;
+  return static_cast<float>(std::max(kError, 0.0) / q.weight);
+}
+
+// Cross product of b - a and c - a.
+void Cross(const float *a, const float *b, const float *c, float *cross) {
+  const float kAB[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  const float kAC[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  cross[0] = kAB[1] * kAC[2] - kAB[2] * kAC[1];
+  cross[1] = kAB[2] * kAC[0] - kAB[0] * kAC[2];
+  cross[2] = kAB[0] * kAC[1] - kAB[1] * kAC[0];
+}
+
+bool IsValidFace(const int *face, size_t vertices) {
+  return face[0] >= 0 && size_t(face[0]) < vertices && face[1] >= 0 &&
+         size_t(face[1]) < vertices && face[2] >= 0 &&
+         size_t(face[2]) < vertices && face[0] != face[1] &&
+         face[1] != face[2] && face[2] != face[0];
+}
+
+// Simplifies the faces of a mesh level after level. The quadrics of the
+// vertices left carry the planes of the vertices collapsed onto them over to
+// the next levels.
+class Simplifier {
+ public:
+  // Starts from the valid faces of mesh, whose adjacency is adjacency.
+  Simplifier(const TriangleMesh &mesh, const VertexAdjacency &adjacency);
+
+  // Collapses edges until at most target faces are left, or until no edge
+  // can be collapsed.
+  void Simplify(size_t target);
+
+  const std::vector<int> &faces() const { return faces_; }
+
+  // Largest error of a collapse so far, relative to the radius of the mesh.
+  float error() const { return std::sqrt(max_error_); }
+
+ private:
+  // Applies the cheapest collapses that do not overlap. Returns whether it
+  // applied any.
+  bool RunPass(size_t target);
+
+  // Finds the cheapest valid collapse of v into targets_, costs_ and
+  // errors_.
+  void FindCollapse(uint32_t v);
+
+  // Whether no face around v that stays turns too much when v moves to u.
+  bool KeepsFaces(uint32_t v, uint32_t u) const;
+
+  // Whether v and u share only the two vertices opposite to their edge, so
+  // that collapsing it leaves a manifold (the link condition).
+  bool KeepsLink(uint32_t v, uint32_t u) const;
+
+  // Whether some vertex of the faces around v has been stamped in this pass.
+  bool IsTouched(uint32_t v) const;
+
+  // The vertex at corner + offset of the face of corner.
+  int Corner(uint32_t corner, uint32_t offset) const {
+    return faces_[corner - corner % 3 + (corner + offset) % 3];
+  }
+
+  // Positions relative to the bounding sphere, so that errors are relative to
+  // its radius.
+  std::vector<float> positions_;
+  std::vector<Quadric> quadrics_;
+  std::vector<uint8_t> locked_;
+  std::vector<int> faces_;
+  VertexAdjacency adjacency_;
+  std::vector<int> targets_;
+  std::vector<float> costs_;
+  std::vector<float> errors_;
+  std::vector<int> remap_;
+  std::vector<uint32_t> stamps_;
+  uint32_t pass_;
+  float max_error_;
+};
+
+Simplifier::Simplifier(const TriangleMesh &mesh,
+                       const VertexAdjacency &adjacency)
+    : positions_(mesh.vertices_.size()),
+      quadrics_(mesh.vertices_.size() / 3),
+      locked_(mesh.vertices_.size() / 3, 0),
+      targets_(mesh.vertices_.size() / 3, -1),
+      costs_(mesh.vertices_.size() / 3, 0.0f),
+      errors_(mesh.vertices_.size() / 3, 0.0f),
+      remap_(mesh.vertices_.size() / 3),
+      stamps_(mesh.vertices_.size() / 3, 0),
+      pass_(0),
+      max_error_(0.0f) {
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  const std::vector<int> &kFaces = mesh.faces_;
+  const float kScale = mesh.radius_ > 0.0f ? 1.0f / mesh.radius_ : 1.0f;
+  ParallelFor(kVertices, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      remap_[v] = int(v);
+      for (int k = 0; k < 3; ++k) {
+        positions_[v * 3 + k] =
+            (mesh.vertices_[v * 3 + k] - mesh.center_[k]) * kScale;
+      }
+    }
+  });
+
+  // Every vertex gathers the planes of its faces, and checks that every edge
+  // it has is shared by exactly one other face, in the opposite direction.
+  ParallelFor(kVertices, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      const uint32_t kBegin = adjacency.offsets[v];
+      const uint32_t kEnd = adjacency.offsets[v + 1];
+      for (uint32_t a = kBegin; a < kEnd; ++a) {
+        const uint32_t kCorner = adjacency.corners[a];
+        const int *kFace = &kFaces[kCorner - kCorner % 3];
+        if (!IsValidFace(kFace, kVertices)) continue;
+        AddQuadric(FaceQuadric(&positions_[size_t(kFace[0]) * 3],
+                               &positions_[size_t(kFace[1]) * 3],
+                               &positions_[size_t(kFace[2]) * 3]),
+                   &quadrics_[v]);
+
+        const int kNext = kFace[(kCorner + 1) % 3];
+        int forward = 0;
+        int backward = 0;
+        for (uint32_t b = kBegin; b < kEnd; ++b) {
+          const uint32_t kOther = adjacency.corners[b];
+          const int *kOtherFace = &kFaces[kOther - kOther % 3];
+          if (!IsValidFace(kOtherFace, kVertices)) continue;
+          forward += kOtherFace[(kOther + 1) % 3] == kNext;
+          backward += kOtherFace[(kOther + 2) % 3] == kNext;
+        }
+        if (forward != 1 || backward != 1) locked_[v] = 1;
+      }
+    }
+  });
+
+  faces_.reserve(kFaces.size() / 3 * 3);
+  for (size_t f = 0; f < kFaces.size() / 3; ++f) {
+    if (IsValidFace(&kFaces[f * 3], kVertices))
+      faces_.insert(faces_.end(), &kFaces[f * 3], &kFaces[f * 3] + 3);
+  }
+}
+
+void Simplifier::Simplify(size_t target) {
+  while (faces_.size() / 3 > target && RunPass(target)) {
+  }
+}
+
+bool Simplifier::RunPass(size_t target) {
+  const size_t kVertices = positions_.size() / 3;
+  if (!BuildVertexAdjacency(faces_, kVertices, &adjacency_)) return false;
+  ParallelFor(kVertices, kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) FindCollapse(uint32_t(v));
+  });
+
+  // Each collapse removes the two faces of its edge. The collapses needed
+  // overlap, so the pass goes on with the ones up to a bit more expensive
+  // than the last of them; the ones left out by the overlaps are weighed
+  // again against the rest in the next pass.
+  std::vector<std::pair<float, uint32_t>> order;
+  for (size_t v = 0; v < kVertices; ++v) {
+    if (targets_[v] >= 0) order.emplace_back(costs_[v], uint32_t(v));
+  }
+  if (order.empty()) return false;
+  std::sort(order.begin(), order.end());
+  const size_t kNeeded = faces_.size() / 3 - target;
+  const float kMaxCost =
+      order[std::min(order.size(), (kNeeded + 1) / 2) - 1].first *
+      kPassCostSlack;
+
+  ++pass_;
+  size_t collapses = 0;
+  for (size_t i = 0; i < order.size() && collapses * 2 < kNeeded; ++i) {
+    if (order[i].first > kMaxCost) break;
+    const uint32_t kVertex = order[i].second;
+    const int kTarget = targets_[kVertex];
+    if (IsTouched(kVertex)) continue;
+    for (uint32_t a = adjacency_.offsets[kVertex];
+         a < adjacency_.offsets[kVertex + 1]; ++a) {
+      for (uint32_t k = 0; k < 3; ++k)
+        stamps_[Corner(adjacency_.corners[a], k)] = pass_;
+    }
+    remap_[kVertex] = kTarget;
+    AddQuadric(quadrics_[kVertex], &quadrics_[kTarget]);
+    max_error_ = std::max(max_error_, errors_[kVertex]);
+    ++collapses;
+  }
+  if (collapses == 0) return false;
+
+  ParallelFor(faces_.size(), kMinItems, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) faces_[c] = remap_[faces_[c]];
+  });
+  size_t kept = 0;
+  for (size_t f = 0; f < faces_.size() / 3; ++f) {
+    const int *kFace = &faces_[f * 3];
+    if (kFace[0] == kFace[1] || kFace[1] == kFace[2] || kFace[2] == kFace[0])
+      continue;
+    std::copy(kFace, kFace + 3, &faces_[kept * 3]);
+    ++kept;
+  }
+  faces_.resize(kept * 3);
+  return true;
+}
+
+void Simplifier::FindCollapse(uint32_t v) {
+  targets_[v] = -1;
+  if (locked_[v]) return;
+  const float *kFrom = &positions_[size_t(v) * 3];
+  float best = std::numeric_limits<float>::max();
+  for (uint32_t a = adjacency_.offsets[v]; a < adjacency_.offsets[v + 1];
+       ++a) {
+    for (uint32_t k = 1; k < 3; ++k) {
+      const uint32_t kTarget = uint32_t(Corner(adjacency_.corners[a], k));
+      if (adjacency_.Degree(v) + adjacency_.Degree(kTarget) >
+          kMaxValence + 4)
+        continue;
+      const float *kTo = &positions_[size_t(kTarget) * 3];
+      const float kError = MeanError(quadrics_[v], quadrics_[kTarget], kTo);
+      const float kLength = (kTo[0] - kFrom[0]) * (kTo[0] - kFrom[0]) +
+                            (kTo[1] - kFrom[1]) * (kTo[1] - kFrom[1]) +
+                            (kTo[2] - kFrom[2]) * (kTo[2] - kFrom[2]);
+      const float kCost = kError + kLengthWeight * kLength;
+      if (!(kCost < best) || !KeepsFaces(v, kTarget) ||
+          !KeepsLink(v, kTarget))
+        continue;
+      best = kCost;
+      errors_[v] = kError;
+      targets_[v] = int(kTarget);
+    }
+  }
+  costs_[v] = best;
+}
+
+bool Simplifier::KeepsFaces(uint32_t v, uint32_t u) const {
+  const float *kFrom = &positions_[size_t(v) * 3];
+  const float *kTo = &positions_[size_t(u) * 3];
+  for (uint32_t a = adjacency_.offsets[v]; a < adjacency_.offsets[v + 1];
+       ++a) {
+    const uint32_t kCorner = adjacency_.corners[a];
+    const int kB = Corner(kCorner, 1);
+    const int kC = Corner(kCorner, 2);
+    // The faces of the edge itself are removed by the collapse.
+    if (uint32_t(kB) == u || uint32_t(kC) == u) continue;
+    float before[3];
+    float after[3];
+    Cross(kFrom, &positions_[size_t(kB) * 3], &positions_[size_t(kC) * 3],
+          before);
+    Cross(kTo, &positions_[size_t(kB) * 3], &positions_[size_t(kC) * 3],
+          after);
+    const float kBefore = std::sqrt(before[0] * before[0] +
+                                    before[1] * before[1] +
+                                    before[2] * before[2]);
+    if (!(kBefore > 0.0f)) continue;
+    const float kAfter = std::sqrt(after[0] * after[0] + after[1] * after[1] +
+                                   after[2] * after[2]);
+    const float kDot =
+        before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+    if (kDot <= kMinFaceCosine * kBefore * kAfter) return false;
+  }
+  return true;
+}
+
+bool Simplifier::KeepsLink(uint32_t v, uint32_t u) const {
+  // v is not on a boundary, so every vertex around it is in two of its faces,
+  // and the two vertices opposite to the edge are counted twice each.
+  int shared = 0;
+  for (uint32_t a = adjacency_.offsets[v]; a < adjacency_.offsets[v + 1];
+       ++a) {
+    for (uint32_t k = 1; k < 3; ++k) {
+      const int kNeighbour = Corner(adjacency_.corners[a], k);
+      if (uint32_t(kNeighbour) == u) continue;
+      for (uint32_t b = adjacency_.offsets[u]; b < adjacency_.offsets[u + 1];
+           ++b) {
+        const uint32_t kCorner = adjacency_.corners[b];
+        if (Corner(kCorner, 1) == kNeighbour ||
+            Corner(kCorner, 2) == kNeighbour) {
+          ++shared;
+          break;
+        }
+      }
+    }
+  }
+  return shared == 4;
+}
+
+bool Simplifier::IsTouched(uint32_t v) const {
+  for (uint32_t a = adjacency_.offsets[v]; a < adjacency_.offsets[v + 1];
+       ++a) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      if (stamps_[Corner(adjacency_.corners[a], k)] == pass_) return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+size_t BuildLevelsOfDetail(TriangleMesh *mesh, float ratio,
+                           size_t min_faces) {
+  mesh->lodFaces_.clear();
+  mesh->lods_.clear();
+  if (!mesh->materialRanges_.empty() || mesh->vertices_.empty() ||
+      !(ratio > 0.0f && ratio < 1.0f))
+    return 0;
+  if (size_t(mesh->faces_.size() / 3 * ratio) < min_faces) return 0;
+  const VertexAdjacency &kAdjacency = mesh->Adjacency();
+  if (kAdjacency.empty()) {
+    std::cerr << "The mesh is too large to simplify" << std::endl;
+    return 0;
+  }
+
+  const auto kStart = std::chrono::steady_clock::now();
+  Simplifier simplifier(*mesh, kAdjacency);
+  size_t faces = simplifier.faces().size() / 3;
+  while (size_t(faces * ratio) >= min_faces) {
+    simplifier.Simplify(size_t(faces * ratio));
+    const std::vector<int> &kLevel = simplifier.faces();
+    if (kLevel.size() / 3 > faces * kMaxLevelFraction) break;
+    faces = kLevel.size() / 3;
+    mesh->lods_.push_back({mesh->lodFaces_.size(), kLevel.size(),
+                           simplifier.error() * mesh->radius_});
+    mesh->lodFaces_.insert(mesh->lodFaces_.end(), kLevel.begin(),
+                           kLevel.end());
+  }
+  const std::chrono::duration<double, std::milli> kElapsed =
+      std::chrono::steady_clock::now() - kStart;
+
+  std::cout << "Built " << mesh->lods_.size() << " levels of detail"
+            << std::endl;
+  for (const TriangleMesh::LevelOfDetail &kLod : mesh->lods_) {
+    std::cout << "\t" << kLod.count / 3 << " faces, error = " << kLod.error
+              << std::endl;
+  }
+  std::cout << "\tSimplification time = " << kElapsed.count() << " ms"
+            << std::endl;
+  return mesh->lods_.size();
+}
+
+}  // namespace data_representation
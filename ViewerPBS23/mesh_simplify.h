@@ -0,0 +1,48 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_SIMPLIFY_H_
+#define MESH_SIMPLIFY_H_
+
+#include <cstddef>
+
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief kLodRatio Faces of every level of detail relative to the previous
+ * one.
+ */
+const float kLodRatio = 0.5f;
+
+/**
+ * @brief kMinLodFaces Levels of detail are not simplified below this many
+ * faces, which cost less to draw than to choose between.
+ */
+const size_t kMinLodFaces = 1024;
+
+/**
+ * @brief BuildLevelsOfDetail Builds the levels of detail of mesh into its
+ * lodFaces_ and lods_, each one simplified from the previous one down to
+ * ratio of its faces. The simplification collapses edges in the order of their
+ * quadric error (Garland and Heckbert 1997), always onto one of their two
+ * vertices, so every level indexes the same vertices_. It runs in passes:
+ * every vertex finds its cheapest collapse in parallel, over the adjacency of
+ * the faces left, and then the cheapest collapses whose faces do not overlap
+ * are applied. Collapses that would flip a face or pinch the surface are
+ * rejected, and vertices on a boundary or a non-manifold edge, which includes
+ * the seams of texture coordinates and normals, are never moved. The chain
+ * ends when a level cannot be simplified any further.
+ * @param mesh The mesh, whose center_ and radius_ are known. Meshes with
+ * materials get no levels of detail, since every material range would have
+ * to be simplified on its own.
+ * @param ratio Faces of every level relative to the previous one, below 1.
+ * @param min_faces Faces of the coarsest level, at least.
+ * @return The number of levels built.
+ */
+size_t BuildLevelsOfDetail(TriangleMesh *mesh, float ratio = kLodRatio,
+                           size_t min_faces = kMinLodFaces);
+
+}  // namespace data_representation
+
+#endif  // MESH_SIMPLIFY_H_
@@ -0,0 +1,823 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+// Headless tests and benchmarks of the mesh loading code: models are written,
+// read back and compared, and the throughput of the writers and loaders is
+// measured on large generated meshes. Exits with 1 if any test fails.
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "./float_parser.h"
+#include "./gltf_format.h"
+#include "./mesh_codec.h"
+#include "./mesh_generators.h"
+#include "./mesh_io.h"
+#include "./mesh_normals.h"
+#include "./mesh_triangulate.h"
+#include "./triangle_mesh.h"
+
+#ifndef MODELS_DIR
+#define MODELS_DIR "models/"
+#endif
+
+namespace {
+
+using data_representation::TriangleMesh;
+
+// Quads per side of the plane the benchmarks write and read, 2M faces.
+const size_t kBenchmarkSide = 1000;
+
+// Discards everything written to it, like the loader logs and errors.
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+};
+
+// The results go to the original std::cout, whose own buffer is discarded
+// with the one of std::cerr.
+std::ostream *report = &std::cout;
+
+// Temporary files are written to the working directory.
+std::string TemporaryPath(const std::string &name) {
+  return "mesh_tests_" + name;
+}
+
+double Megabytes(const std::string &path) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) return 0.0;
+  return static_cast<double>(info.st_size) / (1 << 20);
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> kElapsed =
+      std::chrono::steady_clock::now() - start;
+  return std::max(kElapsed.count(), 1e-9);
+}
+
+// Reports what differs when check fails, and returns check.
+bool Expect(bool check, const std::string &what) {
+  if (!check) *report << "\t" << what << " differ" << std::endl;
+  return check;
+}
+
+bool TestPlyRoundTrip() {
+  TriangleMesh mesh;
+  if (!data_representation::GenerateTorus(64, 16, 0.25f, &mesh)) return false;
+  // The generators make neither colors nor quality.
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  mesh.colors_.resize(kVertices * 4);
+  mesh.quality_.resize(kVertices);
+  for (size_t i = 0; i < kVertices; ++i) {
+    for (size_t k = 0; k < 4; ++k) mesh.colors_[i * 4 + k] = uint8_t(i + k);
+    mesh.quality_[i] = float(i) / float(kVertices);
+  }
+
+  const std::string kPath = TemporaryPath("round_trip.ply");
+  if (!Expect(data_representation::WriteToPly(kPath, mesh), "Writes"))
+    return false;
+  TriangleMesh read;
+  const bool kRead = data_representation::ReadFromPly(kPath, &read);
+  std::remove(kPath.c_str());
+  if (!Expect(kRead, "Reads")) return false;
+
+  bool ok = Expect(read.vertices_ == mesh.vertices_, "Positions");
+  ok = Expect(read.faces_ == mesh.faces_, "Faces") && ok;
+  ok = Expect(read.normals_ == mesh.normals_, "Normals") && ok;
+  ok = Expect(read.texCoords_ == mesh.texCoords_, "Texture coordinates") && ok;
+  ok = Expect(read.colors_ == mesh.colors_, "Colors") && ok;
+  ok = Expect(read.quality_ == mesh.quality_, "Qualities") && ok;
+  return ok;
+}
+
+bool TestObjMixedCorners() {
+  TriangleMesh mesh;
+  if (!Expect(data_representation::ReadFromObj(
+                  MODELS_DIR "mixed_corners.obj", &mesh),
+              "Reads"))
+    return false;
+  bool ok = Expect(mesh.faces_.size() == 6 * 3, "Face counts");
+  // Positions 1, 3, 4 and 5 appear without texture coordinates.
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  size_t untextured = 0;
+  ok = Expect(mesh.texCoords_.size() == kVertices * 2,
+              "Texture coordinate counts") && ok;
+  for (size_t i = 0; i < mesh.texCoords_.size() / 2; ++i)
+    untextured += mesh.texCoords_[i * 2] == 0.f &&
+                  mesh.texCoords_[i * 2 + 1] == 0.f;
+  ok = Expect(untextured == 4, "Missing texture coordinates") && ok;
+  // Some corners have no normal, so they are all computed, and the sides of
+  // the pyramid face up.
+  ok = Expect(mesh.normals_.size() == kVertices * 3, "Normal counts") && ok;
+  bool unit = true, up = false;
+  for (size_t i = 0; i < mesh.normals_.size() / 3; ++i) {
+    const float *kNormal = &mesh.normals_[i * 3];
+    const float kLength = std::sqrt(kNormal[0] * kNormal[0] +
+                                    kNormal[1] * kNormal[1] +
+                                    kNormal[2] * kNormal[2]);
+    unit = unit && std::fabs(kLength - 1.f) < 1e-5f;
+    up = up || kNormal[2] > 0.f;
+  }
+  ok = Expect(unit && up, "Computed normals") && ok;
+  return ok;
+}
+
+// Writes a GLB file of four positions, of which the accessor with the count
+// and byte offset given, as JSON numbers, makes one triangle.
+bool WriteGlb(const std::string &path, const std::string &count,
+              const std::string &offset) {
+  std::string json =
+      "{\"asset\":{\"version\":\"2.0\"},"
+      "\"buffers\":[{\"byteLength\":48}],"
+      "\"bufferViews\":[{\"buffer\":0,\"byteLength\":48}],"
+      "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,"
+      "\"type\":\"VEC3\",\"count\":" + count +
+      ",\"byteOffset\":" + offset + "}],"
+      "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}]}";
+  json.resize((json.size() + 3) / 4 * 4, ' ');
+  const float kPositions[12] = {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const uint32_t kJsonBytes = uint32_t(json.size());
+  const uint32_t kBinaryBytes = sizeof(kPositions);
+  const uint32_t kHeader[5] = {0x46546C67, 2,
+                               12 + 8 + kJsonBytes + 8 + kBinaryBytes,
+                               kJsonBytes, 0x4E4F534A};
+  const uint32_t kBinaryHeader[2] = {kBinaryBytes, 0x004E4942};
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) return false;
+  std::fwrite(kHeader, sizeof(kHeader), 1, file);
+  std::fwrite(json.data(), 1, json.size(), file);
+  std::fwrite(kBinaryHeader, sizeof(kBinaryHeader), 1, file);
+  std::fwrite(kPositions, sizeof(kPositions), 1, file);
+  return std::fclose(file) == 0;
+}
+
+bool TestGlbSizes() {
+  struct Case {
+    const char *count;
+    const char *offset;
+    bool valid;
+  };
+  const Case kCases[] = {
+      {"3", "0", true},     {"-3", "0", false},  {"3.5", "0", false},
+      {"1e300", "0", false}, {"3", "-12", false}, {"3", "1e19", false},
+      {"3", "12", true},     {"3", "13", false},
+  };
+  const std::string kPath = TemporaryPath("sizes.glb");
+  bool ok = true;
+  for (const Case &test : kCases) {
+    if (!Expect(WriteGlb(kPath, test.count, test.offset), "Writes"))
+      return false;
+    data_representation::GlbFile glb;
+    ok = Expect(glb.Open(kPath) == test.valid,
+                std::string("Results for count ") + test.count +
+                    " and byte offset " + test.offset) &&
+         ok;
+  }
+  std::remove(kPath.c_str());
+  return ok;
+}
+
+// Accepts every streamed chunk and discards it.
+class NullSink : public data_representation::MeshStreamSink {
+ public:
+  bool Begin(size_t, size_t, bool) override { return true; }
+  void AddVertices(size_t, size_t, const float *, const float *,
+                   const float *, const uint8_t *) override {}
+  void AddFaces(size_t, size_t, const int *) override {}
+  void AddNormals(size_t, size_t, const float *) override {}
+};
+
+// Writes a PLY file of one triangle of three double positions whose header
+// declares the vertex and face counts given.
+bool WritePly(const std::string &path, bool ascii, const std::string &vertices,
+              const std::string &faces) {
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) return false;
+  std::fprintf(file,
+               "ply\nformat %s 1.0\nelement vertex %s\n"
+               "property double x\nproperty double y\nproperty double z\n"
+               "element face %s\nproperty list uchar int vertex_indices\n"
+               "end_header\n",
+               ascii ? "ascii" : "binary_little_endian", vertices.c_str(),
+               faces.c_str());
+  const double kPositions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+  const int kFace[3] = {0, 1, 2};
+  if (ascii) {
+    for (size_t i = 0; i < 9; i += 3)
+      std::fprintf(file, "%g %g %g\n", kPositions[i], kPositions[i + 1],
+                   kPositions[i + 2]);
+    std::fprintf(file, "3 %d %d %d\n", kFace[0], kFace[1], kFace[2]);
+  } else {
+    const unsigned char kCorners = 3;
+    std::fwrite(kPositions, sizeof(kPositions), 1, file);
+    std::fwrite(&kCorners, 1, 1, file);
+    std::fwrite(kFace, sizeof(kFace), 1, file);
+  }
+  return std::fclose(file) == 0;
+}
+
+bool TestPlyCounts() {
+  struct Case {
+    bool ascii;
+    const char *vertices;
+    const char *faces;
+    bool valid;
+  };
+  const Case kCases[] = {
+      {false, "3", "1", true},
+      {false, "6148914691236517206", "1", false},
+      {false, "3", "6148914691236517206", false},
+      {false, "4", "1", false},
+      {false, "3", "2", false},
+      {true, "3", "1", true},
+      {true, "6148914691236517206", "1", false},
+      {true, "3", "18446744073709551615", false},
+  };
+  const std::string kPath = TemporaryPath("counts.ply");
+  bool ok = true;
+  for (const Case &test : kCases) {
+    if (!Expect(WritePly(kPath, test.ascii, test.vertices, test.faces),
+                "Writes"))
+      return false;
+    const std::string kWhat = std::string("Results for ") +
+                              (test.ascii ? "ascii" : "binary") + " counts " +
+                              test.vertices + " and " + test.faces;
+    TriangleMesh mesh;
+    ok = Expect(data_representation::ReadFromPly(kPath, &mesh) == test.valid,
+                kWhat) &&
+         ok;
+    if (!test.ascii) {
+      TriangleMesh streamed;
+      NullSink sink;
+      ok = Expect(data_representation::StreamFromPly(kPath, 1, &sink,
+                                                     &streamed) == test.valid,
+                  "Streamed " + kWhat) &&
+           ok;
+    }
+  }
+  std::remove(kPath.c_str());
+  return ok;
+}
+
+// Whether every coordinate of values is within the quantization step of
+// the one of expected, with the vertices of values numbered by remap.
+bool WithinStep(const std::vector<float> &expected,
+                const std::vector<float> &values, size_t width, int bits,
+                const std::vector<int> &remap) {
+  const size_t kVertices = remap.size();
+  if (expected.size() != kVertices * width || values.size() != expected.size())
+    return false;
+  for (size_t c = 0; c < width; ++c) {
+    float min = expected[c], max = expected[c];
+    for (size_t v = 0; v < kVertices; ++v) {
+      min = std::min(min, expected[v * width + c]);
+      max = std::max(max, expected[v * width + c]);
+    }
+    const float kStep = (max - min) / float((1u << bits) - 1);
+    for (size_t v = 0; v < kVertices; ++v) {
+      const float kError = std::fabs(values[remap[v] * width + c] -
+                                     expected[v * width + c]);
+      if (kError > kStep) return false;
+    }
+  }
+  return true;
+}
+
+bool TestCodecRoundTrip() {
+  TriangleMesh mesh;
+  if (!data_representation::GenerateTorus(64, 16, 0.25f, &mesh)) return false;
+  const size_t kVertices = mesh.vertices_.size() / 3;
+  mesh.colors_.resize(kVertices * 4);
+  mesh.quality_.resize(kVertices);
+  for (size_t i = 0; i < kVertices; ++i) {
+    for (size_t k = 0; k < 4; ++k) mesh.colors_[i * 4 + k] = uint8_t(i * 7 + k);
+    mesh.quality_[i] = std::sin(float(i));
+  }
+
+  const data_representation::MeshCodecOptions kOptions;
+  std::vector<char> encoded;
+  if (!Expect(data_representation::EncodeMesh(mesh, kOptions, &encoded),
+              "Encodes"))
+    return false;
+  TriangleMesh decoded;
+  if (!Expect(data_representation::DecodeMesh(encoded.data(), encoded.size(),
+                                              &decoded),
+              "Decodes"))
+    return false;
+
+  // The codec numbers the vertices in the order the faces first use them.
+  std::vector<int> remap(kVertices, -1);
+  int next = 0;
+  for (int index : mesh.faces_) {
+    if (remap[index] < 0) remap[index] = next++;
+  }
+  for (int &index : remap) {
+    if (index < 0) index = next++;
+  }
+  std::vector<int> faces(mesh.faces_.size());
+  for (size_t i = 0; i < faces.size(); ++i) faces[i] = remap[mesh.faces_[i]];
+
+  bool ok = Expect(decoded.faces_ == faces, "Faces");
+  ok = Expect(WithinStep(mesh.vertices_, decoded.vertices_, 3,
+                         kOptions.position_bits, remap),
+              "Positions") && ok;
+  ok = Expect(WithinStep(mesh.texCoords_, decoded.texCoords_, 2,
+                         kOptions.tex_coord_bits, remap),
+              "Texture coordinates") && ok;
+  ok = Expect(WithinStep(mesh.quality_, decoded.quality_, 1,
+                         kOptions.quality_bits, remap),
+              "Qualities") && ok;
+  // Normals are quantized on their octahedral projection, whose step of
+  // 2 / (2^bits - 1) moves a unit normal by at most about twice as much.
+  bool normals = decoded.normals_.size() == mesh.normals_.size();
+  bool colors = decoded.colors_.size() == mesh.colors_.size();
+  const float kNormalStep = 4.0f / float((1u << kOptions.normal_bits) - 1);
+  for (size_t v = 0; v < kVertices && normals && colors; ++v) {
+    for (size_t c = 0; c < 3; ++c) {
+      normals = normals && std::fabs(decoded.normals_[remap[v] * 3 + c] -
+                                     mesh.normals_[v * 3 + c]) <= kNormalStep;
+    }
+    for (size_t c = 0; c < 4; ++c) {
+      colors = colors && decoded.colors_[remap[v] * 4 + c] ==
+                             mesh.colors_[v * 4 + c];
+    }
+  }
+  ok = Expect(normals, "Normals") && ok;
+  ok = Expect(colors, "Colors") && ok;
+
+  // Any truncation, down to a partial header, is rejected.
+  bool truncated = true;
+  for (size_t size : {encoded.size() - 1, encoded.size() / 2, size_t(16),
+                      size_t(0)}) {
+    TriangleMesh partial;
+    truncated = truncated &&
+                !data_representation::DecodeMesh(encoded.data(), size,
+                                                 &partial);
+  }
+  ok = Expect(truncated, "Truncated results") && ok;
+  return ok;
+}
+
+// Whether ParseFloat reads all of text to the same float as strtof, which
+// runs in the "C" locale since the tests never set another one.
+bool ParsesLikeStrtof(const std::string &text) {
+  const char *kEnd = text.c_str() + text.size();
+  float parsed = 0.0f;
+  const float kExpected = std::strtof(text.c_str(), nullptr);
+  if (data_representation::ParseFloat(text.c_str(), kEnd, &parsed) != kEnd ||
+      std::memcmp(&parsed, &kExpected, sizeof(float)) != 0) {
+    *report << "\t" << text << std::setprecision(9) << " parsed as "
+            << parsed << ", not " << kExpected << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool TestParseFloat() {
+  const char *kCases[] = {
+      "0", "-0", "1", "0.1", "+3.25e2", ".5", "5.", "1E-3",
+      // Halfway between two floats, rounded to even.
+      "16777217", "16777219", "33554434", "0.500000029802322387695312500",
+      "1.00000005960464477539062500", "1.00000017881393432617187500",
+      // Subnormals and underflow.
+      "1e-45", "1.4e-45", "7e-46", "7.1e-46", "1e-46", "1e-50",
+      "1.17549421e-38", "1.17549435e-38", "5.87747175e-39",
+      // The largest float and overflow.
+      "3.4028234e38", "3.40282356e38", "3.40282357e38", "3.4028236e38",
+      "1e39", "-1e39", "1e400",
+      // More than 19 significant digits.
+      "12345678901234567890", "1234567890123456789012345",
+      "0.0000000000000000000000000000000000000000000014012984643248170709",
+      "340282356779733661637539395458142568447.99999",
+      "16777217.0000000000000000000001", "16777216.9999999999999999999999",
+  };
+  bool ok = true;
+  for (const char *text : kCases) ok = ParsesLikeStrtof(text) && ok;
+
+  // Floats of every exponent, shortest and longer, and the exact decimal
+  // expansions of the points halfway between them and the next float.
+  uint32_t random = 12345;
+  for (int i = 0; i < 20000; ++i) {
+    random = random * 1664525u + 1013904223u;
+    float value;
+    std::memcpy(&value, &random, sizeof(value));
+    if (!std::isfinite(value)) continue;
+    const double kHalfway =
+        (double(value) +
+         double(std::nextafter(value, std::numeric_limits<float>::max()))) /
+        2.0;
+    char text[512];
+    const char *kFormats[] = {"%.9g", "%.17g", "%.60g"};
+    for (const char *format : kFormats) {
+      std::snprintf(text, sizeof(text), format, double(value));
+      ok = ParsesLikeStrtof(text) && ok;
+    }
+    // Up to 160 significant digits keep every halfway point exact.
+    std::snprintf(text, sizeof(text), "%.160g", kHalfway);
+    ok = ParsesLikeStrtof(text) && ok;
+  }
+  return ok;
+}
+
+// Angle weighted vertex normals in double precision, one corner at a time.
+std::vector<float> ReferenceNormals(const TriangleMesh &mesh) {
+  std::vector<double> sums(mesh.vertices_.size(), 0.0);
+  for (size_t f = 0; f + 2 < mesh.faces_.size(); f += 3) {
+    double corners[3][3];
+    for (int k = 0; k < 3; ++k) {
+      for (int c = 0; c < 3; ++c)
+        corners[k][c] = mesh.vertices_[mesh.faces_[f + k] * 3 + c];
+    }
+    double u[3], v[3], normal[3];
+    for (int c = 0; c < 3; ++c) {
+      u[c] = corners[1][c] - corners[0][c];
+      v[c] = corners[2][c] - corners[0][c];
+    }
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+    const double kLength = std::sqrt(normal[0] * normal[0] +
+                                     normal[1] * normal[1] +
+                                     normal[2] * normal[2]);
+    if (kLength == 0.0) continue;
+    for (int k = 0; k < 3; ++k) {
+      const double *kPrevious = corners[(k + 2) % 3];
+      const double *kNext = corners[(k + 1) % 3];
+      double a[3], b[3], dot = 0.0, a_length = 0.0, b_length = 0.0;
+      for (int c = 0; c < 3; ++c) {
+        a[c] = kNext[c] - corners[k][c];
+        b[c] = kPrevious[c] - corners[k][c];
+        dot += a[c] * b[c];
+        a_length += a[c] * a[c];
+        b_length += b[c] * b[c];
+      }
+      const double kCosine = dot / std::sqrt(a_length * b_length);
+      const double kAngle = std::acos(std::min(1.0, std::max(-1.0, kCosine)));
+      for (int c = 0; c < 3; ++c)
+        sums[mesh.faces_[f + k] * 3 + c] += kAngle * normal[c] / kLength;
+    }
+  }
+  std::vector<float> normals(sums.size(), 0.0f);
+  for (size_t i = 0; i < sums.size(); i += 3) {
+    const double kLength = std::sqrt(sums[i] * sums[i] +
+                                     sums[i + 1] * sums[i + 1] +
+                                     sums[i + 2] * sums[i + 2]);
+    if (kLength == 0.0) continue;
+    for (int c = 0; c < 3; ++c) normals[i + c] = float(sums[i + c] / kLength);
+  }
+  return normals;
+}
+
+// The largest difference between the coordinates of two sets of normals.
+float MaxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+  if (a.size() != b.size()) return std::numeric_limits<float>::infinity();
+  float difference = 0.0f;
+  for (size_t i = 0; i < a.size(); ++i)
+    difference = std::max(difference, std::fabs(a[i] - b[i]));
+  return difference;
+}
+
+bool TestVertexNormals() {
+  // A torus with jittered vertices, so that corner angles vary.
+  TriangleMesh mesh;
+  if (!data_representation::GenerateTorus(96, 32, 0.25f, &mesh)) return false;
+  uint32_t random = 12345;
+  for (float &coordinate : mesh.vertices_) {
+    random = random * 1664525u + 1013904223u;
+    coordinate += 0.004f * (float(random >> 8) / float(1 << 24) - 0.5f);
+  }
+  const std::vector<float> kReference = ReferenceNormals(mesh);
+  const float kTolerance = 2e-5f;
+
+  std::vector<float> normals;
+  data_representation::ComputeVertexNormals(mesh.vertices_, mesh.faces_,
+                                            &normals);
+  bool ok = Expect(MaxDifference(normals, kReference) <= kTolerance,
+                   "Gathered normals");
+
+  // The streaming path accumulates the faces in chunks instead.
+  std::vector<float> accumulated(mesh.vertices_.size(), 0.0f);
+  const size_t kChunk = 3 * 1000;
+  for (size_t first = 0; first < mesh.faces_.size(); first += kChunk) {
+    data_representation::AccumulateVertexNormals(
+        mesh.vertices_, mesh.faces_.data() + first,
+        std::min(kChunk, mesh.faces_.size() - first), &accumulated);
+  }
+  data_representation::NormalizeVertexNormals(&accumulated);
+  ok = Expect(MaxDifference(accumulated, kReference) <= kTolerance,
+              "Accumulated normals") && ok;
+  return ok;
+}
+
+// Whether triangulating the polygon at points, (x, y) pairs in
+// counterclockwise order on the plane z = y * slope, gives size - 2
+// triangles of its winding that cover its area.
+bool TriangulatesPolygon(const std::vector<float> &points, float slope,
+                         const std::string &name) {
+  const int kSize = int(points.size() / 2);
+  // Vertices are numbered backwards, so that corners are not the identity.
+  std::vector<float> positions(kSize * 3);
+  std::vector<int> corners(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    corners[i] = kSize - 1 - i;
+    positions[corners[i] * 3] = points[i * 2];
+    positions[corners[i] * 3 + 1] = points[i * 2 + 1];
+    positions[corners[i] * 3 + 2] = points[i * 2 + 1] * slope;
+  }
+
+  std::vector<int> triangles;
+  data_representation::TriangulatePolygons(positions, corners, {kSize},
+                                           &triangles);
+  if (!Expect(triangles.size() == size_t(kSize - 2) * 3,
+              name + " triangle counts"))
+    return false;
+
+  // Twice the area of the polygon, along the normal of its plane.
+  const double kNormal[3] = {0.0, -slope, 1.0};
+  const double kNormalLength = std::sqrt(1.0 + double(slope) * slope);
+  double polygon = 0.0;
+  for (int i = 0; i < kSize; ++i) {
+    const int kNext = (i + 1) % kSize;
+    polygon += double(points[i * 2]) * points[kNext * 2 + 1] -
+               double(points[kNext * 2]) * points[i * 2 + 1];
+  }
+  polygon *= kNormalLength;
+
+  bool wound = true;
+  double covered = 0.0;
+  for (size_t t = 0; t < triangles.size(); t += 3) {
+    const float *kA = &positions[corners[triangles[t]] * 3];
+    const float *kB = &positions[corners[triangles[t + 1]] * 3];
+    const float *kC = &positions[corners[triangles[t + 2]] * 3];
+    double u[3], v[3];
+    for (int c = 0; c < 3; ++c) {
+      u[c] = double(kB[c]) - kA[c];
+      v[c] = double(kC[c]) - kA[c];
+    }
+    const double kCross[3] = {u[1] * v[2] - u[2] * v[1],
+                              u[2] * v[0] - u[0] * v[2],
+                              u[0] * v[1] - u[1] * v[0]};
+    const double kTwiceArea = (kCross[0] * kNormal[0] +
+                               kCross[1] * kNormal[1] +
+                               kCross[2] * kNormal[2]) /
+                              kNormalLength;
+    wound = wound && kTwiceArea > 0.0;
+    covered += std::fabs(kTwiceArea);
+  }
+  bool ok = Expect(wound, name + " windings");
+  ok = Expect(std::fabs(covered - polygon) <= 1e-4 * polygon,
+              name + " areas") && ok;
+  return ok;
+}
+
+bool TestTriangulation() {
+  // An arrowhead whose reflex corner is the first one, which the fan from
+  // it splits, and the second one, which only the other diagonal splits.
+  bool ok = TriangulatesPolygon({0, 1, -1, 2, 0, 0, 1, 2}, 0.0f,
+                                "Reflex first corner");
+  ok = TriangulatesPolygon({1, 2, 0, 1, -1, 2, 0, 0}, 0.0f,
+                           "Reflex second corner") && ok;
+
+  // A star of 16 corners and a comb, flat and on a tilted plane.
+  std::vector<float> star;
+  for (int i = 0; i < 16; ++i) {
+    const float kRadius = i % 2 == 0 ? 1.0f : 0.4f;
+    const float kAngle = float(i) * 3.14159265f / 8.0f;
+    star.push_back(kRadius * std::cos(kAngle));
+    star.push_back(kRadius * std::sin(kAngle));
+  }
+  const std::vector<float> kComb = {0, 0, 5, 0, 5, 3, 4, 3, 4, 1, 3, 1,
+                                    3, 3, 2, 3, 2, 1, 1, 1, 1, 3, 0, 3};
+  for (float slope : {0.0f, 2.0f}) {
+    const std::string kPlane = slope == 0.0f ? " flat" : " tilted";
+    ok = TriangulatesPolygon(star, slope, "Star" + kPlane) && ok;
+    ok = TriangulatesPolygon(kComb, slope, "Comb" + kPlane) && ok;
+  }
+  return ok;
+}
+
+// Whether the bounding sphere of mesh contains its vertices and its radius
+// is within 1e-5 of radius.
+bool HasSphere(const TriangleMesh &mesh, float radius,
+               const std::string &name) {
+  bool contained = true;
+  for (size_t v = 0; v < mesh.vertices_.size(); v += 3) {
+    const Eigen::Vector3f kPosition(mesh.vertices_[v], mesh.vertices_[v + 1],
+                                    mesh.vertices_[v + 2]);
+    contained = contained && (kPosition - mesh.center_).norm() <= mesh.radius_;
+  }
+  bool ok = Expect(contained, name + " contained vertices");
+  ok = Expect(std::fabs(mesh.radius_ - radius) <= 1e-5f, name + " radii") &&
+       ok;
+  return ok;
+}
+
+bool TestBoundingSpheres() {
+  // Round models, whose box diagonal is sqrt(3) times their radius.
+  TriangleMesh icosphere, cube_sphere, torus;
+  if (!data_representation::GenerateIcosphere(1, &icosphere) ||
+      !data_representation::GenerateCubeSphere(3, &cube_sphere) ||
+      !data_representation::GenerateTorus(64, 16, 0.25f, &torus))
+    return false;
+  bool ok = HasSphere(icosphere, 1.0f, "Icosphere");
+  ok = HasSphere(cube_sphere, 1.0f, "Cube sphere") && ok;
+  ok = HasSphere(torus, 1.0f, "Torus") && ok;
+  return ok;
+}
+
+bool BenchmarkPlyWrite() {
+  TriangleMesh mesh;
+  if (!data_representation::GeneratePlane(kBenchmarkSide, kBenchmarkSide,
+                                          &mesh))
+    return false;
+  const std::string kPath = TemporaryPath("write.ply");
+  const auto kStart = std::chrono::steady_clock::now();
+  const bool kWritten = data_representation::WriteToPly(kPath, mesh);
+  const double kSeconds = Seconds(kStart);
+  const double kMegabytes = Megabytes(kPath);
+  std::remove(kPath.c_str());
+  if (!Expect(kWritten, "Writes")) return false;
+  *report << "\tWrote " << mesh.faces_.size() / 3 << " faces, " << kMegabytes
+          << " MB in " << kSeconds * 1000.0 << " ms: "
+          << kMegabytes / kSeconds << " MB/s" << std::endl;
+  return true;
+}
+
+// Writes the positions and faces of mesh as a text OBJ file.
+bool WriteToObj(const std::string &path, const TriangleMesh &mesh) {
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) return false;
+  for (size_t i = 0; i + 2 < mesh.vertices_.size(); i += 3)
+    std::fprintf(file, "v %.6g %.6g %.6g\n", mesh.vertices_[i],
+                 mesh.vertices_[i + 1], mesh.vertices_[i + 2]);
+  for (size_t i = 0; i + 2 < mesh.faces_.size(); i += 3)
+    std::fprintf(file, "f %d %d %d\n", mesh.faces_[i] + 1,
+                 mesh.faces_[i + 1] + 1, mesh.faces_[i + 2] + 1);
+  return std::fclose(file) == 0;
+}
+
+// Times load on the file at path, which holds faces faces.
+// The PLY reader ReadFromPly replaced, kept to measure the speedup: one
+// std::ifstream::read per value, then the bounding box. It only reads the
+// float vertex properties (positions, normals and texture coordinates) and
+// the triangle lists that WriteToPly writes.
+bool ReadPlyWithStream(const std::string &path, TriangleMesh *mesh) {
+  std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+  std::string line;
+  size_t vertices = 0, faces = 0, floats = 0;
+  while (std::getline(in, line) && line != "end_header") {
+    std::istringstream words(line);
+    std::string keyword, type, name;
+    words >> keyword >> type >> name;
+    if (keyword == "element" && type == "vertex") vertices = std::stoul(name);
+    if (keyword == "element" && type == "face") faces = std::stoul(name);
+    if (keyword == "property" && type == "float") ++floats;
+  }
+  if (!in || (floats != 3 && floats != 6 && floats != 8)) return false;
+
+  mesh->vertices_.resize(vertices * 3);
+  if (floats >= 6) mesh->normals_.resize(vertices * 3);
+  if (floats == 8) mesh->texCoords_.resize(vertices * 2);
+  for (size_t v = 0; v < vertices; ++v) {
+    float values[8];
+    for (size_t i = 0; i < floats; ++i)
+      in.read(reinterpret_cast<char *>(&values[i]), sizeof(float));
+    std::copy(values, values + 3, &mesh->vertices_[v * 3]);
+    if (floats >= 6)
+      std::copy(values + 3, values + 6, &mesh->normals_[v * 3]);
+    if (floats == 8)
+      std::copy(values + 6, values + 8, &mesh->texCoords_[v * 2]);
+  }
+  mesh->faces_.resize(faces * 3);
+  for (size_t f = 0; f < faces; ++f) {
+    unsigned char corners;
+    in.read(reinterpret_cast<char *>(&corners), sizeof(corners));
+    if (corners != 3) return false;
+    for (size_t i = 0; i < 3; ++i)
+      in.read(reinterpret_cast<char *>(&mesh->faces_[f * 3 + i]), sizeof(int));
+  }
+  for (size_t v = 0; v < vertices * 3; v += 3) {
+    for (int k = 0; k < 3; ++k) {
+      mesh->min_[k] = std::min(mesh->min_[k], mesh->vertices_[v + k]);
+      mesh->max_[k] = std::max(mesh->max_[k], mesh->vertices_[v + k]);
+    }
+  }
+  return bool(in);
+}
+
+// Times load on path, checks that it read faces faces and reports the
+// throughput. Returns the time in seconds, or 0 if the load failed.
+double BenchmarkLoad(
+    const std::string &path, size_t faces,
+    const std::function<bool(const std::string &, TriangleMesh *)> &load) {
+  TriangleMesh read;
+  const auto kStart = std::chrono::steady_clock::now();
+  const bool kRead = load(path, &read);
+  const double kSeconds = Seconds(kStart);
+  const double kMegabytes = Megabytes(path);
+  if (!Expect(kRead, "Reads")) return 0.0;
+  if (!Expect(read.faces_.size() / 3 == faces, "Face counts")) return 0.0;
+  *report << "\tRead " << faces << " faces, " << kMegabytes << " MB in "
+          << kSeconds * 1000.0 << " ms: " << kMegabytes / kSeconds << " MB/s"
+          << std::endl;
+  return kSeconds;
+}
+
+bool BenchmarkPlyLoad() {
+  TriangleMesh mesh;
+  if (!data_representation::GeneratePlane(kBenchmarkSide, kBenchmarkSide,
+                                          &mesh))
+    return false;
+  const std::string kPath = TemporaryPath("load.ply");
+  if (!Expect(data_representation::WriteToPly(kPath, mesh), "Writes"))
+    return false;
+  const size_t kFaces = mesh.faces_.size() / 3;
+  const double kSeconds =
+      BenchmarkLoad(kPath, kFaces, [](const std::string &path,
+                                      TriangleMesh *read) {
+        return data_representation::ReadFromPly(path, read);
+      });
+  *report << "\tWith std::ifstream, as before:" << std::endl;
+  const double kStreamSeconds = BenchmarkLoad(kPath, kFaces,
+                                              ReadPlyWithStream);
+  std::remove(kPath.c_str());
+  if (kSeconds == 0.0 || kStreamSeconds == 0.0) return false;
+  *report << "\tSpeedup: " << kStreamSeconds / kSeconds << "x" << std::endl;
+  return true;
+}
+
+bool BenchmarkObjLoad() {
+  TriangleMesh mesh;
+  if (!data_representation::GeneratePlane(kBenchmarkSide, kBenchmarkSide,
+                                          &mesh))
+    return false;
+  const std::string kPath = TemporaryPath("load.obj");
+  if (!Expect(WriteToObj(kPath, mesh), "Writes")) return false;
+  const double kSeconds =
+      BenchmarkLoad(kPath, mesh.faces_.size() / 3,
+                    [](const std::string &path, TriangleMesh *read) {
+                      return data_representation::ReadFromObj(path, read);
+                    });
+  std::remove(kPath.c_str());
+  return kSeconds > 0.0;
+}
+
+struct Test {
+  const char *name;
+  std::function<bool()> run;
+};
+
+}  // namespace
+
+int main() {
+  const std::vector<Test> kTests = {
+      {"PLY round trip", TestPlyRoundTrip},
+      {"OBJ corners without normals or texture coordinates",
+       TestObjMixedCorners},
+      {"glTF accessor sizes", TestGlbSizes},
+      {"PLY element counts", TestPlyCounts},
+      {"Mesh codec round trip", TestCodecRoundTrip},
+      {"Float parsing", TestParseFloat},
+      {"Angle weighted vertex normals", TestVertexNormals},
+      {"Concave polygon triangulation", TestTriangulation},
+      {"Bounding spheres", TestBoundingSpheres},
+      {"PLY write throughput", BenchmarkPlyWrite},
+      {"PLY load throughput", BenchmarkPlyLoad},
+      {"OBJ load throughput", BenchmarkObjLoad},
+  };
+
+  std::ostream out(std::cout.rdbuf());
+  report = &out;
+  NullBuffer discard;
+  std::cout.rdbuf(&discard);
+  std::streambuf *errors = std::cerr.rdbuf(&discard);
+
+  size_t failed = 0;
+  for (const Test &test : kTests) {
+    out << test.name << std::endl;
+    const bool kPassed = test.run();
+    out << (kPassed ? "\tpassed" : "\tFAILED") << std::endl;
+    if (!kPassed) ++failed;
+  }
+  std::cout.rdbuf(out.rdbuf());
+  std::cerr.rdbuf(errors);
+
+  std::cout << kTests.size() - failed << " of " << kTests.size()
+            << " tests passed" << std::endl;
+  return failed == 0 ? 0 : 1;
+}
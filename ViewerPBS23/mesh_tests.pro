@@ -0,0 +1,71 @@
+# Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+#
+# Headless tests and benchmarks of the mesh loading code, run without Qt or
+# OpenGL. Exits with 1 if any test fails.
+
+QT       -= core gui
+
+TARGET = mesh_tests
+
+TEMPLATE = app
+
+CONFIG += c++14 console
+CONFIG -= app_bundle qt
+CONFIG(release, release|debug):QMAKE_CXXFLAGS += -Wall -O2
+# Lets the loops marked with "omp simd" vectorize: without errno and floating
+# point traps, sqrt and comparisons have no side effects.
+QMAKE_CXXFLAGS += -fopenmp-simd -fno-math-errno -fno-trapping-math
+
+CONFIG(release, release|debug):DESTDIR = $$PWD/release/
+CONFIG(release, release|debug):OBJECTS_DIR = $$PWD/release/mesh_tests/
+
+CONFIG(debug, release|debug):DESTDIR = $$PWD/debug/
+CONFIG(debug, release|debug):OBJECTS_DIR = $$PWD/debug/mesh_tests/
+
+# The tests read their fixtures from models/.
+DEFINES += MODELS_DIR=\\\"$$PWD/models/\\\"
+
+INCLUDEPATH += /usr/include/eigen3/
+
+LIBS += -lpthread
+
+SOURCES += \
+    mesh_tests.cc \
+    triangle_mesh.cc \
+    mesh_io.cc \
+    mesh_adjacency.cc \
+    mesh_normals.cc \
+    mesh_optimize.cc \
+    mapped_file.cc \
+    gltf_format.cc \
+    ply_format.cc \
+    mesh_cache.cc \
+    mesh_codec.cc \
+    mesh_analysis.cc \
+    mesh_generators.cc \
+    mesh_triangulate.cc \
+    mesh_weld.cc \
+    point_cloud.cc \
+    obj_parser.cc \
+    tiny_obj_loader.cc
+
+HEADERS  += \
+    triangle_mesh.h \
+    mesh_io.h \
+    mesh_adjacency.h \
+    mesh_normals.h \
+    mesh_optimize.h \
+    mapped_file.h \
+    float_parser.h \
+    gltf_format.h \
+    ply_format.h \
+    mesh_cache.h \
+    mesh_codec.h \
+    mesh_analysis.h \
+    mesh_generators.h \
+    mesh_triangulate.h \
+    mesh_weld.h \
+    obj_parser.h \
+    parallel_for.h \
+    point_cloud.h \
+    tiny_obj_loader.h
@@ -0,0 +1,203 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <mesh_triangulate.h>
+
+#include <eigen3/Eigen/Geometry>
+
+#include <numeric>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Ranges with fewer polygons than this are not worth a thread.
+const size_t kMinPolygons = 1 << 14;
+
+size_t TriangleCount(int size) { return size > 2 ? size_t(size - 2) : 0; }
+
+Eigen::Vector3f Position(const std::vector<float> &positions, int vertex) {
+  return Eigen::Vector3f(positions[vertex * 3], positions[vertex * 3 + 1],
+                         positions[vertex * 3 + 2]);
+}
+
+/**
+ * Ear clipping of polygons with more than four corners. The scratch arrays
+ * are reused from one polygon to the next.
+ */
+class EarClipper {
+ public:
+  // Writes the size - 2 triangles of the polygon whose corners start at
+  // first to out and returns the end of the written triangles.
+  int *Clip(const std::vector<float> &positions,
+            const std::vector<int> &corners, int first, int size, int *out) {
+    Project(positions, corners, first, size);
+
+    previous_.resize(size);
+    next_.resize(size);
+    for (int i = 0; i < size; ++i) {
+      previous_[i] = i == 0 ? size - 1 : i - 1;
+      next_[i] = i == size - 1 ? 0 : i + 1;
+    }
+
+    int remaining = size;
+    int current = 0;
+    int misses = 0;
+    while (remaining > 3) {
+      // A full turn without ears means the polygon is degenerate or self
+      // intersecting: clip the current corner anyway.
+      if (IsEar(current) || misses >= remaining) {
+        const int kPrevious = previous_[current];
+        const int kNext = next_[current];
+        out = Emit(first, kPrevious, current, kNext, out);
+        next_[kPrevious] = kNext;
+        previous_[kNext] = kPrevious;
+        current = kPrevious;
+        --remaining;
+        misses = 0;
+      } else {
+        current = next_[current];
+        ++misses;
+      }
+    }
+    return Emit(first, previous_[current], current, next_[current], out);
+  }
+
+ private:
+  // Projects the corners to the plane of the Newell normal by dropping its
+  // largest coordinate.
+  void Project(const std::vector<float> &positions,
+               const std::vector<int> &corners, int first, int size) {
+    const Eigen::Vector3f kOrigin = Position(positions, corners[first]);
+    Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+    Eigen::Vector3f last = Position(positions, corners[first + size - 1]) -
+                           kOrigin;
+    for (int i = 0; i < size; ++i) {
+      const Eigen::Vector3f kCurrent =
+          Position(positions, corners[first + i]) - kOrigin;
+      normal += last.cross(kCurrent);
+      last = kCurrent;
+    }
+
+    int axis = 0;
+    normal.cwiseAbs().maxCoeff(&axis);
+    // Keeping the other two axes in cyclic order keeps the winding, which is
+    // counterclockwise when the dropped coordinate of the normal is positive.
+    const int kU = (axis + 1) % 3;
+    const int kV = (axis + 2) % 3;
+    orientation_ = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+    points_.resize(size);
+    for (int i = 0; i < size; ++i) {
+      const Eigen::Vector3f kPoint =
+          Position(positions, corners[first + i]) - kOrigin;
+      points_[i] = Eigen::Vector2f(kPoint[kU], kPoint[kV]);
+    }
+  }
+
+  // Twice the area of abc, positive when it has the winding of the polygon.
+  float Area(int a, int b, int c) const {
+    const Eigen::Vector2f kAB = points_[b] - points_[a];
+    const Eigen::Vector2f kAC = points_[c] - points_[a];
+    return orientation_ * (kAB.x() * kAC.y() - kAB.y() * kAC.x());
+  }
+
+  bool IsEar(int corner) const {
+    const int kPrevious = previous_[corner];
+    const int kNext = next_[corner];
+    if (Area(kPrevious, corner, kNext) <= 0.0f) return false;
+    for (int i = next_[kNext]; i != kPrevious; i = next_[i]) {
+      if (Area(kPrevious, corner, i) >= 0.0f &&
+          Area(corner, kNext, i) >= 0.0f && Area(kNext, kPrevious, i) >= 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  static int *Emit(int first, int a, int b, int c, int *out) {
+    out[0] = first + a;
+    out[1] = first + b;
+    out[2] = first + c;
+    return out + 3;
+  }
+
+  std::vector<Eigen::Vector2f> points_;
+  std::vector<int> previous_;
+  std::vector<int> next_;
+  float orientation_;
+};
+
+// Splits the quad whose corners start at first along the diagonal whose two
+// triangles face the same way, which is the one inside the quad.
+int *SplitQuad(const std::vector<float> &positions,
+               const std::vector<int> &corners, int first, int *out) {
+  const Eigen::Vector3f kA = Position(positions, corners[first]);
+  const Eigen::Vector3f kB = Position(positions, corners[first + 1]);
+  const Eigen::Vector3f kC = Position(positions, corners[first + 2]);
+  const Eigen::Vector3f kD = Position(positions, corners[first + 3]);
+  const bool kFan =
+      (kB - kA).cross(kC - kA).dot((kC - kA).cross(kD - kA)) >= 0.0f;
+  const int kStart = kFan ? 0 : 1;
+  out[0] = first + kStart;
+  out[1] = first + kStart + 1;
+  out[2] = first + kStart + 2;
+  out[3] = first + kStart;
+  out[4] = first + kStart + 2;
+  out[5] = first + (kStart + 3) % 4;
+  return out + 6;
+}
+
+}  // namespace
+
+size_t TriangulatedSize(const std::vector<int> &sizes) {
+  size_t triangles = 0;
+  for (int size : sizes) triangles += TriangleCount(size);
+  return triangles * 3;
+}
+
+void TriangulatePolygons(const std::vector<float> &positions,
+                         const std::vector<int> &corners,
+                         const std::vector<int> &sizes,
+                         std::vector<int> *triangles) {
+  const size_t kPolygons = sizes.size();
+  const size_t kRanges = RangeCount(kPolygons, kMinPolygons);
+
+  // Where the corners and the triangles of every range start.
+  std::vector<size_t> corner_offsets(kRanges + 1, 0);
+  std::vector<size_t> triangle_offsets(kRanges + 1, 0);
+  ParallelFor(kPolygons, kMinPolygons,
+              [&](size_t range, size_t first, size_t last) {
+                for (size_t i = first; i < last; ++i) {
+                  corner_offsets[range + 1] += sizes[i];
+                  triangle_offsets[range + 1] += TriangleCount(sizes[i]);
+                }
+              });
+  std::partial_sum(corner_offsets.begin(), corner_offsets.end(),
+                   corner_offsets.begin());
+  std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(),
+                   triangle_offsets.begin());
+  triangles->resize(triangle_offsets.back() * 3);
+
+  ParallelFor(kPolygons, kMinPolygons,
+              [&](size_t range, size_t first, size_t last) {
+                EarClipper clipper;
+                int corner = static_cast<int>(corner_offsets[range]);
+                int *out = triangles->data() + triangle_offsets[range] * 3;
+                for (size_t i = first; i < last; corner += sizes[i], ++i) {
+                  if (sizes[i] == 3) {
+                    out[0] = corner;
+                    out[1] = corner + 1;
+                    out[2] = corner + 2;
+                    out += 3;
+                  } else if (sizes[i] == 4) {
+                    out = SplitQuad(positions, corners, corner, out);
+                  } else if (sizes[i] > 4) {
+                    out = clipper.Clip(positions, corners, corner, sizes[i],
+                                       out);
+                  }
+                }
+              });
+}
+
+}  // namespace data_representation
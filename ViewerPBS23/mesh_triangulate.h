@@ -0,0 +1,37 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_TRIANGULATE_H_
+#define MESH_TRIANGULATE_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief TriangulatedSize Number of triangle corners TriangulatePolygons
+ * produces for polygons with the given sizes.
+ */
+size_t TriangulatedSize(const std::vector<int> &sizes);
+
+/**
+ * @brief TriangulatePolygons Splits polygons into triangles with their
+ * winding. Triangles are copied as they are, quads are split along a diagonal
+ * that lies inside them (a fan from the first corner when they are convex)
+ * and larger polygons are ear clipped in the plane of their Newell normal.
+ * Polygons are split into one range per thread and every range writes its
+ * triangles straight to their final place in triangles.
+ * @param positions Three coordinates per vertex.
+ * @param corners The vertex of every polygon corner, polygon after polygon.
+ * @param sizes Number of corners of every polygon, at least three.
+ * @param triangles Resulting triangles, as indices into corners, in polygon
+ * order. It is resized to TriangulatedSize(sizes).
+ */
+void TriangulatePolygons(const std::vector<float> &positions,
+                         const std::vector<int> &corners,
+                         const std::vector<int> &sizes,
+                         std::vector<int> *triangles);
+
+}  // namespace data_representation
+
+#endif  // MESH_TRIANGULATE_H_
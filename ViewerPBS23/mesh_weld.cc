@@ -0,0 +1,231 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include "./mesh_weld.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Below this many corners per thread welding is not worth a thread.
+const size_t kMinCorners = 1 << 16;
+
+uint64_t HashCorner(const tinyobj::index_t &corner) {
+  uint64_t hash = uint32_t(corner.vertex_index);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ uint32_t(corner.normal_index);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ uint32_t(corner.texcoord_index);
+  hash ^= hash >> 29;
+  hash *= 0xBF58476D1CE4E5B9ull;
+  return hash ^ (hash >> 32);
+}
+
+bool SameCorner(const tinyobj::index_t &a, const tinyobj::index_t &b) {
+  return a.vertex_index == b.vertex_index &&
+         a.normal_index == b.normal_index &&
+         a.texcoord_index == b.texcoord_index;
+}
+
+// Shards are selected with the high bits of the hash, table slots with the
+// low ones, so the keys of a shard still spread over its whole table.
+size_t ShardOf(uint64_t hash, size_t shards) {
+  return size_t((hash >> 32) * shards >> 32);
+}
+
+// Bit pattern of a coordinate, with -0 and +0 mapped to the same one.
+uint32_t CoordinateBits(float coordinate) {
+  coordinate += 0.0f;
+  uint32_t bits;
+  memcpy(&bits, &coordinate, sizeof(bits));
+  return bits;
+}
+
+uint64_t HashPosition(const float *position) {
+  uint64_t hash = CoordinateBits(position[0]);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ CoordinateBits(position[1]);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ CoordinateBits(position[2]);
+  hash ^= hash >> 29;
+  hash *= 0xBF58476D1CE4E5B9ull;
+  return hash ^ (hash >> 32);
+}
+
+bool SamePosition(const float *a, const float *b) {
+  return CoordinateBits(a[0]) == CoordinateBits(b[0]) &&
+         CoordinateBits(a[1]) == CoordinateBits(b[1]) &&
+         CoordinateBits(a[2]) == CoordinateBits(b[2]);
+}
+
+// Writes to representative[c] the first corner in shard whose key matches
+// the one of corner c. shard lists corner ids in increasing order.
+template <typename Hash, typename Same>
+void WeldShard(const Hash &hash, const Same &same, const int *shard,
+               size_t size, int *representative) {
+  size_t capacity = 16;
+  while (capacity < 2 * size) capacity *= 2;
+  const size_t kMask = capacity - 1;
+  std::vector<int> table(capacity, -1);
+
+  for (size_t i = 0; i < size; ++i) {
+    const int kCorner = shard[i];
+    size_t slot = hash(kCorner) & kMask;
+    while (table[slot] != -1 && !same(table[slot], kCorner)) {
+      slot = (slot + 1) & kMask;
+    }
+    if (table[slot] == -1) table[slot] = kCorner;
+    representative[kCorner] = table[slot];
+  }
+}
+
+// Welds the count corners whose keys compare equal with same. hash(c) is the
+// hash of the key of corner c. See WeldCorners for the outputs.
+template <typename Hash, typename Same>
+size_t Weld(size_t count, const Hash &hash, const Same &same,
+            std::vector<int> *remap, std::vector<int> *firsts) {
+  const size_t kCorners = count;
+  const size_t kRanges = RangeCount(kCorners, kMinCorners);
+  const size_t kShards = kRanges;
+
+  // Bucket the corner ids by shard. Every range counts its corners per shard
+  // and then scatters them, range after range, so each shard keeps the
+  // corners in increasing order.
+  std::vector<size_t> offsets(kRanges * kShards, 0);
+  ParallelFor(kCorners, kMinCorners,
+              [&](size_t range, size_t first, size_t last) {
+                size_t *counts = &offsets[range * kShards];
+                for (size_t c = first; c < last; ++c)
+                  ++counts[ShardOf(hash(c), kShards)];
+              });
+
+  std::vector<size_t> shard_begin(kShards + 1, 0);
+  size_t total = 0;
+  for (size_t s = 0; s < kShards; ++s) {
+    shard_begin[s] = total;
+    for (size_t r = 0; r < kRanges; ++r) {
+      const size_t kCount = offsets[r * kShards + s];
+      offsets[r * kShards + s] = total;
+      total += kCount;
+    }
+  }
+  shard_begin[kShards] = total;
+
+  std::vector<int> order(kCorners);
+  ParallelFor(kCorners, kMinCorners,
+              [&](size_t range, size_t first, size_t last) {
+                size_t *next = &offsets[range * kShards];
+                for (size_t c = first; c < last; ++c)
+                  order[next[ShardOf(hash(c), kShards)]++] =
+                      int(c);
+              });
+
+  // Find, for every corner, the first corner with the same triple.
+  std::vector<int> representative(kCorners);
+  ParallelFor(kShards, 1, [&](size_t, size_t first, size_t last) {
+    for (size_t s = first; s < last; ++s) {
+      WeldShard(hash, same, order.data() + shard_begin[s],
+                shard_begin[s + 1] - shard_begin[s], representative.data());
+    }
+  });
+
+  // Number the representatives in corner order, then point every other corner
+  // to the vertex of its representative.
+  std::vector<size_t> vertex_begin(kRanges + 1, 0);
+  ParallelFor(kCorners, kMinCorners,
+              [&](size_t range, size_t first, size_t last) {
+                size_t count = 0;
+                for (size_t c = first; c < last; ++c)
+                  count += representative[c] == int(c);
+                vertex_begin[range + 1] = count;
+              });
+  for (size_t r = 0; r < kRanges; ++r) vertex_begin[r + 1] += vertex_begin[r];
+
+  const size_t kVertices = vertex_begin[kRanges];
+  remap->resize(kCorners);
+  firsts->resize(kVertices);
+  ParallelFor(kCorners, kMinCorners,
+              [&](size_t range, size_t first, size_t last) {
+                size_t next = vertex_begin[range];
+                for (size_t c = first; c < last; ++c) {
+                  if (representative[c] != int(c)) continue;
+                  (*remap)[c] = int(next);
+                  (*firsts)[next++] = int(c);
+                }
+              });
+  ParallelFor(kCorners, kMinCorners, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      if (representative[c] != int(c))
+        (*remap)[c] = (*remap)[representative[c]];
+    }
+  });
+
+  return kVertices;
+}
+
+// Keeps the records of values listed in firsts, in that order.
+template <typename T>
+void Gather(const std::vector<int> &firsts, size_t width,
+            std::vector<T> *values) {
+  if (values->empty()) return;
+  std::vector<T> gathered(firsts.size() * width);
+  ParallelFor(firsts.size(), kMinCorners, [&](size_t, size_t first,
+                                              size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      const size_t kSource = size_t(firsts[v]) * width;
+      for (size_t k = 0; k < width; ++k)
+        gathered[v * width + k] = (*values)[kSource + k];
+    }
+  });
+  values->swap(gathered);
+}
+
+}  // namespace
+
+size_t WeldCorners(const std::vector<tinyobj::index_t> &corners,
+                   std::vector<int> *remap, std::vector<int> *firsts) {
+  return Weld(
+      corners.size(), [&](size_t c) { return HashCorner(corners[c]); },
+      [&](int a, int b) { return SameCorner(corners[a], corners[b]); },
+      remap, firsts);
+}
+
+size_t WeldPositions(const std::vector<float> &positions,
+                     std::vector<int> *remap, std::vector<int> *firsts) {
+  const float *kData = positions.data();
+  return Weld(
+      positions.size() / 3,
+      [kData](size_t c) { return HashPosition(kData + c * 3); },
+      [kData](int a, int b) {
+        return SamePosition(kData + size_t(a) * 3, kData + size_t(b) * 3);
+      },
+      remap, firsts);
+}
+
+size_t WeldVertices(TriangleMesh *mesh) {
+  const size_t kVertices = mesh->vertices_.size() / 3;
+  std::vector<int> remap;
+  std::vector<int> firsts;
+  const size_t kWelded = WeldPositions(mesh->vertices_, &remap, &firsts);
+  if (kWelded == kVertices) return 0;
+
+  GatherVertices(firsts, mesh);
+  std::vector<int> &faces = mesh->faces_;
+  ParallelFor(faces.size(), kMinCorners, [&](size_t, size_t first,
+                                             size_t last) {
+    for (size_t i = first; i < last; ++i) faces[i] = remap[faces[i]];
+  });
+  mesh->ResetAdjacency();
+  if (mesh->unweldedVertices_ == 0) mesh->unweldedVertices_ = kVertices;
+  return kVertices - kWelded;
+}
+
+void GatherVertices(const std::vector<int> &firsts, TriangleMesh *mesh) {
+  Gather(firsts, 3, &mesh->vertices_);
+  Gather(firsts, 3, &mesh->normals_);
+  Gather(firsts, 2, &mesh->texCoords_);
+  Gather(firsts, 4, &mesh->colors_);
+  Gather(firsts, 1, &mesh->quality_);
+}
+
+}  // namespace data_representation
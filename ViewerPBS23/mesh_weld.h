@@ -0,0 +1,62 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef MESH_WELD_H_
+#define MESH_WELD_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "./tiny_obj_loader.h"
+#include "./triangle_mesh.h"
+
+namespace data_representation {
+
+/**
+ * @brief WeldCorners Merges the face corners that reference the same
+ * (vertex_index, normal_index, texcoord_index) triple into a single vertex.
+ * Corners are hashed into one shard per thread and every shard is welded with
+ * its own open addressing table, so large inputs are processed in parallel.
+ * Welded vertices are numbered in order of first appearance, which makes the
+ * result independent of the number of threads.
+ * @param corners The face corners, three per triangle.
+ * @param remap For every corner, the index of its welded vertex.
+ * @param firsts For every welded vertex, the first corner that references it.
+ * @return The number of welded vertices.
+ */
+size_t WeldCorners(const std::vector<tinyobj::index_t> &corners,
+                   std::vector<int> *remap, std::vector<int> *firsts);
+
+/**
+ * @brief WeldPositions Same as WeldCorners for a triangle soup, where corners
+ * are welded when their positions are bitwise equal (with -0 equal to +0).
+ * @param positions Three coordinates per corner.
+ * @param remap For every corner, the index of its welded vertex.
+ * @param firsts For every welded vertex, the first corner that references it.
+ * @return The number of welded vertices.
+ */
+size_t WeldPositions(const std::vector<float> &positions,
+                     std::vector<int> *remap, std::vector<int> *firsts);
+
+/**
+ * @brief WeldVertices Merges the vertices of mesh with the same position (see
+ * WeldPositions) and points the faces to the merged ones. A merged vertex
+ * keeps the other attributes of the first vertex it replaces, so seams in the
+ * normals or texture coordinates are lost and the normals should be
+ * recomputed.
+ * @param mesh The mesh to weld. unweldedVertices_ is set if it was 0.
+ * @return The number of vertices removed.
+ */
+size_t WeldVertices(TriangleMesh *mesh);
+
+/**
+ * @brief GatherVertices Keeps the vertices of mesh listed in firsts, in that
+ * order, in every per-vertex array: positions, normals, texture coordinates,
+ * colors and quality. Empty arrays are left empty. The faces are not changed.
+ * @param firsts For every new vertex, the index of the vertex it copies.
+ * @param mesh The mesh whose vertices are gathered.
+ */
+void GatherVertices(const std::vector<int> &firsts, TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // MESH_WELD_H_
@@ -0,0 +1,387 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <obj_parser.h>
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "./float_parser.h"
+#include "./mapped_file.h"
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Chunks smaller than this are not worth a thread.
+const size_t kMinChunkBytes = 1 << 20;
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Parses the next real of the line, 0 if there is none. Uses the same parser
+// as tiny_obj_loader.h, so both loaders produce bit identical values.
+float ParseReal(const char **token, const char *end) {
+  const char *p = *token;
+  while (p < end && IsSpace(*p)) ++p;
+  float value = 0.0f;
+  const char *token_end = ParseFloat(p, end, &value);
+  if (token_end == nullptr) token_end = p;
+  while (token_end < end && !IsSpace(*token_end) && *token_end != '\r')
+    ++token_end;
+  *token = token_end;
+  return value;
+}
+
+// atoi restricted to [p, end).
+int ParseInt(const char *p, const char *end) {
+  while (p < end && IsSpace(*p)) ++p;
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+  int value = 0;
+  while (p < end && IsDigit(*p)) value = value * 10 + (*p++ - '0');
+  return negative ? -value : value;
+}
+
+// Moves p to the next '/', blank or '\r' of the line.
+const char *SkipIndex(const char *p, const char *end) {
+  while (p < end && *p != '/' && !IsSpace(*p) && *p != '\r') ++p;
+  return p;
+}
+
+/**
+ * Records parsed from one chunk. Face corners hold (v, vt, vn) triples with
+ * -1 for missing indices, and face_sizes the number of corners of every face.
+ * face_materials holds, for every face, the index into usemtl of its material,
+ * or -1 for the one active when the chunk started. Negative indices are kept
+ * relative to the chunk, and listed in relative, until its offsets are known.
+ */
+struct ObjChunk {
+  std::vector<float> vertices;
+  std::vector<float> normals;
+  std::vector<float> texcoords;
+  std::vector<int> corners;
+  std::vector<unsigned char> face_sizes;
+  std::vector<int> face_materials;
+  std::vector<std::string> usemtl;
+  std::vector<size_t> relative;
+  std::vector<std::string> mtllibs;
+  size_t degenerate_faces;
+  bool has_polygons;
+  bool failed;
+
+  ObjChunk()
+      : degenerate_faces(0), has_polygons(false), failed(false) {}
+};
+
+// Resolves an index like tinyobj's fixIndex. count is the number of records
+// of that kind parsed so far in the chunk.
+bool FixIndex(int index, size_t count, size_t slot, ObjChunk *chunk) {
+  if (index > 0) {
+    chunk->corners[slot] = index - 1;
+    return true;
+  }
+  if (index == 0) return false;
+  chunk->corners[slot] = static_cast<int>(count) + index;
+  chunk->relative.push_back(slot);
+  return true;
+}
+
+bool ParseFace(const char *p, const char *end, ObjChunk *chunk) {
+  size_t corners = 0;
+  while (p < end && IsSpace(*p)) ++p;
+  while (p < end && *p != '\r') {
+    const size_t kSlot = chunk->corners.size();
+    chunk->corners.insert(chunk->corners.end(), {-1, -1, -1});
+
+    if (!FixIndex(ParseInt(p, end), chunk->vertices.size() / 3, kSlot, chunk))
+      return false;
+    p = SkipIndex(p, end);
+    if (p < end && *p == '/') {
+      ++p;
+      if (p < end && *p == '/') {
+        // i//k
+        ++p;
+        if (!FixIndex(ParseInt(p, end), chunk->normals.size() / 3, kSlot + 2,
+                      chunk))
+          return false;
+        p = SkipIndex(p, end);
+      } else {
+        // i/j or i/j/k
+        if (!FixIndex(ParseInt(p, end), chunk->texcoords.size() / 2,
+                      kSlot + 1, chunk))
+          return false;
+        p = SkipIndex(p, end);
+        if (p < end && *p == '/') {
+          ++p;
+          if (!FixIndex(ParseInt(p, end), chunk->normals.size() / 3,
+                        kSlot + 2, chunk))
+            return false;
+          p = SkipIndex(p, end);
+        }
+      }
+    }
+    ++corners;
+    while (p < end && (IsSpace(*p) || *p == '\r')) ++p;
+  }
+
+  if (corners < 3) {
+    // Dropped, like tinyobj does.
+    chunk->corners.resize(chunk->corners.size() - corners * 3);
+    while (!chunk->relative.empty() &&
+           chunk->relative.back() >= chunk->corners.size())
+      chunk->relative.pop_back();
+    ++chunk->degenerate_faces;
+    return true;
+  }
+  // tinyobj stores face sizes in a byte.
+  if (corners > 255) return false;
+  if (corners != 3) chunk->has_polygons = true;
+  chunk->face_sizes.push_back(static_cast<unsigned char>(corners));
+  chunk->face_materials.push_back(static_cast<int>(chunk->usemtl.size()) - 1);
+  return true;
+}
+
+void ParseChunk(const char *p, const char *end, ObjChunk *chunk) {
+  while (p < end) {
+    const char *line_end =
+        static_cast<const char *>(memchr(p, '\n', end - p));
+    if (line_end == nullptr) line_end = end;
+
+    const char *token = p;
+    p = line_end + 1;
+    while (token < line_end && IsSpace(*token)) ++token;
+    if (line_end - token < 2 || *token == '#') continue;
+
+    if (token[0] == 'v' && IsSpace(token[1])) {
+      token += 2;
+      for (int k = 0; k < 3; ++k)
+        chunk->vertices.push_back(ParseReal(&token, line_end));
+    } else if (token[0] == 'v' && token[1] == 'n' &&
+               line_end - token > 2 && IsSpace(token[2])) {
+      token += 3;
+      for (int k = 0; k < 3; ++k)
+        chunk->normals.push_back(ParseReal(&token, line_end));
+    } else if (token[0] == 'v' && token[1] == 't' &&
+               line_end - token > 2 && IsSpace(token[2])) {
+      token += 3;
+      for (int k = 0; k < 2; ++k)
+        chunk->texcoords.push_back(ParseReal(&token, line_end));
+    } else if (token[0] == 'f' && IsSpace(token[1])) {
+      if (!ParseFace(token + 2, line_end, chunk)) {
+        chunk->failed = true;
+        return;
+      }
+    } else if (line_end - token > 7 && strncmp(token, "mtllib", 6) == 0 &&
+               IsSpace(token[6])) {
+      const char *name_end = line_end;
+      if (name_end > token && name_end[-1] == '\r') --name_end;
+      chunk->mtllibs.push_back(std::string(token + 7, name_end));
+    } else if (line_end - token > 7 && strncmp(token, "usemtl", 6) == 0 &&
+               IsSpace(token[6])) {
+      const char *name = token + 7;
+      while (name < line_end && IsSpace(*name)) ++name;
+      const char *name_end = name;
+      while (name_end < line_end && !IsSpace(*name_end) && *name_end != '\r')
+        ++name_end;
+      chunk->usemtl.push_back(std::string(name, name_end));
+    }
+  }
+}
+
+void LoadMaterialLibraries(const std::vector<ObjChunk> &chunks,
+                           const std::string &mtl_basedir,
+                           std::vector<tinyobj::material_t> *materials,
+                           std::map<std::string, int> *material_map,
+                           std::string *warn, std::string *err) {
+  tinyobj::MaterialFileReader reader(mtl_basedir);
+  std::set<std::string> loaded;
+
+  for (const ObjChunk &chunk : chunks) {
+    for (const std::string &line : chunk.mtllibs) {
+      std::istringstream names(line);
+      std::string name;
+      bool found = false;
+      // The first library of the line that can be read is used, with the
+      // same rules as tinyobj::LoadObj.
+      while (names >> name) {
+        if (loaded.count(name) > 0) {
+          found = true;
+          continue;
+        }
+        std::string warn_mtl, err_mtl;
+        const bool kRead =
+            reader(name, materials, material_map, &warn_mtl, &err_mtl);
+        *warn += warn_mtl;
+        *err += err_mtl;
+        if (kRead) {
+          found = true;
+          loaded.insert(name);
+          break;
+        }
+      }
+      if (!found)
+        *warn += "Failed to load material file(s). Use default material.\n";
+    }
+  }
+}
+
+}  // namespace
+
+bool LoadObjParallel(const std::string &filename,
+                     const std::string &mtl_basedir,
+                     tinyobj::attrib_t *attrib,
+                     std::vector<tinyobj::shape_t> *shapes,
+                     std::vector<tinyobj::material_t> *materials,
+                     std::string *warn, std::string *err, bool *has_polygons) {
+  *has_polygons = false;
+
+  MappedFile file;
+  if (!file.Open(filename)) {
+    *err += "Cannot open file [" + filename + "]\n";
+    return false;
+  }
+  const char *data = file.data();
+  const size_t kSize = file.size();
+
+  // Every chunk parses the lines that start inside its byte range.
+  std::vector<ObjChunk> chunks(RangeCount(kSize, kMinChunkBytes));
+  ParallelFor(kSize, kMinChunkBytes,
+              [&](size_t range, size_t first, size_t last) {
+                const char *begin = data + first;
+                if (first > 0 && data[first - 1] != '\n') {
+                  const char *newline = static_cast<const char *>(
+                      memchr(begin, '\n', kSize - first));
+                  begin = newline != nullptr ? newline + 1 : data + kSize;
+                }
+                const char *end = data + last;
+                if (end < data + kSize && end > data && end[-1] != '\n') {
+                  const char *newline = static_cast<const char *>(
+                      memchr(end, '\n', data + kSize - end));
+                  end = newline != nullptr ? newline + 1 : data + kSize;
+                }
+                if (begin < end) ParseChunk(begin, end, &chunks[range]);
+              });
+  file.Close();
+
+  size_t vertices = 0, normals = 0, texcoords = 0, corners = 0, faces = 0;
+  std::vector<size_t> vertex_offsets, normal_offsets, texcoord_offsets,
+      corner_offsets, face_offsets;
+  for (const ObjChunk &chunk : chunks) {
+    if (chunk.failed) {
+      *err += "Failed parse `f' line(e.g. zero value for face index.)\n";
+      return false;
+    }
+    for (size_t i = 0; i < chunk.degenerate_faces; ++i)
+      *warn += "Degenerated face found\n.";
+    *has_polygons |= chunk.has_polygons;
+
+    vertex_offsets.push_back(vertices);
+    normal_offsets.push_back(normals);
+    texcoord_offsets.push_back(texcoords);
+    corner_offsets.push_back(corners);
+    face_offsets.push_back(faces);
+    vertices += chunk.vertices.size();
+    normals += chunk.normals.size();
+    texcoords += chunk.texcoords.size();
+    corners += chunk.corners.size() / 3;
+    faces += chunk.face_sizes.size();
+  }
+
+  attrib->vertices.resize(vertices);
+  attrib->normals.resize(normals);
+  attrib->texcoords.resize(texcoords);
+  attrib->colors.clear();
+  shapes->assign(1, tinyobj::shape_t());
+  tinyobj::mesh_t &mesh = shapes->front().mesh;
+  mesh.indices.resize(corners);
+  mesh.num_face_vertices.resize(faces);
+  mesh.material_ids.assign(faces, -1);
+  mesh.smoothing_group_ids.assign(faces, 0);
+
+  const int kCounts[3] = {static_cast<int>(vertices / 3),
+                          static_cast<int>(texcoords / 2),
+                          static_cast<int>(normals / 3)};
+  std::vector<char> valid(chunks.size(), 1);
+  ParallelFor(chunks.size(), 1, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      ObjChunk &chunk = chunks[c];
+      std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+                attrib->vertices.begin() + vertex_offsets[c]);
+      std::copy(chunk.normals.begin(), chunk.normals.end(),
+                attrib->normals.begin() + normal_offsets[c]);
+      std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+                attrib->texcoords.begin() + texcoord_offsets[c]);
+      std::copy(chunk.face_sizes.begin(), chunk.face_sizes.end(),
+                mesh.num_face_vertices.begin() + face_offsets[c]);
+
+      const int kOffsets[3] = {static_cast<int>(vertex_offsets[c] / 3),
+                               static_cast<int>(texcoord_offsets[c] / 2),
+                               static_cast<int>(normal_offsets[c] / 3)};
+      for (size_t slot : chunk.relative)
+        chunk.corners[slot] += kOffsets[slot % 3];
+
+      const size_t kCorners = chunk.corners.size() / 3;
+      for (size_t i = 0; i < kCorners; ++i) {
+        const int *corner = &chunk.corners[i * 3];
+        // Only the position index is mandatory.
+        if (corner[0] < 0 || corner[0] >= kCounts[0] || corner[1] < -1 ||
+            corner[1] >= kCounts[1] || corner[2] < -1 ||
+            corner[2] >= kCounts[2]) {
+          valid[c] = 0;
+          break;
+        }
+        tinyobj::index_t &index = mesh.indices[corner_offsets[c] + i];
+        index.vertex_index = corner[0];
+        index.texcoord_index = corner[1];
+        index.normal_index = corner[2];
+      }
+    }
+  });
+
+  for (char chunk_valid : valid) {
+    if (!chunk_valid) {
+      *err += "Face with invalid vertex index found.\n";
+      return false;
+    }
+  }
+
+  std::map<std::string, int> material_map;
+  LoadMaterialLibraries(chunks, mtl_basedir, materials, &material_map, warn,
+                        err);
+
+  // A chunk starts with the material the previous one ended with, so the
+  // names are resolved in file order and the faces are then tagged in
+  // parallel.
+  std::vector<std::vector<int>> material_ids(chunks.size());
+  std::vector<int> start_materials(chunks.size(), -1);
+  int material = -1;
+  for (size_t c = 0; c < chunks.size(); ++c) {
+    start_materials[c] = material;
+    for (const std::string &name : chunks[c].usemtl) {
+      const auto kFound = material_map.find(name);
+      if (kFound == material_map.end()) {
+        *warn += "material [ '" + name + "' ] not found in .mtl\n";
+        material = -1;
+      } else {
+        material = kFound->second;
+      }
+      material_ids[c].push_back(material);
+    }
+  }
+  ParallelFor(chunks.size(), 1, [&](size_t, size_t first, size_t last) {
+    for (size_t c = first; c < last; ++c) {
+      const std::vector<int> &kFaceMaterials = chunks[c].face_materials;
+      for (size_t i = 0; i < kFaceMaterials.size(); ++i) {
+        mesh.material_ids[face_offsets[c] + i] =
+            kFaceMaterials[i] < 0 ? start_materials[c]
+                                  : material_ids[c][kFaceMaterials[i]];
+      }
+    }
+  });
+  return true;
+}
+
+}  // namespace data_representation
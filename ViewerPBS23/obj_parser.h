@@ -0,0 +1,41 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef OBJ_PARSER_H_
+#define OBJ_PARSER_H_
+
+#include <string>
+#include <vector>
+
+#include "./tiny_obj_loader.h"
+
+namespace data_representation {
+
+/**
+ * @brief LoadObjParallel Multi-threaded replacement for tinyobj::LoadObj. The
+ * file is split into newline aligned chunks whose v, vn, vt and f records are
+ * parsed concurrently and then merged, in file order, into attrib and a single
+ * shape. Material libraries are read with tinyobj and usemtl records set the
+ * material_ids of the faces that follow them. Lines the viewer does not use
+ * (groups, lines, points, ...) are ignored.
+ * @param filename The path to the OBJ file.
+ * @param mtl_basedir Directory where the material libraries are searched.
+ * @param attrib The resulting vertex attributes.
+ * @param shapes The resulting faces, all of them in one shape.
+ * @param materials The materials of the referenced material libraries.
+ * @param warn Warning messages.
+ * @param err Error messages.
+ * @param has_polygons Set when the file has faces other than triangles, which
+ * are returned as they are, with their sizes in num_face_vertices, for the
+ * caller to triangulate.
+ * @return Whether it was able to parse the file.
+ */
+bool LoadObjParallel(const std::string &filename,
+                     const std::string &mtl_basedir,
+                     tinyobj::attrib_t *attrib,
+                     std::vector<tinyobj::shape_t> *shapes,
+                     std::vector<tinyobj::material_t> *materials,
+                     std::string *warn, std::string *err, bool *has_polygons);
+
+}  // namespace data_representation
+
+#endif  // OBJ_PARSER_H_
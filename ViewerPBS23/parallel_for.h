@@ -0,0 +1,59 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief ThreadCount Number of hardware threads, at least one.
+ */
+inline size_t ThreadCount() {
+  const size_t kThreads = std::thread::hardware_concurrency();
+  return kThreads > 0 ? kThreads : 1;
+}
+
+/**
+ * @brief RangeCount Number of ranges ParallelFor splits size items into, so
+ * callers can allocate one output slot per range beforehand.
+ * @param size Number of items.
+ * @param min_range Minimum number of items worth a thread of its own.
+ */
+inline size_t RangeCount(size_t size, size_t min_range) {
+  const size_t kRanges = size / std::max<size_t>(min_range, 1);
+  return std::max<size_t>(1, std::min(kRanges, ThreadCount()));
+}
+
+/**
+ * @brief ParallelFor Splits [0, size) into RangeCount(size, min_range)
+ * contiguous ranges of (almost) the same length and calls
+ * function(range, first, last) for each of them on its own thread. Ranges are
+ * numbered in increasing order of first, so per-range results can be merged
+ * deterministically. Returns when every range is done.
+ */
+template <typename Function>
+void ParallelFor(size_t size, size_t min_range, Function function) {
+  const size_t kRanges = RangeCount(size, min_range);
+  if (kRanges == 1) {
+    function(size_t(0), size_t(0), size);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(kRanges - 1);
+  for (size_t r = 1; r < kRanges; ++r) {
+    threads.emplace_back(function, r, size * r / kRanges,
+                         size * (r + 1) / kRanges);
+  }
+  function(size_t(0), size_t(0), size / kRanges);
+  for (std::thread &thread : threads) thread.join();
+}
+
+}  // namespace data_representation
+
+#endif  // PARALLEL_FOR_H_
@@ -0,0 +1,789 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <ply_format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#include "./float_parser.h"
+#include "./mesh_triangulate.h"
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+PlyType ParseType(const std::string &name) {
+  if (name == "char" || name == "int8") return PlyType::kInt8;
+  if (name == "uchar" || name == "uint8") return PlyType::kUInt8;
+  if (name == "short" || name == "int16") return PlyType::kInt16;
+  if (name == "ushort" || name == "uint16") return PlyType::kUInt16;
+  if (name == "int" || name == "int32") return PlyType::kInt32;
+  if (name == "uint" || name == "uint32") return PlyType::kUInt32;
+  if (name == "float" || name == "float32") return PlyType::kFloat32;
+  if (name == "double" || name == "float64") return PlyType::kFloat64;
+  return PlyType::kInvalid;
+}
+
+bool IsIntegral(PlyType type) {
+  return type != PlyType::kFloat32 && type != PlyType::kFloat64 &&
+         type != PlyType::kInvalid;
+}
+
+// Returns the line starting at *cursor (without the line break) and moves the
+// cursor to the beginning of the next line.
+std::string NextLine(const char *end, const char **cursor) {
+  const char *begin = *cursor;
+  const char *newline =
+      static_cast<const char *>(memchr(begin, '\n', end - begin));
+  const char *line_end = newline != nullptr ? newline : end;
+  *cursor = newline != nullptr ? newline + 1 : end;
+  if (line_end > begin && line_end[-1] == '\r') --line_end;
+  return std::string(begin, line_end);
+}
+
+// Loads a binary scalar, reversing its bytes when kSwap is set. Compilers
+// turn the reversal loop into a single bswap.
+template <typename T, bool kSwap>
+inline T LoadScalar(const char *p) {
+  T value;
+  if (kSwap) {
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = p[sizeof(T) - 1 - i];
+    memcpy(&value, bytes, sizeof(T));
+  } else {
+    memcpy(&value, p, sizeof(T));
+  }
+  return value;
+}
+
+template <bool kSwap>
+double LoadValue(PlyType type, const char *p) {
+  switch (type) {
+    case PlyType::kInt8: return LoadScalar<int8_t, kSwap>(p);
+    case PlyType::kUInt8: return LoadScalar<uint8_t, kSwap>(p);
+    case PlyType::kInt16: return LoadScalar<int16_t, kSwap>(p);
+    case PlyType::kUInt16: return LoadScalar<uint16_t, kSwap>(p);
+    case PlyType::kInt32: return LoadScalar<int32_t, kSwap>(p);
+    case PlyType::kUInt32: return LoadScalar<uint32_t, kSwap>(p);
+    case PlyType::kFloat32: return LoadScalar<float, kSwap>(p);
+    case PlyType::kFloat64: return LoadScalar<double, kSwap>(p);
+    default: return 0.0;
+  }
+}
+
+// Colors are stored as bytes: integer channels wider than a byte are scaled
+// down from 16 bits, real channels from [0, 1].
+uint8_t ColorChannel(double value, bool is_real, size_t size) {
+  if (is_real)
+    value *= 255.0;
+  else if (size > 1)
+    value /= 257.0;
+  return static_cast<uint8_t>(std::min(std::max(value + 0.5, 0.0), 255.0));
+}
+
+// Conversion of a loaded scalar to the type of its destination array; bytes
+// are only used for colors.
+template <typename Dst>
+struct Convert {
+  template <typename Src>
+  static Dst From(Src value) {
+    return static_cast<Dst>(value);
+  }
+};
+
+template <>
+struct Convert<uint8_t> {
+  template <typename Src>
+  static uint8_t From(Src value) {
+    return ColorChannel(static_cast<double>(value),
+                        std::is_floating_point<Src>::value, sizeof(Src));
+  }
+};
+
+template <typename Src, bool kSwap, typename Dst>
+void DecodeColumns(const char *src, size_t src_stride, size_t count,
+                   size_t width, void *dst_data, size_t dst_stride) {
+  Dst *dst = static_cast<Dst *>(dst_data);
+  if (std::is_same<Src, Dst>::value && !kSwap &&
+      src_stride == width * sizeof(Src) && dst_stride == width) {
+    // The block already has the layout of the destination array.
+    memcpy(dst, src, count * src_stride);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t k = 0; k < width; ++k)
+      dst[k] =
+          Convert<Dst>::From(LoadScalar<Src, kSwap>(src + k * sizeof(Src)));
+    src += src_stride;
+    dst += dst_stride;
+  }
+}
+
+template <bool kSwap, typename Dst>
+PlyMeshDecoder::ColumnKernel SelectColumnKernel(PlyType type) {
+  switch (type) {
+    case PlyType::kInt8: return &DecodeColumns<int8_t, kSwap, Dst>;
+    case PlyType::kUInt8: return &DecodeColumns<uint8_t, kSwap, Dst>;
+    case PlyType::kInt16: return &DecodeColumns<int16_t, kSwap, Dst>;
+    case PlyType::kUInt16: return &DecodeColumns<uint16_t, kSwap, Dst>;
+    case PlyType::kInt32: return &DecodeColumns<int32_t, kSwap, Dst>;
+    case PlyType::kUInt32: return &DecodeColumns<uint32_t, kSwap, Dst>;
+    case PlyType::kFloat32: return &DecodeColumns<float, kSwap, Dst>;
+    case PlyType::kFloat64: return &DecodeColumns<double, kSwap, Dst>;
+    default: return nullptr;
+  }
+}
+
+template <typename Count, typename Index, bool kSwap>
+const char *DecodeTriangles(const char *src, const char *end, size_t count,
+                            size_t prefix_bytes, size_t suffix_bytes,
+                            int *dst) {
+  const size_t kRecordBytes =
+      prefix_bytes + sizeof(Count) + 3 * sizeof(Index) + suffix_bytes;
+  if (count > static_cast<size_t>(end - src) / kRecordBytes) return nullptr;
+
+  // Every record is a triangle, so the records are fixed size after all.
+  for (size_t i = 0; i < count; ++i) {
+    const char *record = src + prefix_bytes;
+    if (LoadScalar<Count, kSwap>(record) != 3) return nullptr;
+    record += sizeof(Count);
+    for (size_t k = 0; k < 3; ++k)
+      dst[k] = static_cast<int>(
+          LoadScalar<Index, kSwap>(record + k * sizeof(Index)));
+    src += kRecordBytes;
+    dst += 3;
+  }
+  return src;
+}
+
+template <typename Count, bool kSwap>
+PlyMeshDecoder::TriangleKernel SelectTriangleKernel(PlyType index_type) {
+  switch (index_type) {
+    case PlyType::kInt8: return &DecodeTriangles<Count, int8_t, kSwap>;
+    case PlyType::kUInt8: return &DecodeTriangles<Count, uint8_t, kSwap>;
+    case PlyType::kInt16: return &DecodeTriangles<Count, int16_t, kSwap>;
+    case PlyType::kUInt16: return &DecodeTriangles<Count, uint16_t, kSwap>;
+    case PlyType::kInt32: return &DecodeTriangles<Count, int32_t, kSwap>;
+    case PlyType::kUInt32: return &DecodeTriangles<Count, uint32_t, kSwap>;
+    default: return nullptr;
+  }
+}
+
+template <bool kSwap>
+PlyMeshDecoder::TriangleKernel SelectTriangleKernel(PlyType count_type,
+                                                    PlyType index_type) {
+  switch (count_type) {
+    case PlyType::kInt8: return SelectTriangleKernel<int8_t, kSwap>(index_type);
+    case PlyType::kUInt8:
+      return SelectTriangleKernel<uint8_t, kSwap>(index_type);
+    case PlyType::kInt16:
+      return SelectTriangleKernel<int16_t, kSwap>(index_type);
+    case PlyType::kUInt16:
+      return SelectTriangleKernel<uint16_t, kSwap>(index_type);
+    case PlyType::kInt32:
+      return SelectTriangleKernel<int32_t, kSwap>(index_type);
+    case PlyType::kUInt32:
+      return SelectTriangleKernel<uint32_t, kSwap>(index_type);
+    default: return nullptr;
+  }
+}
+
+PlyMeshDecoder::Binding BindVertexProperty(const std::string &name) {
+  static const char *kPosition[] = {"x", "y", "z"};
+  static const char *kNormal[] = {"nx", "ny", "nz"};
+  static const char *kTexCoord[][2] = {
+      {"s", "t"}, {"u", "v"}, {"texture_u", "texture_v"},
+      {"texture_s", "texture_t"}};
+  static const char *kColor[][4] = {
+      {"red", "green", "blue", "alpha"},
+      {"r", "g", "b", "a"},
+      {"diffuse_red", "diffuse_green", "diffuse_blue", "diffuse_alpha"}};
+
+  for (size_t k = 0; k < 3; ++k) {
+    if (name == kPosition[k]) return {PlyMeshDecoder::kPosition, k};
+    if (name == kNormal[k]) return {PlyMeshDecoder::kNormal, k};
+  }
+  for (const auto &names : kTexCoord)
+    for (size_t k = 0; k < 2; ++k)
+      if (name == names[k]) return {PlyMeshDecoder::kTexCoord, k};
+  for (const auto &names : kColor)
+    for (size_t k = 0; k < 4; ++k)
+      if (name == names[k]) return {PlyMeshDecoder::kColor, k};
+  if (name == "quality" || name == "confidence")
+    return {PlyMeshDecoder::kQuality, 0};
+  return {PlyMeshDecoder::kSkip, 0};
+}
+
+size_t TargetStride(PlyMeshDecoder::Target target) {
+  switch (target) {
+    case PlyMeshDecoder::kTexCoord: return 2;
+    case PlyMeshDecoder::kColor: return 4;
+    case PlyMeshDecoder::kQuality: return 1;
+    default: return 3;
+  }
+}
+
+// Address of the item of record and component in the array of target.
+void *TargetItem(PlyMeshDecoder::Target target, size_t record,
+                 size_t component, TriangleMesh *mesh) {
+  const size_t kItem = record * TargetStride(target) + component;
+  switch (target) {
+    case PlyMeshDecoder::kPosition: return mesh->vertices_.data() + kItem;
+    case PlyMeshDecoder::kNormal: return mesh->normals_.data() + kItem;
+    case PlyMeshDecoder::kTexCoord: return mesh->texCoords_.data() + kItem;
+    case PlyMeshDecoder::kColor: return mesh->colors_.data() + kItem;
+    case PlyMeshDecoder::kQuality: return mesh->quality_.data() + kItem;
+    default: return nullptr;
+  }
+}
+
+// Stores a value of the given type decoded by the generic (property by
+// property) paths.
+void Store(const PlyMeshDecoder::Binding &binding, size_t record, double value,
+           PlyType type, TriangleMesh *mesh) {
+  if (binding.target == PlyMeshDecoder::kSkip ||
+      binding.target == PlyMeshDecoder::kIndex)
+    return;
+  void *item = TargetItem(binding.target, record, binding.component, mesh);
+  if (binding.target == PlyMeshDecoder::kColor) {
+    *static_cast<uint8_t *>(item) =
+        ColorChannel(value, !IsIntegral(type), PlyTypeSize(type));
+  } else {
+    *static_cast<float *>(item) = static_cast<float>(value);
+  }
+}
+
+// Allocates the vertex arrays of mesh that the decoder fills. Colors without
+// alpha are opaque.
+void ResizeVertexArrays(size_t vertices, bool normals, bool tex_coords,
+                        bool colors, bool quality, TriangleMesh *mesh) {
+  mesh->vertices_.resize(vertices * 3);
+  mesh->normals_.resize(normals ? vertices * 3 : 0);
+  mesh->texCoords_.resize(tex_coords ? vertices * 2 : 0);
+  mesh->colors_.assign(colors ? vertices * 4 : 0, 255);
+  mesh->quality_.resize(quality ? vertices : 0);
+}
+
+// Fewest bytes a record of element can take in format: every ascii value
+// takes at least one character, and binary lists at least their count.
+size_t MinRecordSize(const PlyElement &element, PlyFormat format) {
+  size_t size = 0;
+  for (const PlyProperty &property : element.properties) {
+    if (format == PlyFormat::kAscii)
+      size += 1;
+    else
+      size += PlyTypeSize(property.is_list ? property.count_type
+                                           : property.type);
+  }
+  return size;
+}
+
+// Whether the elements of header fit in the size bytes after the header. The
+// counts are compared by division, so that crafted ones cannot wrap the
+// sizes computed from them.
+bool FitsInData(const PlyHeader &header, size_t size) {
+  size_t remaining = size - header.data_offset;
+  for (const PlyElement &element : header.elements) {
+    const size_t kRecordSize = MinRecordSize(element, header.format);
+    if (element.count > remaining / std::max<size_t>(kRecordSize, 1))
+      return false;
+    remaining -= element.count * kRecordSize;
+  }
+  return true;
+}
+
+// Reads the next whitespace separated number of an ascii body.
+bool NextNumber(const char *end, const char **cursor, double *value) {
+  const char *p = *cursor;
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+  const char *token = p;
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+
+  char buffer[64];
+  const size_t kLength = static_cast<size_t>(p - token);
+  if (kLength == 0 || kLength >= sizeof(buffer)) return false;
+  memcpy(buffer, token, kLength);
+  buffer[kLength] = '\0';
+
+  // In the "C" locale: PLY files always use '.' as the decimal separator.
+  char *parsed_end;
+  *value = ParseDouble(buffer, &parsed_end);
+  *cursor = p;
+  return parsed_end == buffer + kLength;
+}
+
+}  // namespace
+
+size_t PlyTypeSize(PlyType type) {
+  switch (type) {
+    case PlyType::kInt8:
+    case PlyType::kUInt8: return 1;
+    case PlyType::kInt16:
+    case PlyType::kUInt16: return 2;
+    case PlyType::kInt32:
+    case PlyType::kUInt32:
+    case PlyType::kFloat32: return 4;
+    case PlyType::kFloat64: return 8;
+    default: return 0;
+  }
+}
+
+int PlyElement::Find(const std::string &property) const {
+  for (size_t i = 0; i < properties.size(); ++i)
+    if (properties[i].name == property) return static_cast<int>(i);
+  return -1;
+}
+
+size_t PlyElement::RecordSize() const {
+  size_t size = 0;
+  for (const PlyProperty &property : properties) {
+    if (property.is_list) return 0;
+    size += PlyTypeSize(property.type);
+  }
+  return size;
+}
+
+const PlyElement *PlyHeader::Find(const std::string &name) const {
+  for (const PlyElement &element : elements)
+    if (element.name == name) return &element;
+  return nullptr;
+}
+
+bool ReadPlyHeader(const char *data, size_t size, PlyHeader *header) {
+  const char *cursor = data;
+  const char *end = data + size;
+
+  if (NextLine(end, &cursor) != "ply") return false;
+
+  header->elements.clear();
+  bool has_format = false;
+  while (cursor < end) {
+    std::istringstream line(NextLine(end, &cursor));
+    std::string keyword;
+    line >> keyword;
+
+    if (keyword == "end_header") {
+      header->data_offset = static_cast<size_t>(cursor - data);
+      if (has_format && !FitsInData(*header, size)) {
+        std::cerr << "The PLY element counts exceed the file size."
+                  << std::endl;
+        return false;
+      }
+      return has_format;
+    } else if (keyword == "format") {
+      std::string format;
+      line >> format;
+      if (format == "ascii") {
+        header->format = PlyFormat::kAscii;
+      } else if (format == "binary_little_endian") {
+        header->format = PlyFormat::kBinaryLittleEndian;
+      } else if (format == "binary_big_endian") {
+        header->format = PlyFormat::kBinaryBigEndian;
+      } else {
+        std::cerr << "Unknown PLY format " << format << std::endl;
+        return false;
+      }
+      has_format = true;
+    } else if (keyword == "element") {
+      PlyElement element;
+      long long count = -1;
+      line >> element.name >> count;
+      if (!line || count < 0) return false;
+      element.count = static_cast<size_t>(count);
+      header->elements.push_back(element);
+    } else if (keyword == "property") {
+      if (header->elements.empty()) return false;
+      PlyProperty property;
+      std::string type;
+      line >> type;
+      property.is_list = type == "list";
+      if (property.is_list) {
+        std::string count_type;
+        line >> count_type >> type;
+        property.count_type = ParseType(count_type);
+        if (!IsIntegral(property.count_type)) return false;
+      } else {
+        property.count_type = PlyType::kInvalid;
+      }
+      property.type = ParseType(type);
+      line >> property.name;
+      if (!line || property.type == PlyType::kInvalid) {
+        std::cerr << "Unsupported PLY property " << type << std::endl;
+        return false;
+      }
+      header->elements.back().properties.push_back(property);
+    }
+    // comment and obj_info lines carry no schema.
+  }
+
+  return false;
+}
+
+PlyMeshDecoder::PlyMeshDecoder()
+    : vertices_(0),
+      faces_(0),
+      has_normals_(false),
+      has_tex_coords_(false),
+      has_colors_(false),
+      has_quality_(false) {}
+
+bool PlyMeshDecoder::Compile(const PlyHeader &header) {
+  header_ = header;
+  plans_.clear();
+  vertices_ = faces_ = 0;
+
+  const bool kSwap = header.format == PlyFormat::kBinaryBigEndian;
+  int bound[kTargets] = {0};
+
+  for (size_t e = 0; e < header_.elements.size(); ++e) {
+    const PlyElement &element = header_.elements[e];
+    const bool kIsVertex = element.name == "vertex";
+    const bool kIsFace = element.name == "face";
+    if (kIsVertex) vertices_ = element.count;
+    if (kIsFace) faces_ = element.count;
+
+    ElementPlan plan;
+    plan.element = e;
+    plan.record_size = element.RecordSize();
+    plan.triangles = nullptr;
+    plan.prefix_bytes = plan.suffix_bytes = 0;
+
+    size_t lists = 0;
+    for (const PlyProperty &property : element.properties) {
+      Binding binding = {kSkip, 0};
+      if (kIsVertex && !property.is_list) {
+        binding = BindVertexProperty(property.name);
+      } else if (kIsFace && property.is_list && IsIntegral(property.type) &&
+                 (property.name == "vertex_indices" ||
+                  property.name == "vertex_index")) {
+        binding = {kIndex, 0};
+      }
+      if (binding.target != kSkip) bound[binding.target] |= 1 << binding.component;
+      lists += property.is_list ? 1 : 0;
+      plan.bindings.push_back(binding);
+    }
+
+    if (header.format == PlyFormat::kAscii) {
+      plans_.push_back(plan);
+      continue;
+    }
+
+    // Fixed size records: merge consecutive properties of the same type that
+    // land in consecutive items of the same array into one column.
+    size_t offset = 0;
+    for (size_t i = 0; plan.record_size > 0 && i < element.properties.size();
+         ++i) {
+      const PlyProperty &property = element.properties[i];
+      const Binding &binding = plan.bindings[i];
+      const size_t kSize = PlyTypeSize(property.type);
+      if (binding.target != kSkip) {
+        Column *last = plan.columns.empty() ? nullptr : &plan.columns.back();
+        if (last != nullptr && last->binding.target == binding.target &&
+            last->binding.component + last->width == binding.component &&
+            last->offset + last->width * kSize == offset &&
+            element.properties[i - 1].type == property.type) {
+          ++last->width;
+        } else {
+          ColumnKernel kernel;
+          if (binding.target == kColor) {
+            kernel = kSwap ? SelectColumnKernel<true, uint8_t>(property.type)
+                           : SelectColumnKernel<false, uint8_t>(property.type);
+          } else {
+            kernel = kSwap ? SelectColumnKernel<true, float>(property.type)
+                           : SelectColumnKernel<false, float>(property.type);
+          }
+          plan.columns.push_back({offset, 1, binding, kernel});
+        }
+      }
+      offset += kSize;
+    }
+
+    // Face records with a single list: the list is the only variable part.
+    if (plan.record_size == 0 && lists == 1) {
+      bool after_list = false;
+      for (size_t i = 0; i < element.properties.size(); ++i) {
+        const PlyProperty &property = element.properties[i];
+        if (property.is_list) {
+          if (plan.bindings[i].target == kIndex) {
+            plan.triangles =
+                kSwap ? SelectTriangleKernel<true>(property.count_type,
+                                                   property.type)
+                      : SelectTriangleKernel<false>(property.count_type,
+                                                    property.type);
+          }
+          after_list = true;
+        } else if (after_list) {
+          plan.suffix_bytes += PlyTypeSize(property.type);
+        } else {
+          plan.prefix_bytes += PlyTypeSize(property.type);
+        }
+      }
+    }
+
+    plans_.push_back(plan);
+  }
+
+  if (vertices_ == 0 || bound[kPosition] != 7) {
+    std::cerr << "The PLY file has no vertex positions." << std::endl;
+    return false;
+  }
+  if (faces_ > 0 && bound[kIndex] == 0) {
+    std::cerr << "The PLY faces have no vertex_indices list." << std::endl;
+    return false;
+  }
+  has_normals_ = bound[kNormal] == 7;
+  has_tex_coords_ = bound[kTexCoord] == 3;
+  // Alpha is optional.
+  has_colors_ = (bound[kColor] & 7) == 7;
+  has_quality_ = bound[kQuality] == 1;
+
+  // Partially present attributes are ignored rather than half decoded.
+  const auto kMissing = [this](Target target) {
+    return (target == kNormal && !has_normals_) ||
+           (target == kTexCoord && !has_tex_coords_) ||
+           (target == kColor && !has_colors_);
+  };
+  for (ElementPlan &plan : plans_) {
+    for (Binding &binding : plan.bindings) {
+      if (kMissing(binding.target)) binding.target = kSkip;
+    }
+    std::vector<Column> columns;
+    for (const Column &column : plan.columns) {
+      if (!kMissing(column.binding.target)) columns.push_back(column);
+    }
+    plan.columns.swap(columns);
+  }
+
+  return true;
+}
+
+bool PlyMeshDecoder::Decode(const char *data, size_t size,
+                            TriangleMesh *mesh) const {
+  ResizeVertexArrays(vertices_, has_normals_, has_tex_coords_, has_colors_,
+                     has_quality_, mesh);
+  mesh->faces_.clear();
+  mesh->faces_.reserve(faces_ * 3);
+
+  const char *end = data + size;
+  std::vector<int> sizes;
+  const bool kDecoded =
+      header_.format == PlyFormat::kAscii
+          ? DecodeAscii(data + header_.data_offset, end, mesh, &sizes)
+          : DecodeBinary(data + header_.data_offset, end, mesh, &sizes);
+  if (!kDecoded) return false;
+
+  for (int index : mesh->faces_) {
+    if (index < 0 || static_cast<size_t>(index) >= vertices_) {
+      std::cerr << "The PLY faces reference missing vertices." << std::endl;
+      return false;
+    }
+  }
+
+  bool polygons = false;
+  for (int face_size : sizes) polygons |= face_size != 3;
+  if (polygons) {
+    // The triangles are made of corners, which are then replaced by their
+    // vertices.
+    std::vector<int> corners;
+    corners.swap(mesh->faces_);
+    TriangulatePolygons(mesh->vertices_, corners, sizes, &mesh->faces_);
+    std::vector<int> &faces = mesh->faces_;
+    ParallelFor(faces.size(), 1 << 16, [&](size_t, size_t first,
+                                           size_t last) {
+      for (size_t i = first; i < last; ++i) faces[i] = corners[faces[i]];
+    });
+    std::cout << "Triangulated " << sizes.size() << " polygons into "
+              << faces.size() / 3 << " triangles" << std::endl;
+  }
+  return true;
+}
+
+bool PlyMeshDecoder::DecodeBinary(const char *data, const char *end,
+                                  TriangleMesh *mesh,
+                                  std::vector<int> *sizes) const {
+  const bool kSwap = header_.format == PlyFormat::kBinaryBigEndian;
+
+  for (const ElementPlan &plan : plans_) {
+    const PlyElement &element = header_.elements[plan.element];
+
+    if (plan.record_size > 0) {
+      if (element.count > static_cast<size_t>(end - data) / plan.record_size)
+        return false;
+      for (const Column &column : plan.columns) {
+        column.kernel(data + column.offset, plan.record_size, element.count,
+                      column.width,
+                      TargetItem(column.binding.target, 0,
+                                 column.binding.component, mesh),
+                      TargetStride(column.binding.target));
+      }
+      data += element.count * plan.record_size;
+      continue;
+    }
+
+    if (plan.triangles != nullptr) {
+      mesh->faces_.resize(element.count * 3);
+      const char *next =
+          plan.triangles(data, end, element.count, plan.prefix_bytes,
+                         plan.suffix_bytes, mesh->faces_.data());
+      if (next != nullptr) {
+        data = next;
+        continue;
+      }
+      // Not all triangles: decode the polygons with the generic path below.
+      mesh->faces_.clear();
+    }
+
+    // Generic path, property by property.
+    for (size_t r = 0; r < element.count; ++r) {
+      for (size_t i = 0; i < element.properties.size(); ++i) {
+        const PlyProperty &property = element.properties[i];
+        const Binding &binding = plan.bindings[i];
+        if (!property.is_list) {
+          const size_t kSize = PlyTypeSize(property.type);
+          if (static_cast<size_t>(end - data) < kSize) return false;
+          Store(binding,
+                r,
+                kSwap ? LoadValue<true>(property.type, data)
+                      : LoadValue<false>(property.type, data),
+                property.type,
+                mesh);
+          data += kSize;
+          continue;
+        }
+
+        const size_t kCountSize = PlyTypeSize(property.count_type);
+        if (static_cast<size_t>(end - data) < kCountSize) return false;
+        const double kCount = kSwap
+                                  ? LoadValue<true>(property.count_type, data)
+                                  : LoadValue<false>(property.count_type, data);
+        data += kCountSize;
+        const size_t kItems = kCount > 0 ? static_cast<size_t>(kCount) : 0;
+        const size_t kSize = PlyTypeSize(property.type);
+        if (kItems > static_cast<size_t>(end - data) / kSize) return false;
+
+        if (binding.target == kIndex) {
+          sizes->push_back(static_cast<int>(kItems));
+          for (size_t k = 0; k < kItems; ++k) {
+            mesh->faces_.push_back(static_cast<int>(
+                kSwap ? LoadValue<true>(property.type, data + k * kSize)
+                      : LoadValue<false>(property.type, data + k * kSize)));
+          }
+        }
+        data += kItems * kSize;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool PlyMeshDecoder::CanStream() const {
+  if (header_.format == PlyFormat::kAscii) return false;
+  for (const ElementPlan &plan : plans_)
+    if (plan.record_size == 0 && plan.triangles == nullptr) return false;
+  return true;
+}
+
+bool PlyMeshDecoder::DecodeChunks(const char *data, size_t size,
+                                  size_t chunk_records,
+                                  const ChunkConsumer &consume) const {
+  if (!CanStream()) return false;
+  chunk_records = std::max<size_t>(chunk_records, 1);
+
+  const char *end = data + size;
+  data += header_.data_offset;
+  TriangleMesh chunk;
+
+  for (const ElementPlan &plan : plans_) {
+    const PlyElement &element = header_.elements[plan.element];
+    const Target kTarget =
+        plan.triangles != nullptr ? kIndex
+                                  : plan.columns.empty() ? kSkip : kPosition;
+
+    if (kTarget == kSkip) {
+      if (element.count > static_cast<size_t>(end - data) / plan.record_size)
+        return false;
+      data += element.count * plan.record_size;
+      continue;
+    }
+
+    for (size_t first = 0; first < element.count; first += chunk_records) {
+      const size_t kCount = std::min(chunk_records, element.count - first);
+
+      if (kTarget == kIndex) {
+        chunk.faces_.resize(kCount * 3);
+        data = plan.triangles(data, end, kCount, plan.prefix_bytes,
+                              plan.suffix_bytes, chunk.faces_.data());
+        if (data == nullptr) {
+          std::cerr << "The PLY faces are truncated or not triangles."
+                    << std::endl;
+          return false;
+        }
+        for (int index : chunk.faces_) {
+          if (index < 0 || static_cast<size_t>(index) >= vertices_) {
+            std::cerr << "The PLY faces reference missing vertices."
+                      << std::endl;
+            return false;
+          }
+        }
+      } else {
+        if (kCount > static_cast<size_t>(end - data) / plan.record_size)
+          return false;
+        ResizeVertexArrays(kCount, has_normals_, has_tex_coords_,
+                           has_colors_, has_quality_, &chunk);
+        for (const Column &column : plan.columns) {
+          column.kernel(data + column.offset, plan.record_size, kCount,
+                        column.width,
+                        TargetItem(column.binding.target, 0,
+                                   column.binding.component, &chunk),
+                        TargetStride(column.binding.target));
+        }
+        data += kCount * plan.record_size;
+      }
+
+      if (!consume(kTarget, first, kCount, chunk)) return false;
+    }
+  }
+
+  return true;
+}
+
+bool PlyMeshDecoder::DecodeAscii(const char *data, const char *end,
+                                 TriangleMesh *mesh,
+                                 std::vector<int> *sizes) const {
+  double value;
+  for (const ElementPlan &plan : plans_) {
+    const PlyElement &element = header_.elements[plan.element];
+    for (size_t r = 0; r < element.count; ++r) {
+      for (size_t i = 0; i < element.properties.size(); ++i) {
+        const PlyProperty &property = element.properties[i];
+        const Binding &binding = plan.bindings[i];
+        if (!NextNumber(end, &data, &value)) return false;
+        if (!property.is_list) {
+          Store(binding, r, value, property.type, mesh);
+          continue;
+        }
+
+        // Every item takes at least one character.
+        if (value > static_cast<double>(end - data)) return false;
+        const size_t kItems = value > 0 ? static_cast<size_t>(value) : 0;
+        if (binding.target == kIndex) sizes->push_back(static_cast<int>(kItems));
+        for (size_t k = 0; k < kItems; ++k) {
+          if (!NextNumber(end, &data, &value)) return false;
+          if (binding.target == kIndex)
+            mesh->faces_.push_back(static_cast<int>(value));
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace data_representation
@@ -0,0 +1,251 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef PLY_FORMAT_H_
+#define PLY_FORMAT_H_
+
+#include <triangle_mesh.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief The PlyFormat enum Encoding of the data that follows the header.
+ */
+enum class PlyFormat { kAscii, kBinaryLittleEndian, kBinaryBigEndian };
+
+/**
+ * @brief The PlyType enum Scalar types of the PLY specification. Both the
+ * classic (char, ushort, ...) and the sized (int8, uint16, ...) names map to
+ * the same values.
+ */
+enum class PlyType {
+  kInvalid,
+  kInt8,
+  kUInt8,
+  kInt16,
+  kUInt16,
+  kInt32,
+  kUInt32,
+  kFloat32,
+  kFloat64
+};
+
+/**
+ * @brief PlyTypeSize Size in bytes of a binary encoded scalar.
+ */
+size_t PlyTypeSize(PlyType type);
+
+/**
+ * @brief The PlyProperty struct A scalar property, or a list property made of
+ * a count of type count_type followed by that many items of type type.
+ */
+struct PlyProperty {
+  std::string name;
+  PlyType type;
+  bool is_list;
+  PlyType count_type;
+};
+
+/**
+ * @brief The PlyElement struct An element declaration and its properties in
+ * file order.
+ */
+struct PlyElement {
+  std::string name;
+  size_t count;
+  std::vector<PlyProperty> properties;
+
+  /**
+   * @brief Find Index of the property called name, -1 if there is none.
+   */
+  int Find(const std::string &name) const;
+
+  /**
+   * @brief RecordSize Size in bytes of a binary record, or 0 when the element
+   * has list properties and its records are not fixed size.
+   */
+  size_t RecordSize() const;
+};
+
+/**
+ * @brief The PlyHeader struct Schema of a PLY file.
+ */
+struct PlyHeader {
+  PlyFormat format;
+  std::vector<PlyElement> elements;
+
+  /**
+   * @brief data_offset Offset in bytes of the first byte after end_header.
+   */
+  size_t data_offset;
+
+  /**
+   * @brief Find The element called name, nullptr if there is none.
+   */
+  const PlyElement *Find(const std::string &name) const;
+};
+
+/**
+ * @brief ReadPlyHeader Parses the PLY header at the beginning of data.
+ * @param data The file contents.
+ * @param size Size in bytes of data.
+ * @param header The resulting schema.
+ * @return Whether the header is a valid PLY header.
+ */
+bool ReadPlyHeader(const char *data, size_t size, PlyHeader *header);
+
+/**
+ * @brief The PlyMeshDecoder class Decode routine specialized for one PLY
+ * layout. Compile inspects the header once and selects, for every run of
+ * properties that ends up in a TriangleMesh array, a kernel instantiated for
+ * the exact on-disk type and byte order, so Decode never looks at the schema
+ * per vertex or per face.
+ */
+class PlyMeshDecoder {
+ public:
+  PlyMeshDecoder();
+
+  /**
+   * @brief Compile Builds the decode plan for header.
+   * @param header The schema of the file.
+   * @return Whether the layout can be decoded into a TriangleMesh.
+   */
+  bool Compile(const PlyHeader &header);
+
+  /**
+   * @brief Decode Decodes the elements that follow the header into mesh.
+   * @param data The file contents, the same ones the header was read from.
+   * @param size Size in bytes of data.
+   * @param mesh The resulting mesh. Normals, texture coordinates, colors and
+   * quality are only filled if the file has them. Faces with more than three
+   * corners are triangulated.
+   * @return Whether the data matches the schema.
+   */
+  bool Decode(const char *data, size_t size, TriangleMesh *mesh) const;
+
+  bool has_normals() const { return has_normals_; }
+  bool has_tex_coords() const { return has_tex_coords_; }
+  bool has_colors() const { return has_colors_; }
+  bool has_quality() const { return has_quality_; }
+
+  /**
+   * @brief Destination arrays of a TriangleMesh a property can be decoded to.
+   * Colors are converted to bytes by the kernels: integer channels wider than
+   * a byte are scaled down from 16 bits, real ones from [0, 1].
+   */
+  enum Target {
+    kSkip,
+    kPosition,
+    kNormal,
+    kTexCoord,
+    kColor,
+    kQuality,
+    kIndex,
+    kTargets
+  };
+
+  /**
+   * @brief Kernel that converts count records of width consecutive scalars,
+   * src_stride bytes apart, into dst with dst_stride items between records.
+   */
+  typedef void (*ColumnKernel)(const char *src, size_t src_stride,
+                               size_t count, size_t width, void *dst,
+                               size_t dst_stride);
+
+  /**
+   * @brief Kernel that decodes count binary face records with a single
+   * triangle list. Returns the end of the last record, or nullptr if a
+   * record is not a triangle or runs past end.
+   */
+  typedef const char *(*TriangleKernel)(const char *src, const char *end,
+                                        size_t count, size_t prefix_bytes,
+                                        size_t suffix_bytes, int *dst);
+
+  /**
+   * @brief Where a property ends up: the array and the item inside a record.
+   */
+  struct Binding {
+    Target target;
+    size_t component;
+  };
+
+  /**
+   * @brief A run of consecutive properties decoded by one kernel call.
+   */
+  struct Column {
+    size_t offset;
+    size_t width;
+    Binding binding;
+    ColumnKernel kernel;
+  };
+
+  /**
+   * @brief The decode plan of an element. Fixed size records are decoded
+   * with columns, face records with a single triangle list with triangles,
+   * and everything else property by property following bindings.
+   */
+  struct ElementPlan {
+    size_t element;
+    size_t record_size;
+    std::vector<Binding> bindings;
+    std::vector<Column> columns;
+    TriangleKernel triangles;
+    size_t prefix_bytes;
+    size_t suffix_bytes;
+  };
+
+  /**
+   * @brief Receives the records [first, first + count) of the vertex
+   * (kPosition) or face (kIndex) element, decoded into chunk. Returning false
+   * stops the decoding.
+   */
+  typedef std::function<bool(Target target, size_t first, size_t count,
+                             const TriangleMesh &chunk)>
+      ChunkConsumer;
+
+  /**
+   * @brief CanStream Whether DecodeChunks supports the layout: a binary file
+   * whose elements are fixed size or faces with a single triangle list.
+   */
+  bool CanStream() const;
+
+  /**
+   * @brief DecodeChunks Decodes the same data as Decode, but at most
+   * chunk_records records at a time into a scratch mesh that is handed to
+   * consume, so only one chunk is in memory at any time.
+   * @param data The file contents, the same ones the header was read from.
+   * @param size Size in bytes of data.
+   * @param chunk_records Maximum number of records per chunk.
+   * @param consume Called for every chunk, in file order.
+   * @return Whether the data matches the schema and consume accepted every
+   * chunk.
+   */
+  bool DecodeChunks(const char *data, size_t size, size_t chunk_records,
+                    const ChunkConsumer &consume) const;
+
+ private:
+  // Both append the corners of the faces to the faces_ of mesh and, unless
+  // they are all known to be triangles, the number of corners of every face
+  // to sizes.
+  bool DecodeAscii(const char *data, const char *end, TriangleMesh *mesh,
+                   std::vector<int> *sizes) const;
+  bool DecodeBinary(const char *data, const char *end, TriangleMesh *mesh,
+                    std::vector<int> *sizes) const;
+
+  PlyHeader header_;
+  std::vector<ElementPlan> plans_;
+  size_t vertices_;
+  size_t faces_;
+  bool has_normals_;
+  bool has_tex_coords_;
+  bool has_colors_;
+  bool has_quality_;
+};
+
+}  // namespace data_representation
+
+#endif  // PLY_FORMAT_H_
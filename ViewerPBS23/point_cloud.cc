@@ -0,0 +1,270 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#include <point_cloud.h>
+
+#include <eigen3/Eigen/Eigenvalues>
+#include <eigen3/Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#include "./parallel_for.h"
+
+namespace data_representation {
+
+namespace {
+
+// Ranges with fewer points than this are not worth a thread.
+const size_t kMinPoints = 1 << 14;
+
+// Subtrees with at most this many points are searched linearly.
+const size_t kLeafPoints = 16;
+
+// Seed of ShufflePoints, fixed so caches and reloads get the same order.
+const uint32_t kShuffleSeed = 0x5EED;
+
+/**
+ * Implicit k-d tree over a copy of the points: the median of every range of
+ * the copy splits it, and the axis it splits along is stored at the position
+ * of the median. The copy is in tree order, so leaves and nearby subtrees are
+ * contiguous in memory.
+ */
+class KdTree {
+ public:
+  explicit KdTree(const std::vector<float> &positions)
+      : points_(positions.size() / 3), axes_(positions.size() / 3, 0) {
+    for (size_t i = 0; i < points_.size(); ++i) {
+      points_[i].position = Eigen::Vector3f(
+          positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+      points_[i].index = static_cast<int>(i);
+    }
+
+    // The top levels are split on this thread until there are enough
+    // independent subtrees to keep every thread busy.
+    std::vector<std::pair<size_t, size_t>> subtrees(
+        1, std::make_pair(size_t(0), points_.size()));
+    while (subtrees.size() < ThreadCount() * 4) {
+      std::vector<std::pair<size_t, size_t>> children;
+      for (const auto &subtree : subtrees) {
+        if (subtree.second - subtree.first < kMinPoints) {
+          children.push_back(subtree);
+          continue;
+        }
+        const size_t kMid = Split(subtree.first, subtree.second);
+        children.push_back(std::make_pair(subtree.first, kMid));
+        children.push_back(std::make_pair(kMid + 1, subtree.second));
+      }
+      if (children.size() == subtrees.size()) break;
+      subtrees.swap(children);
+    }
+    ParallelFor(subtrees.size(), 1, [&](size_t, size_t first, size_t last) {
+      for (size_t s = first; s < last; ++s)
+        Build(subtrees[s].first, subtrees[s].second);
+    });
+  }
+
+  // The point at position slot of the tree and its index in the input.
+  const Eigen::Vector3f &point(size_t slot) const {
+    return points_[slot].position;
+  }
+  int index(size_t slot) const { return points_[slot].index; }
+
+  // Finds the (at most) count points nearest to the one at slot, other than
+  // itself, and writes their slots to found and their squared distances to
+  // distances, nearest first. Returns how many were found.
+  size_t Nearest(size_t slot, size_t count, size_t *found,
+                 float *distances) const {
+    Query query = {points_[slot].position, slot, count, found, distances, 0};
+    Search(0, points_.size(), &query);
+    return query.size;
+  }
+
+ private:
+  struct Point {
+    Eigen::Vector3f position;
+    int index;
+  };
+
+  struct Query {
+    Eigen::Vector3f position;
+    size_t slot;
+    size_t count;
+    size_t *found;
+    float *distances;
+    size_t size;
+
+    float Bound() const {
+      return size < count ? std::numeric_limits<float>::max()
+                          : distances[size - 1];
+    }
+
+    // Insertion into the sorted candidates; count is small.
+    void Add(size_t candidate, float distance) {
+      if (candidate == slot || distance >= Bound()) return;
+      size_t i = size < count ? size++ : count - 1;
+      for (; i > 0 && distances[i - 1] > distance; --i) {
+        distances[i] = distances[i - 1];
+        found[i] = found[i - 1];
+      }
+      distances[i] = distance;
+      found[i] = candidate;
+    }
+  };
+
+  // Partitions [first, last) around its median along its widest axis and
+  // returns the position of the median.
+  size_t Split(size_t first, size_t last) {
+    Eigen::Vector3f min = points_[first].position;
+    Eigen::Vector3f max = min;
+    for (size_t i = first + 1; i < last; ++i) {
+      min = min.cwiseMin(points_[i].position);
+      max = max.cwiseMax(points_[i].position);
+    }
+    int axis = 0;
+    (max - min).maxCoeff(&axis);
+
+    const size_t kMid = first + (last - first) / 2;
+    std::nth_element(points_.begin() + first, points_.begin() + kMid,
+                     points_.begin() + last,
+                     [axis](const Point &a, const Point &b) {
+                       return a.position[axis] < b.position[axis];
+                     });
+    axes_[kMid] = static_cast<uint8_t>(axis);
+    return kMid;
+  }
+
+  void Build(size_t first, size_t last) {
+    if (last - first <= kLeafPoints) return;
+    const size_t kMid = Split(first, last);
+    Build(first, kMid);
+    Build(kMid + 1, last);
+  }
+
+  void Search(size_t first, size_t last, Query *query) const {
+    if (last - first <= kLeafPoints) {
+      for (size_t i = first; i < last; ++i)
+        query->Add(i, (points_[i].position - query->position).squaredNorm());
+      return;
+    }
+
+    const size_t kMid = first + (last - first) / 2;
+    query->Add(kMid, (points_[kMid].position - query->position).squaredNorm());
+
+    // The side of the query is searched first, the other one only if the
+    // splitting plane is closer than the farthest candidate.
+    const int kAxis = axes_[kMid];
+    const float kOffset =
+        query->position[kAxis] - points_[kMid].position[kAxis];
+    if (kOffset < 0.0f) {
+      Search(first, kMid, query);
+      if (kOffset * kOffset < query->Bound()) Search(kMid + 1, last, query);
+    } else {
+      Search(kMid + 1, last, query);
+      if (kOffset * kOffset < query->Bound()) Search(first, kMid, query);
+    }
+  }
+
+  std::vector<Point> points_;
+  std::vector<uint8_t> axes_;
+};
+
+template <typename T>
+void Permute(const std::vector<int> &order, size_t width,
+             std::vector<T> *values) {
+  if (values->size() != order.size() * width) return;
+  std::vector<T> permuted(values->size());
+  ParallelFor(order.size(), kMinPoints, [&](size_t, size_t first,
+                                            size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      std::copy(values->begin() + size_t(order[i]) * width,
+                values->begin() + size_t(order[i] + 1) * width,
+                permuted.begin() + i * width);
+    }
+  });
+  values->swap(permuted);
+}
+
+}  // namespace
+
+float EstimatePointNormals(const std::vector<float> &positions,
+                           size_t neighbours, std::vector<float> *normals) {
+  const size_t kPoints = positions.size() / 3;
+  if (normals != nullptr) normals->assign(kPoints * 3, 0.0f);
+  if (kPoints < 2 || neighbours == 0) return 0.0f;
+
+  Eigen::Vector3f min = Eigen::Vector3f::Constant(
+      std::numeric_limits<float>::max());
+  Eigen::Vector3f max = -min;
+  for (size_t i = 0; i < kPoints; ++i) {
+    const Eigen::Vector3f kPosition(positions[i * 3], positions[i * 3 + 1],
+                                    positions[i * 3 + 2]);
+    min = min.cwiseMin(kPosition);
+    max = max.cwiseMax(kPosition);
+  }
+  const Eigen::Vector3f kCenter = (min + max) / 2.0f;
+
+  // Queries run in tree order, so consecutive ones visit the same subtrees.
+  const KdTree kTree(positions);
+  const size_t kRanges = RangeCount(kPoints, kMinPoints);
+  std::vector<double> spacings(kRanges, 0.0);
+  ParallelFor(kPoints, kMinPoints, [&](size_t range, size_t first,
+                                       size_t last) {
+    std::vector<size_t> found(neighbours);
+    std::vector<float> distances(neighbours);
+    for (size_t s = first; s < last; ++s) {
+      const size_t kFound =
+          kTree.Nearest(s, neighbours, found.data(), distances.data());
+      if (kFound == 0) continue;
+      spacings[range] += std::sqrt(distances[0]);
+      if (normals == nullptr || kFound < 2) continue;
+
+      const Eigen::Vector3f &kPosition = kTree.point(s);
+      Eigen::Vector3f mean = kPosition;
+      for (size_t k = 0; k < kFound; ++k) mean += kTree.point(found[k]);
+      mean /= static_cast<float>(kFound + 1);
+
+      Eigen::Matrix3f covariance =
+          (kPosition - mean) * (kPosition - mean).transpose();
+      for (size_t k = 0; k < kFound; ++k) {
+        const Eigen::Vector3f kOffset = kTree.point(found[k]) - mean;
+        covariance += kOffset * kOffset.transpose();
+      }
+
+      // Eigenvalues come in increasing order.
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
+      solver.computeDirect(covariance);
+      Eigen::Vector3f normal = solver.eigenvectors().col(0);
+      if (!normal.allFinite()) continue;
+      if (normal.dot(kPosition - kCenter) < 0.0f) normal = -normal;
+      const size_t kIndex = static_cast<size_t>(kTree.index(s));
+      for (int k = 0; k < 3; ++k) (*normals)[kIndex * 3 + k] = normal[k];
+    }
+  });
+
+  double spacing = 0.0;
+  for (double range_spacing : spacings) spacing += range_spacing;
+  return static_cast<float>(spacing / kPoints);
+}
+
+void ShufflePoints(TriangleMesh *mesh) {
+  const size_t kPoints = mesh->vertices_.size() / 3;
+  std::vector<int> order(kPoints);
+  for (size_t i = 0; i < kPoints; ++i) order[i] = static_cast<int>(i);
+
+  std::mt19937 random(kShuffleSeed);
+  for (size_t i = kPoints; i > 1; --i) {
+    std::uniform_int_distribution<size_t> pick(0, i - 1);
+    std::swap(order[i - 1], order[pick(random)]);
+  }
+
+  Permute(order, 3, &mesh->vertices_);
+  Permute(order, 3, &mesh->normals_);
+  Permute(order, 2, &mesh->texCoords_);
+  Permute(order, 4, &mesh->colors_);
+  Permute(order, 1, &mesh->quality_);
+}
+
+}  // namespace data_representation
@@ -0,0 +1,44 @@
+// Author: Imanol Munoz-Pandiella 2023 based on Marc Comino 2020
+
+#ifndef POINT_CLOUD_H_
+#define POINT_CLOUD_H_
+
+#include <triangle_mesh.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace data_representation {
+
+/**
+ * @brief kPointNeighbours Number of nearest neighbours the normal of a point
+ * is fitted to.
+ */
+const size_t kPointNeighbours = 12;
+
+/**
+ * @brief EstimatePointNormals Finds the nearest neighbours of every point with
+ * a k-d tree, in parallel. The normal of a point is the direction of least
+ * variance of its neighbourhood, oriented away from the center of the
+ * bounding box of the cloud since scans have no consistent winding.
+ * @param positions Three coordinates per point.
+ * @param neighbours Number of neighbours of every point.
+ * @param normals Resulting unit normals, three per point. Points without
+ * neighbours get a zero normal. It may be nullptr to only measure the spacing.
+ * @return The mean distance from a point to its nearest neighbour.
+ */
+float EstimatePointNormals(const std::vector<float> &positions,
+                           size_t neighbours, std::vector<float> *normals);
+
+/**
+ * @brief ShufflePoints Reorders the points of a mesh without faces randomly,
+ * together with their other attributes, so that any prefix of them is a
+ * uniform subsample of the cloud. The shuffle is seeded, so the same cloud
+ * always gets the same order.
+ * @param mesh A point cloud.
+ */
+void ShufflePoints(TriangleMesh *mesh);
+
+}  // namespace data_representation
+
+#endif  // POINT_CLOUD_H_
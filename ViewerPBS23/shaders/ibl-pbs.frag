@@ -3,6 +3,7 @@
 // Inputs
 in vec3 frag_pos;           // Vertex position
 in vec3 m_normal;           // Normals
+in vec4 v_color;            // Vertex color, tints the albedo
 
 // Uniforms
 // - General
@@ -75,8 +76,9 @@ vec3 PBR()
     vec3 R = reflect(-V, N);                    // Reflection vector
 
     // Initializations - General
+    vec3 base_color = albedo * v_color.rgb;   // Material albedo tinted by the vertex color
     vec3 F0 = fresnel;                    // Import the F0 from the fresnel uniform
-    F0 = mix(F0, albedo, metalness);      // Mix the fresnel F0
+    F0 = mix(F0, base_color, metalness);  // Mix the fresnel F0
 
     // Diffuse - Specular K-Terms
     vec3 Ks = F_Roughness(max(dot(N, V), 0.0), F0, roughness);
@@ -84,7 +86,7 @@ vec3 PBR()
 
     // Ambient / Diffuse Part
     vec3 irradiance = texture(diffuse_map, N).rgb;
-    vec3 diffuse = irradiance * albedo;
+    vec3 diffuse = irradiance * base_color;
     vec3 ambient = Kd * diffuse;
 
     // Specular Part
@@ -4,6 +4,7 @@
 layout (location = 0) in vec3 vert;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoord;
+layout (location = 3) in vec4 color;        // White when the model has no vertex colors
 
 // Uniforms
 uniform mat4 model;
@@ -14,6 +15,7 @@ uniform mat3 normal_matrix;
 // Outputs
 out vec3 frag_pos;
 out vec3 m_normal;
+out vec4 v_color;
 
 void main(void)  {
 
@@ -22,4 +24,7 @@ void main(void)  {
     // Pass the position to the fragment shader
     frag_pos = vec3(model * vec4(vert, 1.0f));
     gl_Position = projection * view * vec4(frag_pos, 1.0f);
+
+    // Pass the vertex color to the fragment shader
+    v_color = color;
 }
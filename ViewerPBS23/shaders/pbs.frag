@@ -4,6 +4,7 @@
 in vec3 frag_pos;           // Vertex position
 in vec3 m_normal;           // Normals
 in vec2 v_uv;               // Texture Coordinates
+in vec4 v_color;            // Vertex color, tints the albedo
 
 // Uniforms
 uniform vec3 light;         // import light position
@@ -84,17 +85,19 @@ vec3 PBR()
     //float roughness = texture(roughness_map, v_uv).r;
     //float metalness = texture(metalness_map, v_uv).r;
 
+    vec3 base_color = albedo * v_color.rgb;   // Material albedo tinted by the vertex color
+
     float lightIntensity = 1.0f;
     float a = pow(roughness, 2.0);        // Initialize a=roughness^2
     vec3 F0 = fresnel;                    // Import the F0 from the fresnel uniform
-    F0 = mix(F0, albedo, metalness);      // Mix the fresnel F0
+    F0 = mix(F0, base_color, metalness);  // Mix the fresnel F0
 
     // Diffuse - Specular Terms
     vec3 Ks = F(F0, L, H);
     vec3 Kd = (vec3(1.0) - Ks) * (1.0 - metalness);
 
     // Lambert
-    vec3 Fd = pow(albedo, vec3(2.2)) / PI;
+    vec3 Fd = pow(base_color, vec3(2.2)) / PI;
 
     // Cook-Torrance
     vec3 Fs_numerator = D(a, N, H) * G(a, N, V, L) * F(F0, L, H);
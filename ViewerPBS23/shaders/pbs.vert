@@ -4,6 +4,7 @@
 layout (location = 0) in vec3 vert;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoord;
+layout (location = 3) in vec4 color;        // White when the model has no vertex colors
 
 // Uniforms
 uniform mat4 model;
@@ -14,6 +15,7 @@ uniform mat4 projection;
 out vec3 frag_pos;
 out vec3 m_normal;
 out vec2 v_uv;
+out vec4 v_color;
 
 void main(void)  {
 
@@ -25,4 +27,6 @@ void main(void)  {
 
     // Pass the texture coordinates to the fragment shader
     v_uv = texCoord;
+    // Pass the vertex color to the fragment shader
+    v_color = color;
 }
@@ -5,6 +5,7 @@ in vec3 frag_pos;       // import position
 in vec3 m_normal;       // import normal
 in vec3 face_normal;    // import face_normals
 in vec2 v_uv;          // import texture coordinates
+in vec4 v_color;        // import vertex color
 
 // Uniforms
 uniform vec3 light;     // import light position
@@ -26,13 +27,13 @@ void main (void) {
     // ambient
     float ambientStrength = 0.4f;
     //vec3 ambient = ambientStrength * lightColor;    // Compute the diffuse parameter of the lighting
-    vec3 ambient = ambientStrength * lightColor * vec3(texture(color_map, v_uv));      // Add the texture's albedo texture for the ambient computation
+    vec3 ambient = ambientStrength * lightColor * vec3(texture(color_map, v_uv)) * v_color.rgb;      // Add the texture's albedo texture for the ambient computation
 
     // diffuse
     vec3 lightDir = normalize(light - frag_pos);
     float diff = max(dot(m_normal, lightDir), 0.0f);
     //vec3 diffuse = diff * lightColor; // Compute the diffuse parameter of the lighting
-    vec3 diffuse = diff * lightColor * vec3(texture(color_map, v_uv));  // Add the texture's albedo texture for the ambient computation
+    vec3 diffuse = diff * lightColor * vec3(texture(color_map, v_uv)) * v_color.rgb;  // Add the texture's albedo texture for the ambient computation
 
     // specular
     float specularStrength = 1.0f;
@@ -4,6 +4,7 @@
 layout (location = 0) in vec3 vert;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoord;
+layout (location = 3) in vec4 color;        // White when the model has no vertex colors
 
 // Uniforms
 uniform mat4 model;
@@ -16,6 +17,7 @@ out vec3 frag_pos;
 out vec3 m_normal;
 out vec3 face_normal;
 out vec2 v_uv;
+out vec4 v_color;
 
 void main(void)  {
     // If I always want to see the front of the sphere, while rotating the background
@@ -34,4 +36,5 @@ void main(void)  {
 
     // Pass the texture coordinates to the fragment shader
     v_uv = texCoord;
+    v_color = color;
 }
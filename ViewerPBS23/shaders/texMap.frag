@@ -3,6 +3,8 @@
 // Inputs
 in vec2 v_uv;
 in vec3 v_normals;
+in vec4 v_color;
+in float v_quality;
 
 // Uniforms
 uniform int current_texture;
@@ -27,5 +29,15 @@ void main(void)
     {
         frag_color = texture(metalness_map, v_uv);
     }
+    else if(current_texture==3)
+    {
+        frag_color = v_color;
+    }
+    else if(current_texture==4)
+    {
+        // Heat map: blue (low) - green - red (high)
+        vec3 low = mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), clamp(v_quality * 2.0, 0.0, 1.0));
+        frag_color = vec4(mix(low, vec3(1.0, 0.0, 0.0), clamp(v_quality * 2.0 - 1.0, 0.0, 1.0)), 1.0);
+    }
 
 }
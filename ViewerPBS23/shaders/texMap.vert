@@ -4,6 +4,8 @@
 layout (location = 0) in vec3 vert;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoord;
+layout (location = 3) in vec4 color;        // White when the model has no vertex colors
+layout (location = 4) in float quality;     // Normalized to [0, 1], 0 when the model has none
 
 // Uniforms
 uniform mat4 model;
@@ -13,6 +15,8 @@ uniform mat4 projection;
 // Outputs
 out vec2 v_uv;
 out vec3 v_normals;
+out vec4 v_color;
+out float v_quality;
 
 void main(void)  {
     // Not exactly needed right now for texturing the sphere, might need later
@@ -26,4 +30,7 @@ void main(void)  {
     gl_Position = projection * view * model * vec4(vert, 1.0f);
     // Pass texture coordinates to the fragment shader
     v_uv = texCoord;
+    // Pass the vertex attributes to the fragment shader
+    v_color = color;
+    v_quality = quality;
 }
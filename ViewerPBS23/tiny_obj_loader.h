@@ -661,6 +661,8 @@ bool ParseTextureNameAndOption(std::string *texname, texture_option_t *texopt,
 #include <sstream>
 #include <utility>
 
+#include "float_parser.h"
+
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
 
 #ifdef TINYOBJLOADER_DONOT_INCLUDE_MAPBOX_EARCUT
@@ -836,6 +838,7 @@ static inline int parseInt(const char **token) {
   return i;
 }
 
+#ifdef TINYOBJLOADER_USE_DOUBLE
 // Tries to parse a floating point number located at s.
 //
 // s_end should be a location in the string where reading should absolutely
@@ -994,13 +997,24 @@ assemble:
 fail:
   return false;
 }
+#endif  // TINYOBJLOADER_USE_DOUBLE
+
+// Parses straight to single precision when real_t is float: the result is
+// correctly rounded and it skips the pow and ldexp of tryParseDouble.
+static inline bool tryParseReal(const char *s, const char *s_end,
+                                real_t *result) {
+#ifdef TINYOBJLOADER_USE_DOUBLE
+  return tryParseDouble(s, s_end, result);
+#else
+  return data_representation::ParseFloat(s, s_end, result) != NULL;
+#endif
+}
 
 static inline real_t parseReal(const char **token, double default_value = 0.0) {
   (*token) += strspn((*token), " \t");
   const char *end = (*token) + strcspn((*token), " \t\r");
-  double val = default_value;
-  tryParseDouble((*token), end, &val);
-  real_t f = static_cast<real_t>(val);
+  real_t f = static_cast<real_t>(default_value);
+  tryParseReal((*token), end, &f);
   (*token) = end;
   return f;
 }
@@ -1008,12 +1022,7 @@ static inline real_t parseReal(const char **token, double default_value = 0.0) {
 static inline bool parseReal(const char **token, real_t *out) {
   (*token) += strspn((*token), " \t");
   const char *end = (*token) + strcspn((*token), " \t\r");
-  double val;
-  bool ret = tryParseDouble((*token), end, &val);
-  if (ret) {
-    real_t f = static_cast<real_t>(val);
-    (*out) = f;
-  }
+  bool ret = tryParseReal((*token), end, out);
   (*token) = end;
   return ret;
 }
@@ -1132,6 +1141,25 @@ static tag_sizes parseTagTriple(const char **token) {
   return ts;
 }
 
+// atoi followed by strcspn(token, "/ \t\r"), in a single pass for plain
+// digits ended by one of those, which is what face indices almost always are.
+static inline int parseIndex(const char **token) {
+  const char *p = (*token);
+  if (!IS_DIGIT(*p) && *p != '-' && *p != '+') {
+    int i = atoi(p);
+    (*token) += strcspn(p, "/ \t\r");
+    return i;
+  }
+  bool negative = false;
+  if (*p == '-' || *p == '+') negative = *p++ == '-';
+  int i = 0;
+  while (IS_DIGIT(*p)) i = i * 10 + (*p++ - '0');
+  if (*p != '/' && !IS_SPACE(*p) && *p != '\r' && *p != '\0')
+    p += strcspn(p, "/ \t\r");
+  (*token) = p;
+  return negative ? -i : i;
+}
+
 // Parse triples with index offsets: i, i/j/k, i//k, i/j
 static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
                         vertex_index_t *ret) {
@@ -1141,11 +1169,10 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
 
   vertex_index_t vi(-1);
 
-  if (!fixIndex(atoi((*token)), vsize, &(vi.v_idx))) {
+  if (!fixIndex(parseIndex(token), vsize, &(vi.v_idx))) {
     return false;
   }
 
-  (*token) += strcspn((*token), "/ \t\r");
   if ((*token)[0] != '/') {
     (*ret) = vi;
     return true;
@@ -1155,20 +1182,18 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
   // i//k
   if ((*token)[0] == '/') {
     (*token)++;
-    if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
+    if (!fixIndex(parseIndex(token), vnsize, &(vi.vn_idx))) {
       return false;
     }
-    (*token) += strcspn((*token), "/ \t\r");
     (*ret) = vi;
     return true;
   }
 
   // i/j/k or i/j
-  if (!fixIndex(atoi((*token)), vtsize, &(vi.vt_idx))) {
+  if (!fixIndex(parseIndex(token), vtsize, &(vi.vt_idx))) {
     return false;
   }
 
-  (*token) += strcspn((*token), "/ \t\r");
   if ((*token)[0] != '/') {
     (*ret) = vi;
     return true;
@@ -1176,10 +1201,9 @@ static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
 
   // i/j/k
   (*token)++;  // skip '/'
-  if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
+  if (!fixIndex(parseIndex(token), vnsize, &(vi.vn_idx))) {
     return false;
   }
-  (*token) += strcspn((*token), "/ \t\r");
 
   (*ret) = vi;
 
@@ -2,10 +2,9 @@
 
 #include <triangle_mesh.h>
 
-#include <algorithm>
 #include <limits>
 
-#include <iostream>
+#include "./mesh_normals.h"
 
 namespace data_representation {
 
@@ -16,6 +15,13 @@ void TriangleMesh::Clear() {
   faces_.clear();
   normals_.clear();
   texCoords_.clear();
+  colors_.clear();
+  quality_.clear();
+  materialRanges_.clear();
+  lodFaces_.clear();
+  lods_.clear();
+  unweldedVertices_ = 0;
+  pointSpacing_ = 0.0f;
 
   min_ = Eigen::Vector3f(std::numeric_limits<float>::max(),
                          std::numeric_limits<float>::max(),
@@ -23,44 +29,25 @@ void TriangleMesh::Clear() {
   max_ = Eigen::Vector3f(std::numeric_limits<float>::lowest(),
                          std::numeric_limits<float>::lowest(),
                          std::numeric_limits<float>::lowest());
+  center_ = Eigen::Vector3f::Zero();
+  radius_ = 0.0f;
+  area_ = 0.0;
+  degenerateFaces_ = 0;
+  zeroAreaFaces_ = 0;
+  unreferencedVertices_ = 0;
+  adjacency_.Clear();
 }
 
-void TriangleMesh::computeNormals()
-{
-    normals_.clear();
-    std::vector<std::vector<int> > facesPerVertex(vertices_.size()/3);
-
-    //compute normals per face and facesPerVertex structure
-    std::vector<float> fNormals(faces_.size());
-    for(auto i = 0; i < faces_.size(); i+=3) {
-        Eigen::Vector3f v1(vertices_[3*faces_[i]],      vertices_[3*faces_[i]+1],   vertices_[3*faces_[i]+2]);
-        Eigen::Vector3f v2(vertices_[3*faces_[i+1]],    vertices_[3*faces_[i+1]+1], vertices_[3*faces_[i+1]+2]);
-        Eigen::Vector3f v3(vertices_[3*faces_[i+2]],    vertices_[3*faces_[i+2]+1], vertices_[3*faces_[i+2]+2]);
-
-        Eigen::Vector3f v12 = v2-v1;
-        Eigen::Vector3f v13 = v3-v1;
-        v12.normalize();
-        v13.normalize();
-
-        Eigen::Vector3f n = v12.cross(v13);
-        fNormals[i] = n.x();    fNormals[i+1] = n.y();  fNormals[i+2] = n.z();
-
-        facesPerVertex[faces_[i]].push_back(i/3);
-        facesPerVertex[faces_[i+1]].push_back(i/3);
-        facesPerVertex[faces_[i+2]].push_back(i/3);
-    }
+void TriangleMesh::computeNormals() {
+  ComputeVertexNormals(vertices_, faces_, Adjacency(), &normals_);
+}
 
-    //compute normals per vertex
-    normals_.reserve(vertices_.size());
-    for(auto i = 0; i < vertices_.size(); ++i) {
-        Eigen::Vector3f n;
-        for(auto j = 0; j < facesPerVertex[i/3].size(); ++j) {
-            n += Eigen::Vector3f(fNormals[j*3], fNormals[j*3+1], fNormals[j*3+2]);
-        }
-        n.normalize();
-        normals_[i] = n.x();    normals_[i+1] = n.y();  normals_[i+2] = n.z();
-    }
-    std::cout << "Normals computed!" << std::endl;
+const VertexAdjacency &TriangleMesh::Adjacency() {
+  if (adjacency_.empty() && !faces_.empty())
+    BuildVertexAdjacency(faces_, vertices_.size() / 3, &adjacency_);
+  return adjacency_;
 }
 
+void TriangleMesh::ResetAdjacency() { adjacency_.Clear(); }
+
 }  // namespace data_representation
@@ -5,12 +5,61 @@
 
 #include <eigen3/Eigen/Geometry>
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "./mesh_adjacency.h"
+
 namespace data_representation {
 
 class TriangleMesh {
  public:
+  /**
+   * @brief The MaterialRange struct A contiguous run of faces_ drawn with the
+   * same material.
+   */
+  struct MaterialRange {
+    /**
+     * @brief first Offset in faces_ of the first index of the run.
+     */
+    size_t first;
+
+    /**
+     * @brief count Number of indices of the run, three per triangle.
+     */
+    size_t count;
+
+    /**
+     * @brief diffuse_map Path of the diffuse texture of the material, empty
+     * if it has none.
+     */
+    std::string diffuse_map;
+  };
+
+  /**
+   * @brief The LevelOfDetail struct A simplified version of the mesh, whose
+   * faces are a run of lodFaces_ over the same vertices.
+   */
+  struct LevelOfDetail {
+    /**
+     * @brief first Offset in lodFaces_ of the first index of the level.
+     */
+    size_t first;
+
+    /**
+     * @brief count Number of indices of the level, three per triangle.
+     */
+    size_t count;
+
+    /**
+     * @brief error How far, in model units, the surface of the level is from
+     * the one of the mesh: the root of the largest mean squared distance of a
+     * vertex to the planes of the faces it stands for.
+     */
+    float error;
+  };
+
   /**
    * @brief TriangleMesh Constructor of the class. Calls clear.
    */
@@ -27,16 +76,76 @@ class TriangleMesh {
   void Clear();
 
   /**
-  * @brief Compute vertex normals of the model
-  */
+   * @brief computeNormals Recomputes normals_ as the angle weighted vertex
+   * normals (see ComputeVertexNormals), over Adjacency.
+   */
   void computeNormals();
 
+  /**
+   * @brief Adjacency The faces around every vertex. It is built from faces_
+   * the first time it is asked for and kept until Clear or ResetAdjacency, so
+   * it is shared by every algorithm that needs the topology. Not thread safe
+   * while it is being built. It is empty if the mesh is too large for it.
+   */
+  const VertexAdjacency &Adjacency();
+
+  /**
+   * @brief ResetAdjacency Drops the cached adjacency. Every change to faces_
+   * or to the number of vertices has to be followed by a call to it.
+   */
+  void ResetAdjacency();
+
  public:
   std::vector<float> vertices_;
   std::vector<int> faces_;
   std::vector<float> normals_;
   std::vector<float> texCoords_;
-  std::string diffuseMap_;
+
+  /**
+   * @brief colors_ Per-vertex RGBA colors, four bytes per vertex, or empty
+   * when the model has none. They are uploaded as they are, as normalized
+   * bytes.
+   */
+  std::vector<uint8_t> colors_;
+
+  /**
+   * @brief quality_ Per-vertex quality (the confidence of a scanned point),
+   * or empty when the model has none. It is uploaded as normalized bytes
+   * spanning its range.
+   */
+  std::vector<float> quality_;
+
+  /**
+   * @brief materialRanges_ The runs of faces_ of every material, ordered so
+   * that runs with the same diffuse map are adjacent. Empty when the model has
+   * no materials.
+   */
+  std::vector<MaterialRange> materialRanges_;
+
+  /**
+   * @brief lodFaces_ The faces of all the levels of detail, one after the
+   * other. Empty when the mesh has none.
+   */
+  std::vector<int> lodFaces_;
+
+  /**
+   * @brief lods_ The levels of detail of the mesh (see BuildLevelsOfDetail),
+   * from the finest to the coarsest. Every change to faces_ invalidates them.
+   */
+  std::vector<LevelOfDetail> lods_;
+
+  /**
+   * @brief unweldedVertices_ Number of vertices before identical face corners
+   * were welded, 0 if the loader did not weld them.
+   */
+  size_t unweldedVertices_;
+
+  /**
+   * @brief pointSpacing_ Mean distance from a point to its nearest neighbour
+   * when the mesh is a point cloud, which has vertices but no faces_. Its
+   * splats are sized after it. 0 for meshes with faces.
+   */
+  float pointSpacing_;
 
   /**
    * @brief min The minimum point of the bounding box.
@@ -47,6 +156,43 @@ class TriangleMesh {
    * @brief max The maximum point of the bounding box.
    */
   Eigen::Vector3f max_;
+
+  /**
+   * @brief center_ Center of a bounding sphere of the vertices, which the
+   * camera fits the model to.
+   */
+  Eigen::Vector3f center_;
+
+  /**
+   * @brief radius_ Radius of the bounding sphere, 0 for an empty mesh.
+   */
+  float radius_;
+
+  /**
+   * @brief area_ Total surface area of the faces.
+   */
+  double area_;
+
+  /**
+   * @brief degenerateFaces_ Number of faces that repeat a vertex or reference
+   * one that does not exist.
+   */
+  size_t degenerateFaces_;
+
+  /**
+   * @brief zeroAreaFaces_ Number of faces with three different vertices but
+   * (almost) no area: collinear or coincident positions.
+   */
+  size_t zeroAreaFaces_;
+
+  /**
+   * @brief unreferencedVertices_ Number of vertices no face uses. Always 0
+   * for point clouds.
+   */
+  size_t unreferencedVertices_;
+
+ private:
+  VertexAdjacency adjacency_;
 };
 
 }  // namespace data_representation